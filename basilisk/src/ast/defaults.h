@@ -18,11 +18,16 @@ typedef void PyObject;
 /**
 ## From MPI */
 
-typedef void MPI_Datatype, MPI_Request, MPI_Comm, MPI_Op, MPI_Aint;
+typedef void MPI_Datatype, MPI_Request, MPI_Comm, MPI_Op, MPI_Aint, MPI_File;
 typedef int MPI_Status;
 typedef long long MPI_Offset;
 typedef struct MPIR_Info *MPI_Info;
 
+/**
+## From POSIX threads */
+
+typedef int pthread_t, pthread_mutex_t, pthread_cond_t, pthread_attr_t;
+
 /**
 ## From OpenGL */
 
@@ -2966,9 +2966,29 @@ static void file_line (AstRoot * parse, const char * text)
   //  fprintf (stderr, "%s: \"%s\" %d\n", text, file, yylineno);
 }
 
+static char * buffer_start = NULL;
+
+/* 'float scalar', 'float vector' and 'float tensor' declare fields
+   stored in single precision (see translate.c) */
+static bool float_field (void)
+{
+  if (strcmp (yytext, "scalar") && strcmp (yytext, "vector") &&
+      strcmp (yytext, "tensor"))
+    return false;
+  char * s = yytext - 1;
+  while (s > buffer_start && strchr (" \t\r\n", *s))
+    s--;
+  s -= 4;
+  return s >= buffer_start && !strncmp (s, "float", 5) &&
+    (s == buffer_start || !(s[-1] == '_' ||
+			    (s[-1] >= 'a' && s[-1] <= 'z') ||
+			    (s[-1] >= 'A' && s[-1] <= 'Z') ||
+			    (s[-1] >= '0' && s[-1] <= '9')));
+}
+
 static int check_type (AstRoot * parse)
 {
-  if (parse->type_already_specified)
+  if (parse->type_already_specified && !float_field())
     return IDENTIFIER;
   
   Ast * declaration = ast_identifier_declaration (parse->stack, yytext);
@@ -2984,6 +3004,7 @@ static int check_type (AstRoot * parse)
 void lexer_setup (char * buffer, size_t len)
 {
   yylineno = 1;
+  buffer_start = buffer;
   yy_scan_buffer (buffer, len);
 }
 
@@ -807,13 +807,13 @@ static Field * field_append (Field ** fields, Ast * identifier,
 
 typedef struct {
   int dimension;
-  bool nolineno, parallel, cpu, gpu;
+  bool nolineno, parallel, cpu, gpu, mixed;
   Field * constants;
   int constants_index, fields_index, nboundary;
   Ast * init_solver, * init_events, * init_fields, * last_events;
   Ast * boundary;
   char * swigname, * swigdecl, * swiginit;
-  Stack * functions;
+  Stack * functions, * floats, * precisions;
 } TranslateData;
 
 static Ast * in_stencil_point_function (Ast * n)
@@ -1652,6 +1652,41 @@ static char * delete_fields (char ** delete)
   return NULL;
 }
 
+/**
+Fields declared with the `float` qualifier are stored in single
+precision when using [mixed precision](#mixed-precision). */
+
+static bool is_float_declaration (TranslateData * d, const Ast * declaration)
+{
+  if (!d->mixed)
+    return false;
+  Ast ** n;
+  for (int i = 0; (n = stack_index (d->floats, i)); i++)
+    if (*n == declaration)
+      return true;
+  return false;
+}
+
+/**
+The precision of the fields allocated by a declaration (e.g. `scalar
+s[];`) is fixed by this declaration. The corresponding identifiers
+are stored so that the accesses to these fields can use the right
+type at compile time. */
+
+typedef struct {
+  Ast * identifier;
+  bool single;
+} FieldPrecision;
+
+static void field_precision (TranslateData * d, Ast * identifier,
+			     const Ast * declaration)
+{
+  if (d->mixed) {
+    FieldPrecision p = {identifier, is_float_declaration (d, declaration)};
+    stack_push (d->precisions, &p);
+  }
+}
+
 static void
 field_allocation (Stack * stack, TranslateData * d,
 		  const char * typename,
@@ -1669,18 +1704,26 @@ field_allocation (Stack * stack, TranslateData * d,
   if (strchr (typename, ' '))
     typename = strchr (typename, ' ') + 1;
 
+  bool single = is_float_declaration (d, ast_declaration_from_type (declarator));
+  if (single)
+    str_prepend (src, "float_", typename, "(new_");
+  else
+    str_prepend (src, "new_");
   Ast * argument = automatic_argument (init_declarator);
+  if (!argument)
+    field_precision (d, allocator->child[0],
+		     ast_declaration_from_type (declarator));
   if (argument) {
     char * arg = ast_str_append (argument, NULL);
     str_prepend (src, typename, " _field_=(", arg, ")",
 		 !strcmp (typename, "scalar") ? ".i" :
 		 !strcmp (typename, "vector") ? ".x.i" : ".x.x.i",
-		 ">0?(", arg, "):new_"); // fixme: should be >= 0
+		 ">0?(", arg, "):"); // fixme: should be >= 0
     free (arg);
   }
   else
-    str_prepend (src, typename, " _field_=new_");
-  str_append (src, "(\"", name, "\");");
+    str_prepend (src, typename, " _field_=");
+  str_append (src, "(\"", name, "\")", single ? ")" : "", ";");
 	    
   Ast * expr = ast_parse_expression (src, ast_get_root (init_declarator));
   free (src);  
@@ -2927,6 +2970,7 @@ static void translate (Ast * n, Stack * stack, void * data)
 	  c.symmetric = !strcmp (func, "symmetric_tensor");
 	  field_init (&c, typename, d->dimension, &d->fields_index);
 	  field->value = (void *)(long) c.index + 1;
+	  field_precision (d, declarator->child[0], declaration);
 	  char * src = field_value (&c, "", c.type);
 	  char * init = NULL;
 	  str_append (init,
@@ -2935,6 +2979,13 @@ static void translate (Ast * n, Stack * stack, void * data)
 	  Ast * finit = ast_parse_expression (init, ast_get_root (n));
 	  free (init);
 	  compound_append (d->init_fields, NN(n, sym_statement, finit));
+	  if (is_float_declaration (d, declaration)) {
+	    init = NULL;
+	    str_append (init, "float_", typename, "((", typename, ")", src, ");");
+	    finit = ast_parse_expression (init, ast_get_root (n));
+	    free (init);
+	    compound_append (d->init_fields, NN(n, sym_statement, finit));
+	  }
 	  str_prepend (src, typename, " _field_=");
 	  str_append (src, ";");
 
@@ -3374,6 +3425,12 @@ static void translate (Ast * n, Stack * stack, void * data)
 	str_prepend (src, "new_");
 	str_append (src, "(\"", ast_terminal (identifier)->start, "\");");
       }
+      if (is_float_declaration (data, declaration)) {
+	str_prepend (src, "float_", strchr (typename, ' ') ?
+		     strchr (typename, ' ') + 1 : typename, "(");
+	src[strlen (src) - 1] = '\0';
+	str_append (src, ");");
+      }
       Ast * expr = ast_parse_expression (src, ast_get_root (n));
       free (src);
       ast_set_line (expr, ast_terminal (n));
@@ -4209,7 +4266,7 @@ static void macros (Ast * n, Stack * stack, void * data)
     ### Reductions */
 
     Ast * parameters = ast_child (n, sym_foreach_parameters);
-    bool serial = false;
+    bool serial = false, simd = true;
     char * sreductions = NULL;
     if (parameters) {
       foreach_item (parameters, 2, item) {
@@ -4252,6 +4309,8 @@ static void macros (Ast * n, Stack * stack, void * data)
 		       t->file, t->line, type, t->start);
 	      exit (1);
 	    }
+	    if (array || !strcmp (type, "coord") || !strcmp (type, "mat3"))
+	      simd = false;
 	    if (array) {
 	      if (strcmp (type, "coord") && strcmp (type, "mat3")) {
 		ast_after (n, "mpi_all_reduce_array(", t->start, ",", type, ",");
@@ -4259,10 +4318,13 @@ static void macros (Ast * n, Stack * stack, void * data)
 		ast_right_terminal (n)->after = ast_str_append (array, ast_right_terminal (n)->after);
 		ast_after (n, ");");
 	      } else {
+		// the array may be a pointer: its length is given by the section
 		ast_after (n, "mpi_all_reduce_array((double *)", t->start, ",double,");
 		mpi_operator (n, reduction->child[2]);
+		ast_after (n, "(");
+		ast_right_terminal (n)->after = ast_str_append (array, ast_right_terminal (n)->after);
 		char s[100];
-		snprintf (s, 99, "sizeof(%s)/sizeof(double)", t->start);
+		snprintf (s, 99, ")*sizeof(%s[0])/(sizeof(double))", t->start);
 		ast_after (n, s, ");");
 	      }
 	    }
@@ -4273,7 +4335,7 @@ static void macros (Ast * n, Stack * stack, void * data)
 	      else {
 		// cast the adress of the first member into a double for coord and mat3
 		ast_after (n, "mpi_all_reduce_array((double *)&", t->start,",double");
-		snprintf (s, 99, "sizeof(%s)/sizeof(double)", t->start);
+		snprintf (s, 99, "sizeof(%s)/(sizeof(double))", t->start);
 	      }
 	      ast_after (n, ",");
 	      mpi_operator (n, reduction->child[2]);
@@ -4297,8 +4359,28 @@ static void macros (Ast * n, Stack * stack, void * data)
 		  "#if _OPENMP\n"
 		  "  #undef OMP\n"
 		  "  #define OMP(x)\n"
-		  "#endif\n");
+		  "#endif\n"
+		  "#undef OMP_SIMD\n"
+		  "#define OMP_SIMD()\n");
     if (sreductions) {
+
+      /**
+      Reductions also need to be declared for vectorised loops (see
+      [stencils.h](/src/grid/stencils.h#vectorisation)). */
+      
+      if (!serial) {
+	ast_before (n, "\n"
+		    "#undef OMP_SIMD\n"
+		    "#define OMP_SIMD() ");
+	if (simd) {
+	  char * s = strdup (sreductions);
+	  for (char * c = s; *c; c++)
+	    if (*c == '\n')
+	      *c = ' ';
+	  ast_before (n, "SIMD_PRAGMA(omp simd if(_simd) ", s, ")");
+	  free (s);
+	}
+      }
       ast_before (n, "\n"
 		  "#undef OMP_PARALLEL\n"
 		  "#define OMP_PARALLEL()\n"
@@ -4306,7 +4388,12 @@ static void macros (Ast * n, Stack * stack, void * data)
       ast_after (n,
 		 "\n"
 		 "#undef OMP_PARALLEL\n"
-		 "#define OMP_PARALLEL() OMP(omp parallel)\n}END_FOREACH ");
+		 "#define OMP_PARALLEL() OMP(omp parallel)\n");
+      if (!serial)
+	ast_after (n,
+		   "#undef OMP_SIMD\n"
+		   "#define OMP_SIMD() SIMD_PRAGMA(omp simd if(_simd))\n");
+      ast_after (n, "}END_FOREACH ");
       free (sreductions);
     }
     else {
@@ -4318,7 +4405,9 @@ static void macros (Ast * n, Stack * stack, void * data)
 		 "#if _OPENMP\n"
 		 "  #undef OMP\n"
 		 "  #define OMP(x) _Pragma(#x)\n"
-		 "#endif\n");
+		 "#endif\n"
+		 "#undef OMP_SIMD\n"
+		 "#define OMP_SIMD() SIMD_PRAGMA(omp simd if(_simd))\n");
     
     break;
   }
@@ -4802,6 +4891,302 @@ static void macros (Ast * n, Stack * stack, void * data)
   }
 }
 
+/**
+# Mixed precision
+
+Fields can be declared with the `float` qualifier, for example
+
+~~~literatec
+float scalar T[];
+float vector h[];
+~~~
+
+When compiling with `-DMIXED_PRECISION=1` on tree grids, these fields
+are stored in single precision (see
+[tree.h](/src/grid/tree.h#mixed-precision-storage)). Otherwise the
+qualifier is ignored.
+
+The qualifier is removed before all the other passes and the
+corresponding declarations are stored, so that the allocation of these
+fields can call `float_scalar()` etc. */
+
+static void float_declarations (Ast * n, TranslateData * d)
+{
+  if (n == ast_placeholder)
+    return;
+  Ast * specifiers, * type;
+  if (n->sym == sym_declaration_specifiers &&
+      ast_schema (n, sym_declaration_specifiers,
+		  0, sym_type_specifier,
+		  0, sym_types,
+		  0, sym_FLOAT) &&
+      (specifiers = ast_schema (n, sym_declaration_specifiers,
+				1, sym_declaration_specifiers)) &&
+      (type = ast_schema (specifiers, sym_declaration_specifiers,
+			  0, sym_type_specifier,
+			  0, sym_types,
+			  0, sym_TYPEDEF_NAME)) &&
+      ast_is_field (ast_terminal (type)->start)) {
+    Ast * declaration = ast_declaration_from_type (n);
+    stack_push (d->floats, &declaration);
+    ast_replace_child (n->parent, ast_child_index (n), specifiers);
+    n = specifiers;
+  }
+  if (n->child)
+    for (Ast ** c = n->child; *c; c++)
+      float_declarations (*c, d);
+}
+
+/**
+The precision of the fields allocated by a declaration is known at
+compile time (see *field_precision()*). Their values are then accessed
+directly with the right type, for example
+
+~~~literatec
+float scalar T[];
+...
+val(T,0,0,0) = 1.;
+a = val(T,1,0,0);
+~~~
+
+becomes
+
+~~~literatec
+_val_float(T,0,0,0) = _float_store (1.);
+a = _val_float_value(T,1,0,0);
+~~~
+
+and taking the address of a value of `T` is an error.
+
+The precision of the other fields (function arguments, elements of
+lists etc.) is only known at run time. Their values are read as
+doubles, using the `val()`, `fine()` and `coarse()` macros, and their
+assignments (and increments) are transformed, for example
+
+~~~literatec
+val(s,0,0,0) = 1.;
+~~~
+
+becomes
+
+~~~literatec
+(_is_float(s) ? (_val_float(s,0,0,0) = _float_store (1.)) :
+ (_val_double(s,0,0,0) = 1.));
+~~~
+
+while addresses of field values use `_val_ref()`, which checks that
+the field is double precision.
+
+These transformations are done on a copy of the tree, which is only
+used to generate the C code, so that the [interpreter](interpreter/)
+is not affected. */
+
+enum { unknown_precision, single_precision, double_precision };
+
+typedef struct {
+  Ast * call;
+  int precision;
+} FieldAccess;
+
+/* the identifier `s` of field expressions `s`, `s.x`, `s.x.y` etc. */
+static Ast * field_identifier (Ast * n)
+{
+  while (n->child && !n->child[1])
+    n = n->child[0];
+  if (n->sym == sym_IDENTIFIER)
+    return n;
+  if (n->sym == sym_postfix_expression &&
+      n->child[1]->sym == token_symbol('.'))
+    return field_identifier (n->child[0]);
+  return NULL;
+}
+
+static int access_precision (Ast * call, Stack * stack, TranslateData * d)
+{
+  Ast * list = call->child[2];
+  while (list->child[0]->sym == sym_argument_expression_list)
+    list = list->child[0];
+  Ast * identifier = field_identifier (list->child[0]);
+  if (!identifier)
+    return unknown_precision;
+  Ast * declaration = ast_identifier_declaration (stack,
+						  ast_terminal (identifier)->start);
+  FieldPrecision * p;
+  for (int i = 0; (p = stack_index (d->precisions, i)); i++)
+    if (p->identifier == declaration)
+      return p->single ? single_precision : double_precision;
+  return unknown_precision;
+}
+
+/**
+The declarations are looked up in the original tree `n`, while the
+accesses are stored for its copy `copy`. */
+
+static void field_accesses (Ast * n, Ast * copy, Stack * stack,
+			    TranslateData * d, Stack * accesses)
+{
+  if (n == ast_placeholder)
+    return;
+  Ast * scope = ast_push_declarations (n, stack);
+  if (n->sym == sym_function_call) {
+    Ast * identifier = ast_function_call_identifier (n);
+    if (identifier &&
+	(!strcmp (ast_terminal (identifier)->start, "val") ||
+	 !strcmp (ast_terminal (identifier)->start, "fine") ||
+	 !strcmp (ast_terminal (identifier)->start, "coarse"))) {
+      FieldAccess a = { copy, access_precision (n, stack, d) };
+      stack_push (accesses, &a);
+    }
+  }
+  if (n->child)
+    for (Ast ** c = n->child, ** cc = copy->child; *c; c++, cc++)
+      field_accesses (*c, *cc, stack, d, accesses);
+  ast_pop_scope (stack, scope);
+}
+
+static void rename_access (Ast * call, const char * suffix)
+{
+  AstTerminal * t = ast_terminal (ast_function_call_identifier (call));
+  char * name = t->start;
+  t->start = NULL;
+  str_append (t->start, "_", name, suffix);
+  free (name);
+}
+
+static AstTerminal * find_terminal (Ast * n, const char * start)
+{
+  if (n == ast_placeholder)
+    return NULL;
+  AstTerminal * t = ast_terminal (n);
+  if (t)
+    return !strcmp (t->start, start) ? t : NULL;
+  for (Ast ** c = n->child; *c; c++)
+    if ((t = find_terminal (*c, start)))
+      return t;
+  return NULL;
+}
+
+/**
+The values assigned to single precision fields are converted with
+`_float_store()` (see [tree.h](/src/grid/tree.h#mixed-precision)), so
+that `undefined` can be stored. */
+
+static void float_store (Ast * assignment, AstRoot * root)
+{
+  if (!ast_schema (assignment, sym_assignment_expression,
+		   1, sym_assignment_operator,
+		   0, token_symbol('=')))
+    return;
+  Ast * value = assignment->child[2];
+  AstTerminal * left = ast_left_terminal (value);
+  Ast * expr = ast_parse_expression ("_float_store (_value_);", root);
+  ast_set_line (expr, left);
+  char * before = left->before;
+  left->before = NULL;
+  ast_replace (expr, "_value_", value);
+  Ast * store = ast_find (expr, sym_assignment_expression);
+  ast_set_child (assignment, 2, store);
+  left = ast_left_terminal (store);
+  free (left->before), left->before = before;
+  ast_destroy (expr);
+}
+
+static void field_write (Ast * write, Ast * call, AstRoot * root)
+{
+  AstTerminal * t = ast_terminal (ast_function_call_identifier (call));
+  char * name = t->start;
+  t->start = strdup ("_field_write_");
+  Ast * copy = ast_copy (write);
+  AstTerminal * left = ast_left_terminal (copy);
+  free (left->before), left->before = NULL;
+
+  free (t->start), t->start = NULL;
+  str_append (t->start, "_", name, "_float");
+  float_store (write, root);
+  t = find_terminal (copy, "_field_write_");
+  free (t->start), t->start = NULL;
+  str_append (t->start, "_", name, "_double");
+  free (name);
+
+  Ast * expr = ast_parse_expression
+    ("(_is_float(_field_)?(_float_write_):(_double_write_));", root);
+  Ast * list = call->child[2];
+  while (list->child[0]->sym == sym_argument_expression_list)
+    list = list->child[0];
+  ast_replace (expr, "_field_", ast_copy (list->child[0]->child[0]));
+  left = ast_left_terminal (write);
+  ast_set_line (expr, left);
+
+  Ast * parent = write->parent;
+  int index = ast_child_index (write);
+  char * before = left->before;
+  left->before = NULL;
+  ast_replace (expr, "_float_write_", write);
+  ast_replace (expr, "_double_write_", copy);
+  Ast * conditional = ast_find (expr, write->sym);
+  ast_set_child (parent, index, conditional);
+  left = ast_left_terminal (conditional);
+  free (left->before), left->before = before;
+  ast_destroy (expr);
+}
+
+static void mixed_precision (AstRoot * root, AstRoot * copy, TranslateData * d)
+{
+  Stack * accesses = stack_new (sizeof (FieldAccess));
+  stack_push (root->stack, &root);
+  field_accesses ((Ast *) root, (Ast *) copy, root->stack, d, accesses);
+  ast_pop_scope (root->stack, (Ast *) root);
+
+  /**
+  The accesses are processed in reverse order, so that nested
+  assignments are transformed first. */
+
+  FieldAccess * a;
+  for (int i = 0; (a = stack_index (accesses, i)); i++) {
+    Ast * access = a->call->parent, * parent;
+    while ((parent = access->parent) &&
+	   (!parent->child[1] ||
+	    (parent->sym == sym_primary_expression &&
+	     parent->child[0]->sym == token_symbol('('))))
+      access = parent;
+    if (!parent)
+      continue;
+    if (ast_schema (parent, sym_unary_expression,
+		    0, sym_unary_operator,
+		    0, token_symbol('&'))) {
+      if (a->precision == single_precision) {
+	AstTerminal * t = ast_left_terminal (a->call);
+	fprintf (stderr, "%s:%d: error: cannot take the address of "
+		 "a single precision field value\n", t->file, t->line);
+	exit (1);
+      }
+      rename_access (a->call,
+		     a->precision == double_precision ? "_double" : "_ref");
+    }
+    else if ((parent->sym == sym_assignment_expression &&
+	      parent->child[0] == access) ||
+	     (parent->sym == sym_postfix_expression &&
+	      (parent->child[1]->sym == sym_INC_OP ||
+	       parent->child[1]->sym == sym_DEC_OP)) ||
+	     (parent->sym == sym_unary_expression &&
+	      (parent->child[0]->sym == sym_INC_OP ||
+	       parent->child[0]->sym == sym_DEC_OP))) {
+      if (a->precision == unknown_precision)
+	field_write (parent, a->call, copy);
+      else if (a->precision == single_precision) {
+	rename_access (a->call, "_float");
+	float_store (parent, copy);
+      }
+      else
+	rename_access (a->call, "_double");
+    }
+    else if (a->precision != unknown_precision)
+      rename_access (a->call, a->precision == single_precision ?
+		     "_float_value" : "_double");
+  }
+  stack_destroy (accesses);
+}
+
 /**
 # Traversal functions 
 
@@ -5015,7 +5400,7 @@ static void checks (AstRoot * root, AstRoot * d, TranslateData * data)
 void * endfor (FILE * fin, FILE * fout,
 	       const char * grid, int dimension,
 	       bool nolineno, bool progress, bool catch, bool parallel, bool cpu, bool gpu,
-	       FILE * swigfp, char * swigname)
+	       bool mixed, FILE * swigfp, char * swigname)
 {
   char * buffer = NULL;
   size_t len = 0, maxlen = 0;
@@ -5050,6 +5435,7 @@ void * endfor (FILE * fin, FILE * fout,
   TranslateData data = {
     .dimension = dimension, .nolineno = nolineno,
     .parallel = parallel, .cpu = cpu, .gpu = gpu,
+    .mixed = mixed && strstr (grid, "tree"),
     .constants_index = 0, .fields_index = 0, .nboundary = 0,
     // fixme: splitting of events and fields is not used yet
     .init_solver = NULL, .init_events = NULL, .init_fields = NULL,
@@ -5058,6 +5444,9 @@ void * endfor (FILE * fin, FILE * fout,
   data.constants = calloc (1, sizeof (Field));
   data.swigname = swigfp ? swigname : NULL;
   data.functions = stack_new (sizeof (Ast *));
+  data.floats = stack_new (sizeof (Ast *));
+  data.precisions = stack_new (sizeof (FieldPrecision));
+  float_declarations ((Ast *) root, &data);
   
   fp = fopen (BASILISK "/ast/init_solver.h", "r");
   AstRoot * init = ast_parse_file (fp, root);
@@ -5171,8 +5560,20 @@ void * endfor (FILE * fin, FILE * fout,
   checks (root, d, &data);
   
   free (data.constants);
-  
-  ast_print ((Ast *) root, fout, 0);
+
+  if (data.mixed) {
+    AstRoot * copy = (AstRoot *) ast_copy ((Ast *) root);
+    ((Ast *)copy)->parent = NULL;
+    copy->stack = root->stack;
+    mixed_precision (root, copy, &data);
+    copy->stack = NULL;
+    ast_print ((Ast *) copy, fout, 0);
+    ast_destroy ((Ast *) copy);
+  }
+  else
+    ast_print ((Ast *) root, fout, 0);
+  stack_destroy (data.floats);
+  stack_destroy (data.precisions);
 
   ((Ast *)root)->parent = (Ast *) d;
   return root;
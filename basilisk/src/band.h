@@ -0,0 +1,295 @@
+/**
+# Interface narrow band
+
+Most interface-related computations (reconstruction, heights,
+curvature, ...) only need the cells close to the interface defined by
+a volume fraction field. In three-dimensional simulations these
+usually represent only a small fraction of the leaf cells, so that
+looping over the entire grid wastes most of the time.
+
+The *narrow band* of a volume fraction field *c* is the set of
+interfacial cells (as defined below) together with all the leaf cells
+within *halo* cells of them. It is enabled using
+
+~~~literatec
+narrow_band (f);
+~~~
+
+after which `curvature()` only loops over the band. The band is
+stored as a cache of (local) leaf cells which is updated incrementally
+by `vof_advection()` and after adaptation. Maintaining the band has a
+cost which is only recovered if the band is a small fraction of the
+leaves (i.e. not when the mesh is already adapted tightly around the
+interface). This is only implemented on trees, on other grids
+`narrow_band()` does nothing.
+
+## Interfacial cells
+
+We first need to define "interfacial cells" i.e. cells which contain
+an interface. A simple test would just be that the volume fraction is
+neither zero nor one. As usual things are more complicated because of
+round-off errors. They can cause the interface to be exactly aligned
+with cell boundaries, so that cells on either side of this interface
+have fractions exactly equal to zero or one. The function below takes
+this into account. */
+
+static inline bool interfacial (Point point, scalar c)
+{
+  if (c[] >= 1.) {
+    for (int i = -1; i <= 1; i += 2)
+      foreach_dimension()
+	if (c[i] <= 0.)
+	  return true;
+  }
+  else if (c[] <= 0.) {
+    for (int i = -1; i <= 1; i += 2)
+      foreach_dimension()
+	if (c[i] >= 1.)
+	  return true;
+  }
+  else // c[] > 0. && c[] < 1.
+    return true;
+  return false;
+}
+
+/**
+## The band
+
+The band is attached to the volume fraction field. The *version*
+records the version of the tree caches when the band was last updated,
+so that we can tell whether the grid has changed since. */
+
+attribute {
+  void * band; // the Band (if any)
+}
+
+#if TREE
+
+typedef struct {
+  int halo;     // the width of the band around interfacial cells
+  int version;  // the tree version (-1 if the band must be rebuilt)
+  Cache cells;  // the leaf cells of the band
+} Band;
+
+/**
+A temporary flag is used to avoid adding the same cell twice. It is
+reset once the band is built. */
+
+static const unsigned short band_marked = 1 << user;
+
+static void band_append (Point point, Cache * band)
+{
+  if (is_leaf(cell) && is_local(cell) && !(cell.flags & band_marked)) {
+    cell.flags |= band_marked;
+    cache_append (band, point, 0);
+  }
+}
+
+static void band_children (Point point, Cache * band)
+{
+  foreach_child()
+    band_append (point, band);
+}
+
+static Point band_parent (Point point)
+{
+  Point p = point;
+  p.level--;
+  p.i = (point.i + GHOSTS)/2;
+#if dimension >= 2
+  p.j = (point.j + GHOSTS)/2;
+#endif
+#if dimension >= 3
+  p.k = (point.k + GHOSTS)/2;
+#endif
+  return p;
+}
+
+/**
+The band is grown by one cell by adding the leaves overlapping the
+$3^d$ neighborhood of each cell. The neighbors of a leaf are either
+leaves, refined cells (whose children are leaves, since the tree is
+balanced) or prolongation cells (whose parent is a leaf). */
+
+static void band_neighbors (Point point, Cache * band)
+{
+  foreach_neighbor(1)
+    if (allocated(0) && !is_boundary(cell)) {
+      if (is_leaf(cell))
+	band_append (point, band);
+      else if (is_refined(cell))
+	band_children (point, band);
+      else if (is_prolongation(cell))
+	band_append (band_parent (point), band);
+    }
+}
+
+static void band_unmark (Cache * band)
+{
+  for (Index * p = band->p; p < band->p + band->n; p++)
+    index_cell (p)->flags &= ~band_marked;
+}
+
+/**
+When the grid has changed, each cell of the old band is replaced with
+the leaves which now cover it: the cell itself, its leaf descendants
+if it has been refined (possibly by more than one level, e.g. by
+`refine()`), or its closest leaf ancestor if it has been coarsened. */
+
+static void band_leaves (Point point, Cache * band)
+{
+  foreach_child()
+    if (is_leaf(cell))
+      band_append (point, band);
+    else if (is_refined(cell))
+      band_leaves (point, band);
+}
+
+static void band_revalidate (Point point, Cache * band)
+{
+  while (point.level > depth())
+    point = band_parent (point);
+  while (point.level > 0) {
+    Index i = {point.i,
+#if dimension >= 2
+	       point.j,
+#endif
+#if dimension >= 3
+	       point.k,
+#endif
+	       point.level};
+    if (index_allocated (&i) && (is_leaf(cell) || is_refined(cell)))
+      break;
+    point = band_parent (point);
+  }
+  if (is_refined(cell))
+    band_leaves (point, band);
+  else
+    band_append (point, band);
+}
+
+static void band_interfacial (Point point, scalar c, Cache * band)
+{
+  if (interfacial (point, c))
+    band_append (point, band);
+}
+
+/**
+The band is built from a list of *candidates* which must contain all
+the interfacial cells. */
+
+static void band_build (Band * b, scalar c, const Cache * candidates)
+{
+  Cache band = {0};
+  band.nm = max (candidates->n, b->cells.n) + 128;
+  band.p = qmalloc (band.nm, Index);
+  for (Index * p = candidates->p; p < candidates->p + candidates->n; p++)
+    band_interfacial (index_point (p), c, &band);
+  int start = 0;
+  for (int h = 0; h < b->halo; h++) {
+    int end = band.n;
+    for (int i = start; i < end; i++)
+      band_neighbors (index_point (&band.p[i]), &band);
+    start = end;
+  }
+  band_unmark (&band);
+  free (b->cells.p);
+  b->cells = band;
+}
+
+/**
+## Updating the band
+
+The band must be updated each time the volume fraction or the grid
+changes. If the interface moved by less than *halo* cells since the
+last update, all the new interfacial cells are in the old band, so
+that we only need to look for them there. This is the case after each
+VOF advection step (with a CFL smaller than 0.5, the interface moves
+by less than one cell). If the volume fraction field is modified by
+other means (initialisation, `restore()`, ...), `band_reset()` must be
+called, so that the band is rebuilt entirely on the next update.
+
+When the grid has changed, we first revalidate the cells of the old
+band. With MPI, cells can migrate between processes, so we rebuild the
+band entirely.
+
+If the volume fraction has not changed since the last update (*moved*
+is false), the band is only updated if the grid has changed. */
+
+void band_reset (scalar c)
+{
+  Band * b = c.band;
+  if (b)
+    b->version = -1;
+}
+
+trace
+void band_update (scalar c, bool moved = true)
+{
+  Band * b = c.band;
+  if (!b)
+    return;
+  update_cache();
+  if (!moved && b->version == tree->version)
+    return;
+  boundary ({c});
+  if (b->version < 0 || (b->version != tree->version && npe() > 1))
+    band_build (b, c, &tree->leaves);
+  else if (b->version != tree->version) {
+    Cache candidates = {0};
+    candidates.nm = 2*b->cells.n + 128;
+    candidates.p = qmalloc (candidates.nm, Index);
+    for (Index * p = b->cells.p; p < b->cells.p + b->cells.n; p++)
+      band_revalidate (index_point (p), &candidates);
+    band_unmark (&candidates);
+    band_build (b, c, &candidates);
+    free (candidates.p);
+  }
+  else
+    band_build (b, c, &b->cells);
+  b->version = tree->version;
+}
+
+/**
+The cells of the band are traversed using */
+
+@define foreach_band(c) foreach_cache (((Band *)_attribute[(c).i].band)->cells)
+@define end_foreach_band() end_foreach_cache()
+
+/**
+## Enabling the band
+
+The band is freed with the solver. */
+
+static void band_free()
+{
+  for (scalar s in all)
+    if (s.band) {
+      Band * b = s.band;
+      free (b->cells.p);
+      free (b);
+      s.band = NULL;
+    }
+}
+
+void narrow_band (scalar c, int halo = 1)
+{
+  static bool registered = false;
+  if (!registered) {
+    free_solver_func_add (band_free);
+    registered = true;
+  }
+  Band * b = c.band;
+  if (!b)
+    c.band = b = qcalloc (1, Band);
+  b->halo = max (halo, 1);
+  b->version = -1;
+}
+
+#else // !TREE
+
+void narrow_band (scalar c, int halo = 1) {}
+void band_reset (scalar c) {}
+void band_update (scalar c, bool moved = true) {}
+
+#endif // !TREE
@@ -0,0 +1,121 @@
+/**
+# Per-bubble statistics
+
+This module computes, for each bubble (or droplet) defined by a VOF
+tracer *f*, its volume, center of mass, mean velocity, interfacial
+area and the radius of its contact line on the `bottom` boundary. The
+bubbles are identified using [tag()](tag.h) and all the statistics are
+then obtained in a single pass over the grid, using array
+reductions (which also take care of the parallel reduction by tag).
+
+It is typically called in a logging event, at a much higher frequency
+than the snapshots i.e.
+
+~~~literatec
+event logBubbles (t += 1e-4) {
+  Bubble * b = NULL;
+  int n = bubble_stats (f, u, &b);
+  bubble_stats_output (stdout, t, b, n);
+  free (b);
+}
+~~~
+*/
+
+#include "fractions.h"
+#include "tag.h"
+
+typedef struct {
+  double volume;   // the volume of the bubble
+  coord centroid;  // its center of mass
+  coord velocity;  // its mean velocity
+  double area;     // the area of its interface
+  double contact;  // the radius of its contact line (zero if none)
+} Bubble;
+
+/**
+The bubbles are the connected regions where the volume fraction
+$1 - f$ is larger than *threshold* (or where $f$ is larger than
+*threshold* for droplets, if *bubbles* is false). The function returns
+the number of bubbles, their statistics are stored in `*b`, which is
+(re)allocated and must be freed by the caller. The bubbles are indexed
+by tag value (minus one).
+
+The contact line is defined by the cells touching the `bottom`
+boundary. Its "radius" is that of the disc (in 3D) or the half-length
+of the segment (in 2D) which has the same area as the part of the
+boundary wetted by the bubble (as estimated by the volume fractions of
+the cells). */
+
+trace
+int bubble_stats (scalar f, vector u, Bubble ** b,
+		  double threshold = 1e-4, bool bubbles = true)
+{
+  scalar t[];
+  foreach()
+    t[] = (bubbles ? 1. - f[] : f[]) > threshold;
+  int n = tag (t);
+  *b = realloc (*b, max (n, 1)*sizeof (Bubble));
+  if (n == 0)
+    return 0;
+
+  reconstruction_update (f);
+  double * volume = qcalloc (n, double), * area = qcalloc (n, double);
+  double * contact = qcalloc (n, double);
+  coord * centroid = qcalloc (n, coord), * velocity = qcalloc (n, coord);
+  foreach (reduction(+:volume[:n]) reduction(+:area[:n])
+	   reduction(+:contact[:n]) reduction(+:centroid[:n])
+	   reduction(+:velocity[:n]))
+    if (t[] > 0) {
+      int j = t[] - 1;
+      double c = clamp (bubbles ? 1. - f[] : f[], 0., 1.), dc = c*dv();
+      coord o = {x, y, z};
+      volume[j] += dc;
+      foreach_dimension() {
+	centroid[j].x += dc*o.x;
+	velocity[j].x += dc*u.x[];
+      }
+      if (f[] > 1e-6 && f[] < 1. - 1e-6) {
+	coord m = reconstruction_normal (point, f), p;
+	double alpha = plane_alpha (f[], m);
+	area[j] += pow(Delta, dimension - 1)*plane_area_center (m, alpha, &p);
+      }
+      if (y < Y0 + Delta)
+	contact[j] += c*pow(Delta, dimension - 1);
+    }
+
+  for (int j = 0; j < n; j++) {
+    Bubble * p = &(*b)[j];
+    p->volume = volume[j];
+    foreach_dimension() {
+      p->centroid.x = volume[j] > 0. ? centroid[j].x/volume[j] : 0.;
+      p->velocity.x = volume[j] > 0. ? velocity[j].x/volume[j] : 0.;
+    }
+    p->area = area[j];
+#if dimension == 3
+    p->contact = sqrt (contact[j]/pi);
+#else
+    p->contact = contact[j]/2.;
+#endif
+  }
+  free (volume), free (area), free (contact);
+  free (centroid), free (velocity);
+  return n;
+}
+
+/**
+This writes one line per bubble: the time *t*, its index, volume,
+centroid, velocity, interfacial area and contact line radius. */
+
+void bubble_stats_output (FILE * fp, double t, const Bubble * b, int n)
+{
+  for (int j = 0; j < n; j++) {
+    const Bubble * p = &b[j];
+    fprintf (fp, "%g %d %g", t, j + 1, p->volume);
+    foreach_dimension()
+      fprintf (fp, " %g", p->centroid.x);
+    foreach_dimension()
+      fprintf (fp, " %g", p->velocity.x);
+    fprintf (fp, " %g %g\n", p->area, p->contact);
+  }
+  fflush (fp);
+}
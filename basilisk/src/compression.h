@@ -0,0 +1,201 @@
+/**
+# Compression of arrays
+
+These functions are used to write [compressed
+snapshots](output.h#compressed-snapshots), but are independent of
+Basilisk and can be used for any array.
+
+## Byte shuffling
+
+The bytes of an array of *n* elements of *size* bytes are regrouped
+so that the first bytes of all elements come first, then the second
+bytes etc. For arrays of floating-point numbers or of integers which
+vary slowly, this gives long sequences of identical bytes (e.g. the
+signs and exponents) which are easily compressed. */
+
+void byte_shuffle (const void * in, void * out, size_t n, size_t size)
+{
+  const unsigned char * a = in;
+  unsigned char * b = out;
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < size; j++)
+      b[j*n + i] = a[i*size + j];
+}
+
+void byte_unshuffle (const void * in, void * out, size_t n, size_t size)
+{
+  const unsigned char * a = in;
+  unsigned char * b = out;
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < size; j++)
+      b[i*size + j] = a[j*n + i];
+}
+
+/**
+## Lempel-Ziv compression
+
+This is a simple and fast [LZ77](https://en.wikipedia.org/wiki/LZ77_and_LZ78)
+codec. The compressed stream is a sequence of literal runs, each
+followed by a match (a copy of previous bytes). The lengths and
+offsets are written as variable-length integers (seven bits per
+byte).
+
+Matches are found using a hash table of the positions of the last
+occurrence of each four-byte sequence, within a window of
+`LZ_WINDOW` bytes. Matches shorter than `LZ_MIN` bytes are ignored
+so that the compressed stream is never (much) larger than the
+input. The compressed size is at most `lz_bound (n)`. */
+
+#define LZ_HASH   16
+#define LZ_WINDOW (1 << 20)
+#define LZ_MIN    8
+
+size_t lz_bound (size_t n)
+{
+  return n + n/64 + 32;
+}
+
+static unsigned char * lz_put (unsigned char * o, size_t v)
+{
+  while (v >= 128) {
+    *o++ = (v & 127) | 128;
+    v >>= 7;
+  }
+  *o++ = v;
+  return o;
+}
+
+static const unsigned char * lz_get (const unsigned char * i,
+				     const unsigned char * end, size_t * v)
+{
+  *v = 0;
+  for (int shift = 0; i < end && shift < 64; shift += 7) {
+    unsigned char c = *i++;
+    *v |= (size_t) (c & 127) << shift;
+    if (!(c & 128))
+      return i;
+  }
+  return NULL;
+}
+
+static inline unsigned lz_hash (const unsigned char * p)
+{
+  unsigned v = p[0] | p[1] << 8 | p[2] << 16 | (unsigned) p[3] << 24;
+  return (v*2654435761u) >> (32 - LZ_HASH);
+}
+
+/**
+Compresses the *n* bytes of *in* into *out* (of size at least
+`lz_bound (n)`) and returns the compressed size. */
+
+size_t lz_compress (const void * in, size_t n, void * out)
+{
+  const unsigned char * a = in;
+  unsigned char * o = out;
+  size_t * table = (size_t *) calloc (1 << LZ_HASH, sizeof(size_t));
+  size_t i = 0, anchor = 0;
+  while (i + LZ_MIN <= n) {
+    unsigned h = lz_hash (a + i);
+    size_t ref = table[h]; // position + 1 of the last occurrence
+    table[h] = i + 1;
+    if (ref && i + 1 - ref <= LZ_WINDOW) {
+      ref--;
+      size_t len = 0;
+      while (i + len < n && a[ref + len] == a[i + len])
+	len++;
+      if (len >= LZ_MIN) {
+	o = lz_put (o, i - anchor);
+	memcpy (o, a + anchor, i - anchor), o += i - anchor;
+	o = lz_put (o, len - LZ_MIN);
+	o = lz_put (o, i - ref);
+	i += len, anchor = i;
+	continue;
+      }
+    }
+    i++;
+  }
+  o = lz_put (o, n - anchor);
+  memcpy (o, a + anchor, n - anchor), o += n - anchor;
+  free (table);
+  return o - (unsigned char *) out;
+}
+
+/**
+Decompresses the *size* bytes of *in* into the *n* bytes of
+*out*. Returns `false` if the stream is corrupted. */
+
+bool lz_decompress (const void * in, size_t size, void * out, size_t n)
+{
+  const unsigned char * i = in, * end = i + size;
+  unsigned char * o = out;
+  size_t op = 0;
+  while (op < n) {
+    size_t len, off;
+    if (!(i = lz_get (i, end, &len)) || len > n - op || len > end - i)
+      return false;
+    memcpy (o + op, i, len), i += len, op += len;
+    if (op == n)
+      break;
+    if (!(i = lz_get (i, end, &len)) || !(i = lz_get (i, end, &off)))
+      return false;
+    len += LZ_MIN;
+    if (!off || off > op || len > n - op)
+      return false;
+    for (size_t j = 0; j < len; j++, op++) // matches can overlap
+      o[op] = o[op - off];
+  }
+  return true;
+}
+
+/**
+## Error-bounded quantization
+
+Each of the *n* values of *in* is replaced by the nearest multiple of
+2 *tolerance*, so that the absolute error is at most
+*tolerance*. The multiples are predicted from the previous value and
+the (zigzag-encoded) differences are stored in *out*: for smooth
+fields they are small integers, which compress well once shuffled.
+
+Values which cannot be quantized (e.g. `nodata` or undefined values)
+are escaped: their code is `QUANTIZE_ESCAPE` and their exact value
+is appended to *out*, after the *n* codes. The function returns the
+total number of elements of *out* (which must be of size at least
+2 *n*). */
+
+#define QUANTIZE_ESCAPE (~0UL)
+#define QUANTIZE_MAX    (1L << 50)
+
+size_t quantize (const double * in, size_t n, double tolerance,
+		 unsigned long * out)
+{
+  size_t m = n;
+  long prev = 0;
+  for (size_t i = 0; i < n; i++) {
+    double q = in[i]/(2.*tolerance);
+    if (q > - QUANTIZE_MAX && q < QUANTIZE_MAX) { // also false for NaNs
+      long v = llround (q), d = v - prev;
+      out[i] = d >= 0 ? 2*(unsigned long) d : 2*(unsigned long) (- d) - 1;
+      prev = v;
+    }
+    else {
+      out[i] = QUANTIZE_ESCAPE;
+      memcpy (&out[m++], &in[i], sizeof(double));
+    }
+  }
+  return m;
+}
+
+void dequantize (const unsigned long * in, size_t n, double tolerance,
+		 double * out)
+{
+  const unsigned long * escaped = in + n;
+  long prev = 0;
+  for (size_t i = 0; i < n; i++)
+    if (in[i] == QUANTIZE_ESCAPE)
+      memcpy (&out[i], escaped++, sizeof(double));
+    else {
+      long d = in[i] & 1 ? - (long) ((in[i] + 1)/2) : (long) (in[i]/2);
+      prev += d;
+      out[i] = 2.*tolerance*prev;
+    }
+}
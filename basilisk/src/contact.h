@@ -40,20 +40,26 @@ Note that strictly speaking this should be done for each
 [sweep](vof.h#sweep_x) of the direction-split VOF advection, which we
 do not do here i.e. we use the normal at the beginning of the timestep
 and assume it is constant during each sweep. This seems to work
-fine. */
+fine. Since the normal depends on the height functions, the [cached
+reconstruction](fractions.h#reconstruction_cache) (if any) must also
+be invalidated. */
 
 extern scalar * interfaces;
 
 event init (i = 0) {
   for (scalar c in interfaces)
-    if (c.height.x.i)
+    if (c.height.x.i) {
       heights (c, c.height);
+      reconstruction_reset (c);
+    }
 }
 
 event vof (i++) {
   for (scalar c in interfaces)
-    if (c.height.x.i)
+    if (c.height.x.i) {
       heights (c, c.height);
+      reconstruction_reset (c);
+    }
 }
 
 /**
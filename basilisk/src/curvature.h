@@ -493,32 +493,10 @@ static double centroids_curvature_fit (Point point, scalar c)
 /**
 ## General curvature computation
 
-We first need to define "interfacial cells" i.e. cells which contain
-an interface. A simple test would just be that the volume fraction is
-neither zero nor one. As usual things are more complicated because of
-round-off errors. They can cause the interface to be exactly aligned
-with cell boundaries, so that cells on either side of this interface
-have fractions exactly equal to zero or one. The function below takes
-this into account. */
-
-static inline bool interfacial (Point point, scalar c)
-{
-  if (c[] >= 1.) {
-    for (int i = -1; i <= 1; i += 2)
-      foreach_dimension()
-	if (c[i] <= 0.)
-	  return true;
-  }
-  else if (c[] <= 0.) {
-    for (int i = -1; i <= 1; i += 2)
-      foreach_dimension()
-	if (c[i] >= 1.)
-	  return true;
-  }
-  else // c[] > 0. && c[] < 1.
-    return true;
-  return false;
-}
+We use the definition of "interfacial cells" of the [narrow
+band](band.h). */
+
+#include "band.h"
 
 /**
 The function below computes the mean curvature *kappa* of the
@@ -528,7 +506,10 @@ which each method is returned in a *cstats* data structure.
 
 The curvature is multiplied by *sigma* (default is one).
 
-If *add* is *true*, the curvature is added to field *kappa*. */
+If *add* is *true*, the curvature is added to field *kappa*.
+
+If a [narrow band](band.h) is defined for *c*, only the cells of the
+band are traversed. */
 
 typedef struct {
   int h; // number of standard HF curvatures
@@ -537,6 +518,73 @@ typedef struct {
   int c; // number of centroids fit curvatures
 } cstats;
 
+#if dimension > 1
+
+/**
+The temporary curvature *k* is computed first. The function returns
+the method used (1 for standard HF, 2 for parabolic fit and 0 if it
+failed). */
+
+static int temporary_curvature (Point point, scalar c, vector h, scalar k)
+{
+
+  /**
+  If we are not in an interfacial cell, we set $\kappa$ to *nodata*. */
+
+  if (!interfacial (point, c)) {
+    k[] = nodata;
+    return 0;
+  }
+
+  /**
+  Otherwise we try the standard HF curvature calculation first, and
+  the "mixed heights" HF curvature second. */ 
+
+  if ((k[] = height_curvature (point, c, h)) != nodata)
+    return 1;
+  if ((k[] = height_curvature_fit (point, c, h)) != nodata)
+    return 2;
+  return 0;
+}
+
+/**
+We then construct the final curvature field. The method used is
+returned in *m* (1 for the average, 2 for centroids). */
+
+static double final_curvature (Point point, scalar c, scalar k, int * m)
+{
+
+  /**
+  We use either the computed temporary curvature... */
+
+  *m = 0;
+  if (k[] < nodata)
+    return k[];
+  if (!interfacial (point, c))
+    return nodata;
+
+  /**
+  ...or the average of the curvatures in the $3^{d}$ neighborhood
+  of interfacial cells. */
+      
+  double sk = 0., a = 0.;
+  foreach_neighbor(1)
+    if (k[] < nodata)
+      sk += k[], a++;
+  if (a > 0.) {
+    *m = 1;
+    return sk/a;
+  }
+
+  /**
+  Empty neighborhood: we try centroids as a last resort. */
+
+  *m = 2;
+  return centroids_curvature_fit (point, c);
+}
+
+#endif // dimension > 1
+
 trace
 cstats curvature (scalar c, scalar kappa,
 		  double sigma = 1.[0], bool add = false)
@@ -553,9 +601,14 @@ cstats curvature (scalar c, scalar kappa,
 #endif
 
 #if dimension > 1
+
+  /**
+  We use the height function associated with *c* (if any). If it is
+  [updated incrementally](heights.h#incremental_heights), we first
+  make sure that it is up to date. */
   
   vector ch = c.height, h = automatic (ch);
-  if (!ch.x.i)
+  if (!ch.x.i || c.hcache)
     heights (c, h);
 
   /**
@@ -565,54 +618,55 @@ cstats curvature (scalar c, scalar kappa,
   scalar k[];
   scalar_clone (k, kappa);
 
-  foreach(reduction(+:sh) reduction(+:sf)) {
+#if TREE
+  if (c.band) {
 
     /**
-    If we are not in an interfacial cell, we set $\kappa$ to *nodata*. */
-
-    if (!interfacial (point, c))
-      k[] = nodata;
+    With a narrow band, the curvature is *nodata* outside the band
+    and we only compute it for the cells of the band. As the band
+    contains the neighborhood of interfacial cells, this gives the
+    same result as the loops over the entire grid below. Boundary
+    conditions are not applied automatically by `foreach_band()`. */
+
+    band_update (c, moved = false);
+    boundary ({c});
+    boundary ((scalar *){h});
+    scalar ka = kappa;
+    if (add) {
+      ka = new scalar;
+      foreach_band (c)
+	ka[] = kappa[];
+    }
+    reset ({k, kappa}, nodata);
+    foreach_band (c, reduction(+:sh) reduction(+:sf)) {
+      int m = temporary_curvature (point, c, h, k);
+      sh += m == 1, sf += m == 2;
+    }
+    k.dirty = true;
+    boundary ({k});
+    foreach_band (c, reduction(+:sa) reduction(+:sc)) {
+      int m;
+      double kf = final_curvature (point, c, k, &m);
+      sa += m == 1, sc += m == 2;
+      if (kf != nodata)
+	kappa[] = add ? ka[] + sigma*kf : sigma*kf;
+    }
+    kappa.dirty = true;
+    if (add)
+      delete ({ka});
+    return (cstats){sh, sf, sa, sc};
+  }
+#endif // TREE
 
-    /**
-    Otherwise we try the standard HF curvature calculation first, and
-    the "mixed heights" HF curvature second. */ 
-    
-    else if ((k[] = height_curvature (point, c, h)) != nodata)
-      sh++;
-    else if ((k[] = height_curvature_fit (point, c, h)) != nodata)
-      sf++;
+  foreach(reduction(+:sh) reduction(+:sf)) {
+    int m = temporary_curvature (point, c, h, k);
+    sh += m == 1, sf += m == 2;
   }
   
   foreach (reduction(+:sa) reduction(+:sc)) {
-    
-    /**
-    We then construct the final curvature field using either the
-    computed temporary curvature... */
-
-    double kf;
-    if (k[] < nodata)
-      kf = k[];
-    else if (interfacial (point, c)) {
-
-      /**
-      ...or the average of the curvatures in the $3^{d}$ neighborhood
-      of interfacial cells. */
-      
-      double sk = 0., a = 0.;
-      foreach_neighbor(1)
-	if (k[] < nodata)
-	  sk += k[], a++;
-      if (a > 0.)
-	kf = sk/a, sa++;
-      else
-
-	/**
-	Empty neighborhood: we try centroids as a last resort. */
-
-	kf = centroids_curvature_fit (point, c), sc++;
-    }
-    else
-      kf = nodata;
+    int m;
+    double kf = final_curvature (point, c, k, &m);
+    sa += m == 1, sc += m == 2;
 
     /**
     We add or set *kappa*. */
@@ -747,7 +801,7 @@ void position (scalar f, scalar pos,
 
 #if dimension > 1  
   vector fh = f.height, h = automatic (fh);
-  if (!fh.x.i)
+  if (!fh.x.i || f.hcache)
     heights (f, h);
   foreach() {
     if (interfacial (point, f)) {
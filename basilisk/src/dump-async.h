@@ -0,0 +1,251 @@
+/**
+# Asynchronous snapshots
+
+`dump_async()` takes the same arguments as [dump()](output.h#dump)
+(except *fp* and *unbuffered*). The file is first built in memory,
+which is fast (and collective in parallel), and is then written by a
+background thread while the computation continues.
+
+A file cannot be written again before the previous write completes:
+in that case `dump_async()` waits for the previous write. The file is
+written as *file~* and renamed to *file* once it is complete and
+synced to disk, so that *file* is always either the previous snapshot
+or the new one, never a partial file. `dump_async_wait()` waits for
+all pending writes. It is called automatically at the end of the run
+(when the solver is freed). If the program exits before (e.g. by
+calling `exit()`), the pending writes are still completed but, in
+parallel, they are left as *file~*.
+
+In parallel, these functions must be called by all processes, with
+the same arguments, but the background threads do not use MPI (each
+process writes its part of the file independently). The processes
+agree on the files completed by all of them (using a reduction) at
+the next call to `dump_async()` or `dump_async_wait()`, and these
+files are then renamed. In serial, the file is renamed by the
+background thread as soon as it is complete.
+
+The errors of the background threads are reported (by the main
+thread) at the same time.
+
+Each pending write holds a copy of the dumped fields in memory.
+
+~~~literatec
+#include "dump-async.h"
+...
+event snapshots (t += 0.1) {
+  char name[80];
+  sprintf (name, "snapshot-%g", t);
+  dump_async (name);
+}
+~~~
+*/
+
+@include <pthread.h>
+@include <unistd.h>
+@include <errno.h>
+#pragma autolink -lpthread
+
+typedef struct {
+  char * file, * name; // the final and temporary file names
+  pthread_t thread;
+  bool done;
+  int error; // the error number of a failed write
+#if _MPI
+  DumpImage img;
+#else
+  DumpSink o;
+#endif
+} DumpAsync;
+
+static struct {
+  DumpAsync ** p;
+  int n;
+  pthread_mutex_t mutex;
+  pthread_cond_t done;
+  bool registered;
+} dump_pending = {NULL, 0, PTHREAD_MUTEX_INITIALIZER,
+		  PTHREAD_COND_INITIALIZER, false};
+
+static void * dump_async_write (void * data)
+{
+  DumpAsync * d = data;
+  int error = 0;
+#if _MPI
+  FILE * fp = fopen (d->name, "r+");
+#else
+  FILE * fp = fopen (d->name, "w");
+#endif
+  if (!fp)
+    error = errno;
+  else {
+#if _MPI
+    char * buf = d->img.buf;
+    for (long i = 0; i < d->img.n && !error; i++) {
+      if (fseek (fp, d->img.offset[i], SEEK_SET) < 0 ||
+	  fwrite (buf, 1, d->img.length[i], fp) < d->img.length[i])
+	error = errno;
+      buf += d->img.length[i];
+    }
+#else
+    if (fwrite (d->o.buf, 1, d->o.len, fp) < d->o.len)
+      error = errno;
+#endif
+    if ((fflush (fp) || fsync (fileno (fp)) || fclose (fp)) && !error)
+      error = errno;
+  }
+#if !_MPI
+  if (!error && rename (d->name, d->file))
+    error = errno;
+#endif
+  pthread_mutex_lock (&dump_pending.mutex);
+  d->error = error;
+  d->done = true;
+  pthread_cond_broadcast (&dump_pending.done);
+  pthread_mutex_unlock (&dump_pending.mutex);
+  return NULL;
+}
+
+/**
+Frees a completed write, reporting its error (if any). In parallel,
+the file is renamed if it has been written successfully by all the
+processes. */
+
+static void dump_async_error (DumpAsync * d)
+{
+  if (d->error)
+    fprintf (stderr, "dump_async(): error while writing '%s': %s\n",
+	     d->name, strerror (d->error));
+}
+
+static void dump_async_free (DumpAsync * d)
+{
+  pthread_join (d->thread, NULL);
+  dump_async_error (d);
+  int error = d->error;
+#if _MPI
+  mpi_all_reduce (error, MPI_INT, MPI_MAX);
+  if (!error && pid() == 0 && rename (d->name, d->file)) {
+    perror (d->file);
+    error = 1;
+  }
+  dump_image_free (&d->img);
+#else
+  free (d->o.buf);
+#endif
+  if (error)
+    exit (1);
+  free (d->file), free (d->name), free (d);
+}
+
+/**
+Frees the pending writes which have completed (on all processes), as
+well as the writes to *file* (if not `NULL`) or all the writes (if
+*all* is true), which are waited for. The threads are only joined by
+*dump_async_free()*. */
+
+static void dump_async_update (const char * file, bool all)
+{
+  int n = 0, done[max (dump_pending.n, 1)];
+  pthread_mutex_lock (&dump_pending.mutex);
+  for (int i = 0; i < dump_pending.n; i++) {
+    DumpAsync * d = dump_pending.p[i];
+    if (all || (file && !strcmp (d->file, file)))
+      while (!d->done)
+	pthread_cond_wait (&dump_pending.done, &dump_pending.mutex);
+    done[i] = d->done;
+  }
+  pthread_mutex_unlock (&dump_pending.mutex);
+#if _MPI
+  if (dump_pending.n)
+    MPI_Allreduce (MPI_IN_PLACE, done, dump_pending.n, MPI_INT, MPI_MIN,
+		   MPI_COMM_WORLD);
+#endif
+  for (int i = 0; i < dump_pending.n; i++)
+    if (done[i])
+      dump_async_free (dump_pending.p[i]);
+    else
+      dump_pending.p[n++] = dump_pending.p[i];
+  if (!(dump_pending.n = n))
+    free (dump_pending.p), dump_pending.p = NULL;
+}
+
+/**
+Waits for all pending writes. */
+
+void dump_async_wait (void)
+{
+  dump_async_update (NULL, true);
+#if _MPI
+  MPI_Barrier (MPI_COMM_WORLD);
+#endif
+}
+
+/**
+If the program exits before the end of the run, the pending writes
+are completed and their errors reported. This cannot call `exit()`
+again nor, in parallel, agree with the other processes (which may
+not be exiting), so the files are not renamed. */
+
+static void dump_async_exit (void)
+{
+  for (int i = 0; i < dump_pending.n; i++) {
+    DumpAsync * d = dump_pending.p[i];
+    pthread_join (d->thread, NULL);
+    dump_async_error (d);
+#if _MPI
+    if (!d->error)
+      fprintf (stderr, "dump_async(): '%s' was not renamed to '%s'\n",
+	       d->name, d->file);
+#endif
+  }
+  dump_pending.n = 0;
+}
+
+trace
+void dump_async (const char * file = "dump",
+		 scalar * list = all,
+		 bool compress = false,
+		 bool blocks = false)
+{
+  dump_async_update (file, false);
+
+  DumpAsync * d = (DumpAsync *) calloc (1, sizeof(DumpAsync));
+  d->file = strdup (file);
+  d->name = (char *) malloc (strlen(file) + 2);
+  strcpy (d->name, file);
+  strcat (d->name, "~");
+#if _MPI
+  dump_image (&d->img, list, compress, blocks);
+
+  /**
+  The previous write to *file* has completed (and has been renamed),
+  the temporary file is created before the processes write their
+  parts. */
+
+  if (pid() == 0) {
+    FILE * fp = fopen (d->name, "w");
+    if (!fp) {
+      perror (d->name);
+      exit (1);
+    }
+    fclose (fp);
+  }
+  MPI_Barrier (MPI_COMM_WORLD);
+#else
+  dump_sink_init (&d->o, NULL);
+  dump_cells (&d->o, list, compress, blocks);
+#endif
+  
+  if (pthread_create (&d->thread, NULL, dump_async_write, d)) {
+    perror ("dump_async(): could not create thread");
+    exit (1);
+  }
+  dump_pending.p = (DumpAsync **)
+    realloc (dump_pending.p, (dump_pending.n + 1)*sizeof(DumpAsync *));
+  dump_pending.p[dump_pending.n++] = d;
+  if (!dump_pending.registered) {
+    free_solver_func_add (dump_async_wait);
+    atexit (dump_async_exit);
+    dump_pending.registered = true;
+  }
+}
@@ -0,0 +1,407 @@
+/* Random-access reader for Basilisk dump files
+ *
+ * See dumpmap.h and the description of the file formats in
+ * ../output.h.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../compression.h"
+#include "dumpmap.h"
+
+/* must match output.h */
+
+typedef struct {
+  double t;
+  long len;
+  int i, depth, npe, version;
+  double n[3];
+} DumpHeader;
+
+typedef struct {
+  double tolerance;
+  long size, usize;
+} DumpBlock;
+
+#define RECORDS    170901
+#define BLOCKS     250301
+#define COMPRESSED 250302
+#define SEGMENT    65536
+#define LEAF       (1 << 1)
+
+static DumpMap * error (DumpMap * m, const char * file, const char * message)
+{
+  fprintf (stderr, "dumpmap_open(): %s: %s\n", file, message);
+  dumpmap_close (m);
+  return NULL;
+}
+
+static bool read_map (DumpMap * m, long * pos, void * data, size_t size)
+{
+  if (*pos + size > m->mapsize)
+    return false;
+  memcpy (data, m->map + *pos, size);
+  *pos += size;
+  return true;
+}
+
+/* Decompresses block b of segment s into out (which must be large
+   enough for 2*SEGMENT doubles). Returns the number of cells of the
+   segment or -1 on error. */
+
+static long segment_block (DumpMap * m, long s, int b, void * out)
+{
+  long pos = m->soffset[s], header[2];
+  if (!read_map (m, &pos, header, sizeof(header)) ||
+      header[0] != m->sfirst[s] || header[1] > SEGMENT || header[1] < 1 ||
+      header[0] + header[1] > m->n)
+    return -1;
+  for (int i = 0; i < b; i++) {
+    DumpBlock block;
+    if (!read_map (m, &pos, &block, sizeof(DumpBlock)))
+      return -1;
+    pos += block.size;
+  }
+  DumpBlock block;
+  size_t size = b ? sizeof(double) : sizeof(unsigned);
+  if (!read_map (m, &pos, &block, sizeof(DumpBlock)) ||
+      block.usize > 2*SEGMENT*sizeof(double) ||
+      block.size > lz_bound (block.usize) ||
+      pos + block.size > m->mapsize ||
+      !lz_decompress (m->map + pos, block.size, m->tmp, block.usize))
+    return -1;
+  if (block.tolerance > 0.) {
+    byte_unshuffle (m->tmp, m->tmp1, block.usize/size, size);
+    dequantize ((unsigned long *) m->tmp1, header[1], block.tolerance, out);
+  }
+  else
+    byte_unshuffle (m->tmp, out, header[1], size);
+  return header[1];
+}
+
+static int compare_segments (const void * a, const void * b)
+{
+  const long * p = a, * q = b;
+  return p[0] < q[0] ? -1 : p[0] > q[0];
+}
+
+/* Reads the segment table and decompresses the flags and subtree
+   sizes of all cells. */
+
+static bool open_segments (DumpMap * m)
+{
+  long pos = m->mapsize - sizeof(long);
+  if (pos < m->start || !read_map (m, &pos, &m->nseg, sizeof(long)) ||
+      m->nseg < 1 || m->nseg > m->n ||
+      (pos = m->mapsize - (m->nseg + 1)*sizeof(long)) < m->start)
+    return false;
+  long * s = malloc (2*m->nseg*sizeof(long));
+  for (long i = 0; i < m->nseg; i++) {
+    long offset = 0, p;
+    read_map (m, &pos, &offset, sizeof(long));
+    p = offset;
+    if (offset < m->start || !read_map (m, &p, &s[2*i], sizeof(long))) {
+      free (s);
+      return false;
+    }
+    s[2*i + 1] = offset;
+  }
+  qsort (s, m->nseg, 2*sizeof(long), compare_segments);
+  m->sfirst = malloc (m->nseg*sizeof(long));
+  m->soffset = malloc (m->nseg*sizeof(long));
+  for (long i = 0; i < m->nseg; i++)
+    m->sfirst[i] = s[2*i], m->soffset[i] = s[2*i + 1];
+  free (s);
+
+  m->tmp = malloc (2*SEGMENT*sizeof(double));
+  m->tmp1 = malloc (2*SEGMENT*sizeof(double));
+  m->values = malloc (SEGMENT*m->nfields*sizeof(double));
+  m->flags = malloc (m->n*sizeof(unsigned));
+  m->size = malloc (m->n*sizeof(double));
+  long n = 0;
+  for (long i = 0; i < m->nseg; i++) {
+    if (m->sfirst[i] != n)
+      return false;
+    long count = segment_block (m, i, 0, m->flags + n);
+    if (count < 0 || segment_block (m, i, 1, m->size + n) != count)
+      return false;
+    n += count;
+  }
+  return n == m->n;
+}
+
+DumpMap * dumpmap_open (const char * file)
+{
+  int fd = open (file, O_RDONLY);
+  if (fd < 0) {
+    perror (file);
+    return NULL;
+  }
+  struct stat sb;
+  if (fstat (fd, &sb) < 0) {
+    perror (file);
+    close (fd);
+    return NULL;
+  }
+  DumpMap * m = calloc (1, sizeof(DumpMap));
+  m->cseg = -1;
+  m->mapsize = sb.st_size;
+  m->map = mmap (NULL, m->mapsize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (m->map == MAP_FAILED) {
+    m->map = NULL;
+    perror (file);
+    dumpmap_close (m);
+    return NULL;
+  }
+
+  DumpHeader header;
+  long pos = 0;
+  if (!read_map (m, &pos, &header, sizeof(DumpHeader)) ||
+      header.len < 1 || header.len > 1 << 16)
+    return error (m, file, "expecting header");
+  if (header.version != RECORDS && header.version != BLOCKS &&
+      header.version != COMPRESSED)
+    return error (m, file, "unknown file format");
+  if (header.n[0] > 0)
+    return error (m, file, "multigrid MPI dumps are not supported");
+  m->t = header.t, m->i = header.i, m->depth = header.depth;
+  m->version = header.version;
+
+  m->nfields = header.len;
+  m->names = calloc (m->nfields, sizeof(char *));
+  for (int i = 0; i < m->nfields; i++) {
+    unsigned len;
+    if (!read_map (m, &pos, &len, sizeof(unsigned)) ||
+	pos + len > m->mapsize)
+      return error (m, file, "expecting field name");
+    m->names[i] = malloc (len + 1);
+    read_map (m, &pos, m->names[i], len);
+    m->names[i][len] = '\0';
+  }
+  if (strcmp (m->names[0], "size"))
+    return error (m, file, "expecting 'size' as first field");
+  double o[4];
+  if (!read_map (m, &pos, o, sizeof(o)))
+    return error (m, file, "expecting origin");
+  for (int i = 0; i < 3; i++)
+    m->origin[i] = o[i];
+  m->L0 = o[3];
+
+  if (m->version == RECORDS) {
+    m->start = pos;
+    m->n = (m->mapsize - pos)/(sizeof(unsigned) + m->nfields*sizeof(double));
+  }
+  else {
+    if (!read_map (m, &pos, &m->n, sizeof(long)) || m->n < 1)
+      return error (m, file, "expecting the number of cells");
+    m->start = (pos + 7)/8*8;
+    if (m->version == BLOCKS &&
+	m->start + (m->n*sizeof(unsigned) + 7)/8*8 +
+	m->nfields*m->n*sizeof(double) > m->mapsize)
+      return error (m, file, "file is truncated");
+    if (m->version == COMPRESSED && !open_segments (m))
+      return error (m, file, "corrupted segments");
+  }
+  if (m->n < 1 || dumpmap_size (m, 0) != m->n)
+    return error (m, file, "inconsistent number of cells");
+
+  /* The dimension is given by the number of children of the root
+     cell (all the children of a non-leaf cell are stored). */
+
+  if (!dumpmap_leaf (m, 0)) {
+    long index = 1, nc = 0;
+    while (index < m->n) {
+      long size = dumpmap_size (m, index);
+      if (size < 1)
+	return error (m, file, "inconsistent subtree size");
+      index += size, nc++;
+    }
+    if (index != m->n || (nc != 2 && nc != 4 && nc != 8))
+      return error (m, file, "inconsistent subtree size");
+    m->dimension = nc == 2 ? 1 : nc == 4 ? 2 : 3;
+  }
+  return m;
+}
+
+void dumpmap_close (DumpMap * m)
+{
+  if (!m)
+    return;
+  if (m->map)
+    munmap ((void *) m->map, m->mapsize);
+  if (m->names)
+    for (int i = 0; i < m->nfields; i++)
+      free (m->names[i]);
+  free (m->names);
+  free (m->flags), free (m->size), free (m->values);
+  free (m->sfirst), free (m->soffset);
+  free (m->tmp), free (m->tmp1);
+  free (m);
+}
+
+int dumpmap_field (const DumpMap * m, const char * name)
+{
+  for (int i = 0; i < m->nfields; i++)
+    if (!strcmp (m->names[i], name))
+      return i;
+  return -1;
+}
+
+bool dumpmap_leaf (DumpMap * m, long index)
+{
+  unsigned flags;
+  if (m->flags)
+    flags = m->flags[index];
+  else if (m->version == RECORDS)
+    memcpy (&flags, m->map + m->start +
+	    index*(sizeof(unsigned) + m->nfields*sizeof(double)),
+	    sizeof(unsigned));
+  else
+    memcpy (&flags, m->map + m->start + index*sizeof(unsigned),
+	    sizeof(unsigned));
+  return flags & LEAF;
+}
+
+long dumpmap_size (DumpMap * m, long index)
+{
+  return m->size ? m->size[index] : dumpmap_value (m, index, 0);
+}
+
+double dumpmap_value (DumpMap * m, long index, int field)
+{
+  double v;
+  if (m->version == RECORDS)
+    memcpy (&v, m->map + m->start +
+	    index*(sizeof(unsigned) + m->nfields*sizeof(double)) +
+	    sizeof(unsigned) + field*sizeof(double), sizeof(double));
+  else if (m->version == BLOCKS)
+    memcpy (&v, m->map + m->start + (m->n*sizeof(unsigned) + 7)/8*8 +
+	    (field*m->n + index)*sizeof(double), sizeof(double));
+  else {
+    if (m->cseg < 0 || index < m->sfirst[m->cseg] ||
+	(m->cseg < m->nseg - 1 && index >= m->sfirst[m->cseg + 1])) {
+      long s = 0, e = m->nseg - 1;
+      while (s < e) {
+	long c = (s + e + 1)/2;
+	if (m->sfirst[c] <= index)
+	  s = c;
+	else
+	  e = c - 1;
+      }
+      for (int b = 1; b <= m->nfields; b++)
+	if (segment_block (m, s, b, m->values + (b - 1)*SEGMENT) < 0) {
+	  fprintf (stderr, "dumpmap_value(): corrupted segment\n");
+	  exit (1);
+	}
+      m->cseg = s;
+    }
+    v = m->values[field*SEGMENT + index - m->sfirst[m->cseg]];
+  }
+  return v;
+}
+
+/* Traversal */
+
+static long traverse (DumpMap * m, DumpCell * c, DumpCellFunc func,
+		      void * data)
+{
+  long next = c->index + dumpmap_size (m, c->index);
+  c->leaf = dumpmap_leaf (m, c->index);
+  if (func (m, c, data) && !c->leaf) {
+    DumpCell child = {c->index + 1, c->level + 1};
+    child.delta = c->delta/2.;
+    for (int k = 0; k < 1 << m->dimension && child.index < next; k++) {
+
+      /* the children are stored in the order of foreach_child() i.e.
+	 with the x index varying slowest */
+
+      int d = m->dimension, ci = (k >> (d - 1)) & 1;
+      int cj = d > 1 ? (k >> (d - 2)) & 1 : 0, ck = d > 2 ? k & 1 : 0;
+      child.i = 2*c->i + ci, child.j = 2*c->j + cj, child.k = 2*c->k + ck;
+      child.x = m->origin[0] + (child.i + 0.5)*child.delta;
+      child.y = d > 1 ? m->origin[1] + (child.j + 0.5)*child.delta : 0.;
+      child.z = d > 2 ? m->origin[2] + (child.k + 0.5)*child.delta : 0.;
+      child.index = traverse (m, &child, func, data);
+    }
+  }
+  return next;
+}
+
+void dumpmap_traverse (DumpMap * m, DumpCellFunc func, void * data)
+{
+  DumpCell root = {0};
+  root.delta = m->L0;
+  root.x = m->origin[0] + m->L0/2.;
+  root.y = m->dimension > 1 ? m->origin[1] + m->L0/2. : 0.;
+  root.z = m->dimension > 2 ? m->origin[2] + m->L0/2. : 0.;
+  traverse (m, &root, func, data);
+}
+
+/* Queries */
+
+typedef struct {
+  DumpCell * cells;
+  long n, size;
+  int axis, field;
+  double min, max;
+} Query;
+
+static void query_add (Query * q, const DumpCell * c)
+{
+  if (q->n == q->size) {
+    q->size = q->size ? 2*q->size : 256;
+    q->cells = realloc (q->cells, q->size*sizeof(DumpCell));
+  }
+  q->cells[q->n++] = *c;
+}
+
+static bool plane (DumpMap * m, const DumpCell * c, void * data)
+{
+  Query * q = data;
+  if (fabs ((&c->x)[q->axis] - q->min) > c->delta/2.)
+    return false;
+  if (c->leaf)
+    query_add (q, c);
+  return true;
+}
+
+long dumpmap_plane (DumpMap * m, int axis, double c, DumpCell ** cells)
+{
+  Query q = {NULL, 0, 0, axis};
+  q.min = c;
+  if (axis >= 0 && axis < m->dimension)
+    dumpmap_traverse (m, plane, &q);
+  *cells = q.cells;
+  return q.n;
+}
+
+static bool range (DumpMap * m, const DumpCell * c, void * data)
+{
+  Query * q = data;
+  if (c->leaf) {
+    double v = dumpmap_value (m, c->index, q->field);
+    if (v > q->min && v < q->max)
+      query_add (q, c);
+  }
+  return true;
+}
+
+long dumpmap_range (DumpMap * m, int field, double min, double max,
+		    DumpCell ** cells)
+{
+  Query q = {NULL, 0, 0, 0, field, min, max};
+  if (field >= 0 && field < m->nfields)
+    dumpmap_traverse (m, range, &q);
+  *cells = q.cells;
+  return q.n;
+}
@@ -0,0 +1,87 @@
+/* Random-access reader for Basilisk dump files
+ *
+ * A dump file (written by dump() in output.h) is memory-mapped and
+ * queried directly, without rebuilding the grid. The cells are
+ * stored in the order of foreach_cell() (i.e. depth-first, in
+ * Z-order) and the first field of the file is the size of the
+ * subtree of each cell, so that entire subtrees can be skipped.
+ *
+ * The three formats of dump() are supported: the record format
+ * (version 170901), the block format (250301) and the compressed
+ * format (250302). For compressed files, the flags and subtree sizes
+ * of all cells are decompressed when the file is opened and the
+ * values of the fields are decompressed on demand, one segment at a
+ * time.
+ *
+ * Example:
+ *
+ *   DumpMap * m = dumpmap_open ("snapshot");
+ *   int f = dumpmap_field (m, "f");
+ *   DumpCell * cells;
+ *   long n = dumpmap_plane (m, 0, 0.1, &cells);
+ *   for (long i = 0; i < n; i++)
+ *     printf ("%g %g %g %g\n", cells[i].x, cells[i].y, cells[i].z,
+ *             dumpmap_value (m, cells[i].index, f));
+ *   free (cells);
+ *   dumpmap_close (m);
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef struct _DumpMap DumpMap;
+
+struct _DumpMap {
+  double t;             /* the time */
+  int i;                /* the iteration */
+  int depth;            /* the maximum level */
+  int dimension;        /* inferred from the tree structure */
+  int version;          /* the format of the file */
+  long n;               /* the number of cells */
+  int nfields;          /* the number of fields (including the subtree size) */
+  char ** names;        /* the names of the fields */
+  double origin[3], L0; /* the domain */
+
+  /* private */
+  const char * map;
+  size_t mapsize;
+  long start;
+  unsigned * flags;     /* for compressed files */
+  double * size;
+  long nseg, * sfirst, * soffset, cseg;
+  double * values;      /* the values of the current segment */
+  char * tmp, * tmp1;
+};
+
+/* A cell: its (global) index in the file, level and integer
+   coordinates, center and size. */
+
+typedef struct {
+  long index;
+  int level, i, j, k;
+  double x, y, z, delta;
+  bool leaf;
+} DumpCell;
+
+DumpMap * dumpmap_open   (const char * file);
+void      dumpmap_close  (DumpMap * m);
+int       dumpmap_field  (const DumpMap * m, const char * name);
+bool      dumpmap_leaf   (DumpMap * m, long index);
+long      dumpmap_size   (DumpMap * m, long index);
+double    dumpmap_value  (DumpMap * m, long index, int field);
+
+/* Depth-first traversal of the cells. If func() returns false, the
+   children of the cell are skipped. */
+
+typedef bool (* DumpCellFunc) (DumpMap * m, const DumpCell * c, void * data);
+void dumpmap_traverse (DumpMap * m, DumpCellFunc func, void * data);
+
+/* Queries: the leaf cells matching the query are returned in *cells
+   (which must be freed by the caller), the function returns their
+   number. */
+
+/* leaves intersecting the plane (x, y or z for axis 0, 1 or 2) = c */
+long dumpmap_plane (DumpMap * m, int axis, double c, DumpCell ** cells);
+/* leaves for which min < field < max */
+long dumpmap_range (DumpMap * m, int field, double min, double max,
+		    DumpCell ** cells);
@@ -0,0 +1,106 @@
+/* Queries a Basilisk dump file
+ *
+ * Usage:
+ *   dumpquery file                       prints the header of the file
+ *   dumpquery file plane x|y|z c [fields...]
+ *   dumpquery file range field min max [fields...]
+ *
+ * For queries, prints the center and size of each leaf cell matching
+ * the query, followed by the values of the given fields (all the
+ * fields by default).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dumpmap.h"
+
+static int usage (const char * name)
+{
+  fprintf (stderr,
+	   "Usage: %s file\n"
+	   "       %s file plane x|y|z c [fields...]\n"
+	   "       %s file range field min max [fields...]\n",
+	   name, name, name);
+  return 1;
+}
+
+int main (int argc, char * argv[])
+{
+  if (argc < 2)
+    return usage (argv[0]);
+
+  DumpMap * m = dumpmap_open (argv[1]);
+  if (!m)
+    return 1;
+
+  if (argc == 2) {
+    printf ("version: %d\n"
+	    "t: %g\n"
+	    "i: %d\n"
+	    "depth: %d\n"
+	    "dimension: %d\n"
+	    "cells: %ld\n"
+	    "origin: %g %g %g\n"
+	    "L0: %g\n"
+	    "fields:",
+	    m->version, m->t, m->i, m->depth, m->dimension, m->n,
+	    m->origin[0], m->origin[1], m->origin[2], m->L0);
+    for (int i = 0; i < m->nfields; i++)
+      printf (" %s", m->names[i]);
+    printf ("\n");
+    dumpmap_close (m);
+    return 0;
+  }
+
+  DumpCell * cells;
+  long n;
+  int first;
+  if (!strcmp (argv[2], "plane") && argc >= 5 &&
+      strlen (argv[3]) == 1 && strchr ("xyz", argv[3][0])) {
+    n = dumpmap_plane (m, argv[3][0] - 'x', atof (argv[4]), &cells);
+    first = 5;
+  }
+  else if (!strcmp (argv[2], "range") && argc >= 6) {
+    int f = dumpmap_field (m, argv[3]);
+    if (f < 0) {
+      fprintf (stderr, "%s: unknown field '%s'\n", argv[0], argv[3]);
+      dumpmap_close (m);
+      return 1;
+    }
+    n = dumpmap_range (m, f, atof (argv[4]), atof (argv[5]), &cells);
+    first = 6;
+  }
+  else {
+    dumpmap_close (m);
+    return usage (argv[0]);
+  }
+
+  int nf = argc > first ? argc - first : m->nfields - 1, fields[nf];
+  for (int i = 0; i < nf; i++)
+    if (argc > first) {
+      if ((fields[i] = dumpmap_field (m, argv[first + i])) < 0) {
+	fprintf (stderr, "%s: unknown field '%s'\n", argv[0], argv[first + i]);
+	free (cells);
+	dumpmap_close (m);
+	return 1;
+      }
+    }
+    else
+      fields[i] = i + 1;
+
+  printf ("# 1:x 2:y 3:z 4:delta");
+  for (int i = 0; i < nf; i++)
+    printf (" %d:%s", i + 5, m->names[fields[i]]);
+  printf ("\n");
+  for (long i = 0; i < n; i++) {
+    printf ("%g %g %g %g", cells[i].x, cells[i].y, cells[i].z, cells[i].delta);
+    for (int j = 0; j < nf; j++)
+      printf (" %g", dumpmap_value (m, cells[i].index, fields[j]));
+    printf ("\n");
+  }
+  free (cells);
+  dumpmap_close (m);
+  return 0;
+}
@@ -0,0 +1,59 @@
+/**
+# dumpquery and restore()
+
+A small adaptive tree is dumped in each format of
+[dump()](/src/output.h#dump): records (170901), blocks (250301) and
+compressed (250302). Each file is then restored and the leaf cells
+matching the `plane y 0.1` and `range f 0 1` queries of
+[dumpquery](dumpquery.c) are printed, in the same format. The `check`
+target of the Makefile compares them with the output of dumpquery. */
+
+#include "utils.h"
+#include "fractions.h"
+
+scalar f[];
+vector u[];
+
+static void query (const char * file)
+{
+  char name[80];
+  sprintf (name, "%s.plane.restore", file);
+  FILE * fp = fopen (name, "w");
+  fprintf (fp, "# 1:x 2:y 3:z 4:delta 5:f 6:u.x 7:u.y\n");
+  foreach (serial)
+    if (fabs (y - 0.1) <= Delta/2.)
+      fprintf (fp, "%g %g %g %g %g %g %g\n", x, y, 0., Delta, f[], u.x[], u.y[]);
+  fclose (fp);
+
+  sprintf (name, "%s.range.restore", file);
+  fp = fopen (name, "w");
+  fprintf (fp, "# 1:x 2:y 3:z 4:delta 5:f 6:u.x 7:u.y\n");
+  foreach (serial)
+    if (f[] > 0. && f[] < 1.)
+      fprintf (fp, "%g %g %g %g %g %g %g\n", x, y, 0., Delta, f[], u.x[], u.y[]);
+  fclose (fp);
+}
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  init_grid (16);
+  refine (level < 8 && fabs (sq(x) + sq(y) - sq(0.3)) < 0.02);
+  fraction (f, sq(0.3) - sq(x) - sq(y));
+  foreach() {
+    u.x[] = sin(2.*pi*x)*cos(2.*pi*y);
+    u.y[] = - cos(2.*pi*x)*sin(2.*pi*y);
+  }
+
+  dump (file = "170901", list = {f, u});
+  dump (file = "250301", list = {f, u}, blocks = true);
+  dump (file = "250302", list = {f, u}, compress = true);
+
+  char * files[] = {"170901", "250301", "250302"};
+  for (int i = 0; i < 3; i++) {
+    init_grid (1);
+    assert (restore (file = files[i], list = {f, u}));
+    query (files[i]);
+  }
+}
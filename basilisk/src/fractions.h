@@ -411,6 +411,47 @@ coord youngs_normal (Point point, scalar c)
   return n;
 }
 
+/**
+### Cached reconstruction
+
+Computing the interface normal can be expensive (for example when
+using [height functions](contact.h)). The reconstruction can thus be
+stored in persistent fields attached to the volume fraction (see
+[below](#reconstruction_cache)). The *rversion* records the version of
+the grid when it was computed, or is -1 if the volume fraction has
+changed since. */
+
+attribute {
+  vector rn;     // the cached interface normal (if any)
+  scalar ralpha; // the cached intercept
+  int rversion;  // the grid version of the cached reconstruction
+}
+
+static inline bool reconstruction_valid (scalar c)
+{
+#if TREE
+  return c.ralpha.i && c.rversion == tree->version;
+#else
+  return c.ralpha.i && c.rversion == 0;
+#endif
+}
+
+/**
+The cached normal is used if it is valid, otherwise it is
+recomputed. */
+
+coord reconstruction_normal (Point point, scalar c)
+{
+  if (reconstruction_valid (c) && c[] > 0. && c[] < 1.) {
+    vector n = c.rn;
+    coord m;
+    foreach_dimension()
+      m.x = n.x[];
+    return m;
+  }
+  return interface_normal (point, c);
+}
+
 /**
 ### Normal approximation using MYC or face fractions
 */
@@ -432,7 +473,7 @@ coord facet_normal (Point point, scalar c, face vector s)
 	n.x = 1./dimension;
     return n;
   }
-  return interface_normal (point, c);
+  return reconstruction_normal (point, c);
 }
 
 /**
@@ -488,6 +529,64 @@ void reconstruction (const scalar c, vector n, scalar alpha)
 #endif
 }
 
+/**
+<div id="reconstruction_cache"></div>
+
+The reconstruction of a volume fraction field is cached using
+
+~~~literatec
+reconstruction_cache (f);
+~~~
+
+It is then computed at most once for a given volume fraction and grid
+and shared by the [VOF sweeps](vof.h), `output_facets()`,
+`interface_area()` and all the functions using
+`facet_normal()`. The VOF sweeps invalidate the cache each time they
+modify the volume fraction. If it is modified by other means
+(initialisation, `restore()`, ...) or if the function used to compute
+the normal depends on other fields (for example height functions),
+`reconstruction_reset()` must be called. */
+
+void reconstruction_cache (scalar c)
+{
+  if (!c.ralpha.i) {
+    vector n = new vector;
+    scalar alpha = new scalar;
+    foreach_dimension()
+      n.x.nodump = true;
+    alpha.nodump = true;
+    c.rn = n, c.ralpha = alpha;
+  }
+  c.rversion = -1;
+}
+
+void reconstruction_reset (scalar c)
+{
+  c.rversion = -1;
+}
+
+/**
+This function updates the cached reconstruction if necessary. It
+returns `false` if the reconstruction of *c* is not cached. */
+
+trace
+bool reconstruction_update (scalar c)
+{
+  if (!c.ralpha.i)
+    return false;
+#if TREE
+  update_cache();
+  int version = tree->version;
+#else
+  int version = 0;
+#endif
+  if (c.rversion != version) {
+    reconstruction (c, c.rn, c.ralpha);
+    c.rversion = version;
+  }
+  return true;
+}
+
 /**
 ## Interface output
 
@@ -504,11 +603,14 @@ If `s` is specified, the surface fractions are used to compute the
 interface normals which leads to a continuous interface representation
 in most cases. Otherwise the interface normals are approximated from
 the volume fraction field, which results in a piecewise continuous
-(i.e. geometric VOF) interface representation. */
+(i.e. geometric VOF) interface representation, using the [cached
+reconstruction](#reconstruction_cache) if any. */
 
 trace
 void output_facets (scalar c, FILE * fp = stdout, face vector s = {{-1}})
 {
+  if (s.x.i < 0)
+    reconstruction_update (c);
   foreach (serial)
     if (c[] > 1e-6 && c[] < 1. - 1e-6) {
       coord n = facet_normal (point, c, s);
@@ -544,10 +646,11 @@ using its VOF reconstruction. */
 trace
 double interface_area (scalar c)
 {
+  reconstruction_update (c);
   double area = 0.;
   foreach (reduction(+:area))
     if (c[] > 1e-6 && c[] < 1. - 1e-6) {
-      coord n = interface_normal (point, c), p;
+      coord n = reconstruction_normal (point, c), p;
       double alpha = plane_alpha (c[], n);
       area += pow(Delta, dimension - 1)*plane_area_center (n, alpha, &p);
     }
@@ -5,7 +5,12 @@ typedef struct {
   int pid;
 } NewPid;
 
-#define NEWPID() ((NewPid *)&val(newpid,0,0,0))
+#if MIXED_PRECISION
+// newpid is always stored in double precision (see tree.h)
+# define NEWPID() ((NewPid *)&_val_double(newpid,0,0,0))
+#else
+# define NEWPID() ((NewPid *)&val(newpid,0,0,0))
+#endif
 
 @if TRASH
 @ define is_newpid() (!isnan(val(newpid,0,0,0)) && NEWPID()->pid > 0)
@@ -13,6 +18,17 @@ typedef struct {
 @ define is_newpid() (NEWPID()->pid > 0)
 @endif
 
+static void append_cell (Array * a, Point point, size_t size)
+{
+#if TREE_SOA
+  array_append (a, &cell, sizeof(Cell));
+  for (int i = 0; i < (size - sizeof(Cell))/sizeof(real); i++)
+    array_append (a, &cell_val ((char *) &cell, i), sizeof(real));
+#else
+  array_append (a, &cell, size);
+#endif
+}
+
 Array * linear_tree (size_t size, scalar newpid)
 {
   const unsigned short sent = 1 << user, next = 1 << (user + 1);  
@@ -25,7 +41,7 @@ Array * linear_tree (size_t size, scalar newpid)
   bool empty = true;
   foreach_cell_all() {
     if (cell.flags & sent) {
-      array_append (a, &cell, size);
+      append_cell (a, point, size);
       cell.flags &= ~sent;
       empty = false;
     }
@@ -83,9 +99,11 @@ Array * linear_tree (size_t size, scalar newpid)
 	  (!is_newpid() || !NEWPID()->leaf))
 	/* refined */
 	refine_cell (point, _list, 0, NULL);
-      else if (!cell.neighbors)
+      else if (!cell.neighbors) {
 	/* prolongation */
+	tree_changed (point);
 	alloc_children (point);
+      }
     }
     else
       continue;
@@ -130,19 +148,21 @@ Array * neighborhood (scalar newpid, int nextpid, FILE * fp)
       continue;
   }
 
-  return linear_tree (sizeof(Cell) + datasize, newpid);
+  return linear_tree (sizeof(Cell) + fieldsize, newpid);
 }
 
-static void send_tree (Array * a, int to, MPI_Request * r)
+/* The functions below return true if cells are moved. The cells whose
+   process changes are then marked with tree_changed(). */
+
+static bool send_tree (Array * a, int to, MPI_Request * r)
 {
   MPI_Isend (&a->len, 1, MPI_LONG, to, MOVED_TAG(), MPI_COMM_WORLD, &r[0]);
-  if (a->len > 0) {
+  if (a->len > 0)
     MPI_Isend (a->p, a->len, MPI_BYTE, to, MOVED_TAG(), MPI_COMM_WORLD, &r[1]);
-    tree->dirty = true;
-  }
+  return a->len > 0;
 }
 
-static void receive_tree (int from, scalar newpid, FILE * fp)
+static bool receive_tree (int from, scalar newpid, FILE * fp)
 {
   Array a;
   mpi_recv_check (&a.len, 1, MPI_LONG, from, MOVED_TAG(),
@@ -154,9 +174,14 @@ static void receive_tree (int from, scalar newpid, FILE * fp)
     mpi_recv_check (a.p, a.len, MPI_BYTE, from, MOVED_TAG(),
 		    MPI_COMM_WORLD, MPI_STATUS_IGNORE, "receive_tree (p)");
     //    const unsigned short next = 1 << (user + 1);
-    foreach_tree (&a, sizeof(Cell) + datasize, NULL) {
+    foreach_tree (&a, sizeof(Cell) + fieldsize, NULL) {
+#if TREE_SOA
+      for (int i = 0; i < datasize/sizeof(real); i++)
+	cell_val ((char *) &cell, i) = ((real *)(c + 1))[i];
+#else
       memcpy (((char *)&cell) + sizeof(Cell), ((char *)c) + sizeof(Cell),
-	      datasize);
+	      fieldsize);
+#endif
       assert (NEWPID()->pid > 0);
       if (fp)
 	fprintf (fp, "%g %g %g %d %d %d %d %d %d recv\n",
@@ -165,8 +190,8 @@ static void receive_tree (int from, scalar newpid, FILE * fp)
 		 cell.flags & leaf, from, NEWPID()->leaf);
     }
     free (a.p);
-    tree->dirty = true;
   }
+  return a.len > 0;
 }
 
 static void wait_tree (Array * a, MPI_Request * r)
@@ -176,6 +201,32 @@ static void wait_tree (Array * a, MPI_Request * r)
     MPI_Wait (&r[1], MPI_STATUS_IGNORE);
 }
 
+/* sends cells to their destination processes (which can be any
+   process, see mpi.imbalance) and receives cells from any process */
+static bool send_receive_trees (scalar newpid, int * dest, FILE * fp)
+{
+  bool moved = false;
+  int src[npe()];
+  dest[pid()] = false;
+  MPI_Alltoall (dest, 1, MPI_INT, src, 1, MPI_INT, MPI_COMM_WORLD);
+  Array * a[npe()];
+  MPI_Request r[npe()][2];
+  for (int i = 0; i < npe(); i++)
+    if (dest[i]) {
+      a[i] = neighborhood (newpid, i, fp);
+      moved |= send_tree (a[i], i, r[i]);
+    }
+  for (int i = 0; i < npe(); i++)
+    if (src[i])
+      moved |= receive_tree (i, newpid, fp);
+  for (int i = 0; i < npe(); i++)
+    if (dest[i]) {
+      wait_tree (a[i], r[i]);
+      array_free (a[i]);
+    }
+  return moved;
+}
+
 static void check_flags()
 {
 #if DEBUG_MPI
@@ -187,16 +238,159 @@ static void check_flags()
 #endif
 }
 
+/**
+## Weighted balancing
+
+By default, each process receives the same number of cells (or
+leaves). If `mpi.cost` is set to a scalar field, the Z-ordered cells
+are instead split so that each process receives the same total
+cost. The cost of a cell is the value of this field (the field needs
+to be restricted by the user if `mpi.leaves` is `false`). For
+example, to give interfacial cells ten times the weight of bulk cells
+
+~~~literatec
+scalar cost[];
+...
+mpi.cost = cost;
+...
+event adapt (i++) {
+  foreach()
+    cost[] = f[] > 1e-6 && f[] < 1. - 1e-6 ? 10. : 1.;
+  adapt_wavelet (...);
+}
+~~~
+
+If `mpi.timed` is `true`, the cost is also measured: before
+balancing, `mpi_boundary_update()` scales the cost of the cells of
+each process so that their sum is the time spent by this process
+outside of MPI calls since the last update. The relative costs of the
+cells of a given process are preserved, and the cost field (which is
+allocated automatically if `mpi.cost` is not set) follows the cells
+when they are moved to another process.
+
+Cells can only move to the previous or next process at each call of
+`balance()` (which is called repeatedly by `mpi_boundary_update()`
+until the partition is stable). If `mpi.imbalance` is positive and
+the maximum load of a process is larger than `mpi.imbalance` times
+the average load, this constraint is lifted and cells are sent
+directly to their destination. */
+
 struct {
-  int  min;    // minimum number of points per process
-  bool leaves; // balance leaves only
+  int  min;         // minimum number of points per process
+  bool leaves;      // balance leaves only
+  scalar cost;      // the cost of each cell (optional)
+  bool timed;       // measure the cost
+  double imbalance; // lift the "nearest neighbour" constraint above this
   
   int npe; // number of active processes
 } mpi = {
   1,
-  true
+  true,
+  {-1},
+  false,
+  0.
 };
 
+/**
+`z_cost()` is the weighted equivalent of
+[`z_indexing()`](/src/grid/tree-mpi.h#z_indexing-fills-index-with-the-z-ordering-index):
+it fills `index` with the total cost of the cells which precede each
+cell in Z-order and returns the total cost. */
+
+static double z_cost (scalar index, scalar cost, bool leaves)
+{
+
+  /**
+  The cost of each subtree is obtained by restriction, as in
+  `subtree_size()`. */
+  
+  scalar size[];
+  foreach()
+    size[] = cost[];
+  boundary_iterate (restriction, {size}, depth());
+  for (int l = depth() - 1; l >= 0; l--) {
+    foreach_coarse_level(l) {
+      double sum = leaves ? 0. : cost[];
+      foreach_child()
+	sum += size[];
+      size[] = sum;
+    }
+    boundary_iterate (restriction, {size}, l);
+  }
+
+  double total = 0.;
+  if (pid() == 0)
+    foreach_level(0, serial)
+      total = size[];
+  mpi_all_reduce (total, MPI_DOUBLE, MPI_SUM);
+
+  foreach_level(0)
+    index[] = 0.;
+  for (int l = 0; l < depth(); l++) {
+    boundary_iterate (restriction, {index}, l);
+    foreach_cell() {
+      if (level == l) {
+	if (is_leaf(cell)) {
+	  if (is_local(cell) && cell.neighbors) {
+	    double i = index[];
+	    foreach_child()
+	      index[] = i;
+	  }
+	}
+	else { // not leaf
+	  bool loc = is_local(cell);
+	  if (!loc)
+	    foreach_child()
+	      if (is_local(cell)) {
+		loc = true; break;
+	      }
+	  if (loc) {
+	    double i = index[] + (leaves ? 0. : cost[]);
+	    foreach_child() {
+	      index[] = i;
+	      i += size[]; 
+	    }
+	  }
+	}
+	continue; // level == l
+      }
+      if (is_leaf(cell))
+	continue;
+    }
+  }
+  boundary_iterate (restriction, {index}, depth());
+
+  return total;
+}
+
+static int weighted_pid (double index, double total, int nproc)
+{
+  return min(nproc - 1, (int) (index*nproc/total));
+}
+
+static void balance_timed()
+{
+  static timer t;
+  static bool started = false;
+  if (mpi.cost.i < 0) {
+    scalar cost = new scalar;
+    foreach()
+      cost[] = 1.;
+    mpi.cost = cost;
+  }
+  if (started) {
+    scalar cost = mpi.cost;
+    double elapsed = timer_elapsed (t) - (mpi_time - t.tm), sum = 0.;
+    foreach (serial)
+      sum += cost[];
+    if (sum > 0. && elapsed > 0.)
+      foreach()
+	cost[] *= elapsed/sum;
+  }
+  t = timer_start();
+  started = true;
+}
+
 trace
 bool balance()
 {
@@ -207,12 +401,20 @@ bool balance()
 
   check_flags();
 
+  bool weighted = mpi.cost.i >= 0;
+  scalar cost = mpi.cost;
   long nl = 0, nt = 0;
+  double c = 0., cmax = 0.;
   foreach_cell() {
     if (is_local(cell)) {
       nt++;
       if (is_leaf(cell))
 	nl++;
+      if (weighted && (!mpi.leaves || is_leaf(cell))) {
+	c += cost[];
+	if (cost[] > cmax)
+	  cmax = cost[];
+      }
     }
     if (is_leaf(cell))
       continue;
@@ -240,13 +442,37 @@ bool balance()
   else
     mpi.npe = npe();
 
-  if (nmax - nmin <= 1)
+  /**
+  The load of each process is either its number of cells or its
+  cost. There is nothing to do if the difference between the maximum
+  and minimum loads is less than the load of a single cell. */
+
+  double loadmax = nmax, total = grid->tn;
+  if (weighted) {
+    double a[3] = {c, - c, cmax}; // maximum and minimum loads, maximum cost
+    MPI_Allreduce (MPI_IN_PLACE, a, 3, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    if (a[0] + a[1] <= a[2])
+      return false;
+    loadmax = a[0], total = c;
+    mpi_all_reduce (total, MPI_DOUBLE, MPI_SUM);
+  }
+  else if (nmax - nmin <= 1)
     return false;
+
+  /**
+  Cells can move to any process if the imbalance is large enough. */
+
+  bool clamped = !(mpi.imbalance > 0. &&
+		   loadmax > mpi.imbalance*total/mpi.npe);
   
   scalar newpid[];
-  double zn = z_indexing (newpid, mpi.leaves);
-  if (pid() == 0)
-    assert (zn + 1 == nt);
+  if (weighted)
+    total = z_cost (newpid, cost, mpi.leaves);
+  else {
+    double zn = z_indexing (newpid, mpi.leaves);
+    if (pid() == 0)
+      assert (zn + 1 == nt);
+  }
   
   FILE * fp = NULL;
 #ifdef DEBUGCOND
@@ -259,10 +485,16 @@ bool balance()
 
   // compute new pid, stored in newpid[]
   bool next = false, prev = false;
+  int * dest = clamped ? NULL : qcalloc (npe(), int);
   foreach_cell_all() {
     if (is_local(cell)) {
-      int pid = balanced_pid (newpid[], nt, mpi.npe);
-      pid = clamp (pid, cell.pid - 1, cell.pid + 1);
+      int pid = weighted ?
+	weighted_pid (newpid[], total, mpi.npe) :
+	balanced_pid (newpid[], nt, mpi.npe);
+      if (clamped)
+	pid = clamp (pid, cell.pid - 1, cell.pid + 1);
+      else
+	dest[pid] = true;
       if (pid == pid() + 1)
 	next = true;
       else if (pid == pid() - 1)
@@ -302,6 +534,13 @@ bool balance()
   }
 #endif // DEBUGCOND
   
+  bool moved = false;
+  if (!clamped) {
+    moved = send_receive_trees (newpid, dest, fp);
+    free (dest);
+    next = prev = false; // the exchanges below are empty
+  }
+  
   Array * anext = next ? neighborhood (newpid, pid() + 1, fp) : array_new();
   Array * aprev = prev ? neighborhood (newpid, pid() - 1, fp) : array_new();
 
@@ -313,15 +552,15 @@ bool balance()
   // send mesh to previous/next process
   MPI_Request rprev[2], rnext[2];
   if (pid() > 0)
-    send_tree (aprev, pid() - 1, rprev);
+    moved |= send_tree (aprev, pid() - 1, rprev);
   if (pid() < npe() - 1)
-    send_tree (anext, pid() + 1, rnext);
+    moved |= send_tree (anext, pid() + 1, rnext);
 
   // receive mesh from next/previous process
   if (pid() < npe() - 1)
-    receive_tree (pid() + 1, newpid, fp);
+    moved |= receive_tree (pid() + 1, newpid, fp);
   if (pid() > 0)
-    receive_tree (pid() - 1, newpid, fp);
+    moved |= receive_tree (pid() - 1, newpid, fp);
 
   /* check that mesh was received OK and free send buffers */
   if (pid() > 0)
@@ -344,6 +583,7 @@ bool balance()
 		   x, y, z, NEWPID()->pid - 1, cell.pid,
 		   is_leaf(cell), cell.neighbors, NEWPID()->leaf);
 	if (cell.pid != NEWPID()->pid - 1) {
+	  tree_changed (point);
 	  cell.pid = NEWPID()->pid - 1;
 	  cell.flags &= ~(active|border);
 	  if (is_local(cell))
@@ -353,19 +593,23 @@ bool balance()
 	if (NEWPID()->leaf && !is_leaf(cell) && cell.neighbors)
 	  coarsen_cell_recursive (point, NULL);
       }
-      else if (level > 0 && ((NewPid *)&coarse(newpid))->leaf)
+      else if (level > 0 && ((NewPid *)&coarse(newpid))->leaf &&
+	       cell.pid != aparent(0).pid) {
+	tree_changed (point);
 	cell.pid = aparent(0).pid;
+      }
     }
     // cleanup unused prolongations
     if (!cell.neighbors && allocated_child(0)) {
       if (fp)
 	fprintf (fp, "%g %g %g %d %d freechildren\n",
 		 x, y, z, NEWPID()->pid - 1, cell.pid);
+      tree_changed (point);
       free_children (point);
     }
   }
 
-  if (tree->dirty || pid_changed) {
+  if (moved || tree->dirty || pid_changed) {
 #if 1
     // update active cells: fixme: can this be done above
     foreach_cell_post (!is_leaf (cell))
@@ -375,6 +619,8 @@ bool balance()
 	  if (is_active(cell)) {
 	    flags |= active; break;
 	  }
+	if (flags != cell.flags)
+	  tree_changed (point);
 	cell.flags = flags;
       }
 #endif
@@ -394,6 +640,8 @@ bool balance()
 
 void mpi_boundary_update (scalar * list)
 {
+  if (mpi.timed)
+    balance_timed();
   mpi_boundary_update_buffers();
   for (scalar s in list)
     s.dirty = true;
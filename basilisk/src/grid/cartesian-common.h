@@ -166,6 +166,9 @@ scalar alloc_block_scalar (const char * name, const char * ext, int block)
       for (sb.i = s.i, n = 0; n < block; n++, sb.i++) {
 	init_block_scalar (sb, name, ext, n, block);
 	interpreter_reset_scalar (sb);
+#if TREE && MIXED_PRECISION
+	field_storage (sb.i, false);
+#endif
       }
       trash (((scalar []){s, {-1}})); // fixme: only trashes one block?
       return s;
@@ -189,6 +192,10 @@ scalar alloc_block_scalar (const char * name, const char * ext, int block)
   }
   // allocate extra space on the grid
   realloc_scalar (block*sizeof(real));
+#if TREE && MIXED_PRECISION
+  for (int n = 0; n < block; n++)
+    field_storage (s.i + n, false);
+#endif
   trash (((scalar []){s, {-1}})); // fixme: only trashes one block?
   return s;
 }
@@ -467,6 +474,38 @@ void free_solver()
 void (* boundary_level) (scalar *, int l);
 void (* boundary_face)  (vectorl);
 
+/**
+## Split-phase boundary conditions
+
+`boundary_start (list, l)` followed by `boundary_finish()` is
+equivalent to `boundary_level (list, l)`, but allows the computation
+of cells which do not depend on the halos of other processes (the
+cells which are not `is_border()`) to proceed while the halos are
+being exchanged, for example
+
+~~~literatec
+boundary_start ({a}, l);
+foreach_level (l)
+  if (!is_border(cell))
+    b[] = (a[1] + a[-1] + a[0,1] + a[0,-1] - 4.*a[])/sq(Delta);
+boundary_finish();
+foreach_level (l)
+  if (is_border(cell))
+    b[] = (a[1] + a[-1] + a[0,1] + a[0,-1] - 4.*a[])/sq(Delta);
+~~~
+
+When `l` is negative, boundary conditions are applied on all levels
+(as `boundary()` does) and the fields of `list` are marked as up to
+date, so that the loop on interior cells does not apply them again.
+Only one split-phase exchange can be in progress at a time.
+
+By default (i.e. without MPI or when no overlap is possible), boundary
+conditions are applied by `boundary_start()` and `boundary_finish()`
+does nothing. */
+
+void (* boundary_start)  (scalar *, int l);
+void (* boundary_finish) (void);
+
 #define boundary(...)						\
   boundary_internal ((scalar *)__VA_ARGS__, __FILE__, LINENO)
 
@@ -544,6 +583,17 @@ void cartesian_boundary_level (scalar * list, int l)
   boundary_iterate (level, list, l);
 }
 
+void cartesian_boundary_start (scalar * list, int l)
+{
+  boundary_level (list, l);
+  if (l < 0)
+    for (scalar s in list)
+      if (!is_constant(s))
+	s.dirty = false;
+}
+
+void cartesian_boundary_finish() {}
+
 void cartesian_boundary_face (vectorl list)
 {
   foreach_dimension()
@@ -854,6 +904,8 @@ void cartesian_methods()
   init_tensor        = cartesian_init_tensor;
   boundary_level     = cartesian_boundary_level;
   boundary_face      = cartesian_boundary_face;
+  boundary_start     = cartesian_boundary_start;
+  boundary_finish    = cartesian_boundary_finish;
   scalar_clone       = cartesian_scalar_clone;
   debug              = cartesian_debug;
 }
@@ -934,6 +986,119 @@ void interpolate_array (scalar * list, coord * a, int n, double * v,
   }
 }
 
+/**
+## Bulk interpolation on regular grids
+
+*interpolate_region()* samples the fields in *list* at the points of a
+grid of *n.x* x *n.y* (x *n.z*) points with coordinates *px[i]*,
+*py[j]* (and *pz[k]*). The coordinates along each direction must be
+sorted in increasing order (a plane is obtained with e.g. `n.x = 1`).
+Rather than locating each point from the root of the tree (as
+*interpolate()* does), each leaf is visited once and fills all the
+points it contains, so that the cost is independent of the number of
+points per cell and the loop is parallel (with OpenMP and MPI).
+
+The values are stored in *v* (of size `n.x*n.y*n.z*list_len(list)`)
+as `v[((i*n.y + j)*n.z + k)*len + l]` for point *(i,j,k)* and field
+*l*. Points outside the (local) domain are set to *nodata*.
+
+Each point is assigned to the cell returned by *locate()*, using the
+same index computation, so that the results are identical to those of
+*interpolate()*, including for points on cell faces or on the
+boundaries of the domain. */
+
+/* the index of the cell containing coordinate c, as computed by
+   locate() i.e. `(c - c0)/L0*N + o` with N the number of cells per L0 */
+static inline int region_index (double c, double c0, double N, int o)
+{
+  return (c - c0)/L0*N + o;
+}
+
+/* the first of the n sorted coordinates p with an index larger than
+   or equal to c */
+static int region_lower (const double * p, int n, int c,
+			 double c0, double N, int o)
+{
+  int a = 0, b = n;
+  while (a < b) {
+    int m = (a + b)/2;
+    if (region_index (p[m], c0, N, o) < c)
+      a = m + 1;
+    else
+      b = m;
+  }
+  return a;
+}
+
+/* the range [i0:i1] of the coordinates p located in the cell of
+   index c */
+static bool region_range (const double * p, int n, int c,
+			  double c0, double N, int o, int * i0, int * i1)
+{
+  *i0 = region_lower (p, n, c, c0, N, o);
+  *i1 = region_lower (p, n, c + 1, c0, N, o) - 1;
+  return *i0 <= *i1;
+}
+
+trace
+void interpolate_region (scalar * list, coord n,
+			 double * px, double * py, double * pz, double * v,
+			 bool linear = false)
+{
+  int len = list_len (list), nx = n.x, ny = 1, nz = 1;
+#if dimension > 1
+  ny = n.y;
+#endif
+#if dimension > 2
+  nz = n.z;
+#endif
+  long size = (long) nx*ny*nz*len;
+  for (long i = 0; i < size; i++)
+    v[i] = nodata;
+#if _MPI
+  foreach (reduction(min:v[:size]))
+#else
+  foreach (cpu)
+#endif
+  {
+    double * alias = v; // so that qcc considers 'v' a local variable
+    int i0, i1, j0 = 0, j1 = 0, k0 = 0, k1 = 0;
+#if TREE
+    double N = 1 << level;
+    int o[3] = {GHOSTS, GHOSTS, GHOSTS};
+#elif MULTIGRID && _MPI
+    double N = point.n*mpi_dims[0];
+    int o[3] = {GHOSTS - mpi_coords[0]*point.n, GHOSTS - mpi_coords[1]*point.n,
+		GHOSTS - mpi_coords[2]*point.n};
+#else
+    double N = point.n;
+    int o[3] = {GHOSTS, GHOSTS, GHOSTS};
+#endif
+    if (region_range (px, nx, point.i, X0, N, o[0], &i0, &i1)
+#if dimension > 1
+	&& region_range (py, ny, point.j, Y0, N, o[1], &j0, &j1)
+#endif
+#if dimension > 2
+	&& region_range (pz, nz, point.k, Z0, N, o[2], &k0, &k1)
+#endif
+	)
+      for (int i = i0; i <= i1; i++)
+	for (int j = j0; j <= j1; j++)
+	  for (int k = k0; k <= k1; k++) {
+	    coord p = {px[i]};
+#if dimension > 1
+	    p.y = py[j];
+#endif
+#if dimension > 2
+	    p.z = pz[k];
+#endif
+	    double * w = alias + (((long) i*ny + j)*nz + k)*len;
+	    for (scalar s in list)
+	      *(w++) = linear ? interpolate_linear (point, s, p.x, p.y, p.z) : s[];
+	  }
+  }
+}
+
 // Boundaries
 
 typedef int bid;
@@ -1051,7 +1216,7 @@ void stencil_val (Point p, scalar s, int i, int j, int k,
       s.input = true;
   }
   else {
-    s.input = true;
+    s.input = s.shifted = true;
     int d = 0;
     foreach_dimension() {
       if ((!s.face || s.v.x.i != s.i) && abs(index[d]) > s.width)
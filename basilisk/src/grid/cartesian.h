@@ -33,8 +33,15 @@ static Point last_point;
 
 #define cartesian ((Cartesian *)grid)
 
+/**
+The data pointer is also stored in a global variable, so that
+foreach() can make a (loop invariant) local copy of it, see
+[multigrid.h](multigrid.h). */
+
+static real * _cdata = NULL;
+
 @undef val
-@define val(a,k,l,m) (((real *)cartesian->d)[(point.i + k + _index(a,m)*(point.n + 2))*(point.n + 2) + point.j + l])
+@define val(a,k,l,m) (_cdata[(point.i + k + _index(a,m)*(point.n + 2))*(point.n + 2) + point.j + l])
 @define allocated(...) true
 
 @define POINT_VARIABLES VARIABLES
@@ -44,11 +51,14 @@ OMP_PARALLEL() {
   int ig = 0, jg = 0; NOT_UNUSED(ig); NOT_UNUSED(jg);
   Point point = {0};
   point.n = cartesian->n;
+  real * _cdata0 = _cdata, * _cdata = _cdata0; NOT_UNUSED(_cdata);
   int _k;
   OMP(omp for schedule(static))
   for (_k = 1; _k <= point.n; _k++) {
     point.i = _k;
-    for (point.j = 1; point.j <= point.n; point.j++) {
+    OMP_SIMD()
+    for (int _l = 1; _l <= point.n; _l++) {
+      point.j = _l;
       POINT_VARIABLES
 @
 @define end_foreach() }}}
@@ -58,11 +68,14 @@ OMP_PARALLEL() {
   int ig = 0, jg = 0; NOT_UNUSED(ig); NOT_UNUSED(jg);
   Point point = {0};
   point.n = cartesian->n;
+  real * _cdata0 = _cdata, * _cdata = _cdata0; NOT_UNUSED(_cdata);
   int _k;
   OMP(omp for schedule(static))
   for (_k = 1; _k <= point.n + 1; _k++) {
     point.i = _k;
-    for (point.j = 1; point.j <= point.n + 1; point.j++) {
+    OMP_SIMD()
+    for (int _l = 1; _l <= point.n + 1; _l++) {
+      point.j = _l;
       POINT_VARIABLES
 @
 @define end_foreach_face_generic() }}}
@@ -319,6 +332,7 @@ void init_grid (int n)
   size_t len = (n + 2)*(n + 2)*datasize;
   p->n = N = n;
   p->d = qmalloc (len, char);
+  _cdata = (real *) p->d;
   grid = (Grid *) p;
   reset (all, 0.);
   for (int d = 0; d < nboundary; d++) {
@@ -343,6 +357,7 @@ void realloc_scalar (int size)
   Cartesian * p = cartesian;
   datasize += size;  
   qrealloc (p->d, (p->n + 2)*(p->n + 2)*datasize, char);
+  _cdata = (real *) p->d;
 }
 
 Point locate (double xp = 0, double yp = 0, double zp = 0)
@@ -512,6 +512,18 @@ void mpi_init()
 
 @define OMP_PARALLEL() OMP(omp parallel)
 
+/**
+With `-DSIMD=1` (and `-fopenmp-simd` or `-fopenmp`), the innermost
+loops of foreach() on regular grids are vectorised when their stencil
+allows it, see [stencils.h](stencils.h#vectorisation). */
+
+#if SIMD
+@ define SIMD_PRAGMA(x) Pragma(#x)
+#else
+@ define SIMD_PRAGMA(x)
+#endif
+@define OMP_SIMD() SIMD_PRAGMA(omp simd if(_simd))
+
 @define NOT_UNUSED(x) (void)(x)
 
 @define VARIABLES      _CATCH;
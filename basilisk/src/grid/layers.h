@@ -42,8 +42,10 @@ one of the indices is used. */
 	  _layer + point.l + m : 0))
 @
 
+#if !TREE_SOA
 @undef val
 @define val(a,k,p,m) data(k,p,m)[_index(a,m)]
+#endif
 
 /**
 foreach_layer() is just an alias for foreach_block(). */
@@ -13,6 +13,7 @@ typedef struct {
   char * first, * lastb; // first and last free blocks
   size_t size;           // block size
   size_t poolsize;       // pool size
+  size_t used;           // bytes of each pool usable for blocks
   Pool * pool, * last;   // first and last pools
 } Mempool;
 
@@ -29,7 +30,21 @@ Mempool * mempool_new (size_t poolsize, size_t size)
   // i.e. something comparable to the size of a L2 cache
   poolsize = min(1 << 20, poolsize + sizeof(Pool));
   Mempool * m = qcalloc (1, Mempool);
+  m->poolsize = m->used = poolsize;
+  m->size = size;
+  return m;
+}
+
+/* Only the first `used` bytes of each pool are divided into blocks,
+   the rest is reserved for the caller (see the structure-of-arrays
+   layout of tree grids). */
+
+Mempool * mempool_new_reserved (size_t poolsize, size_t used, size_t size)
+{
+  assert (used <= poolsize && size >= sizeof(FreeBlock));
+  Mempool * m = qcalloc (1, Mempool);
   m->poolsize = poolsize;
+  m->used = used;
   m->size = size;
   return m;
 }
@@ -66,7 +81,7 @@ void * mempool_alloc (Mempool * m)
   if (!next) {
     m->lastb += m->size;
     next = m->lastb;
-    if (next + m->size > ((char *) m->last) + m->poolsize)
+    if (next + m->size > ((char *) m->last) + m->used)
       next = NULL;
     else {
       FreeBlock * b = (FreeBlock *) next;
@@ -12,6 +12,29 @@
 @ define end_foreach_coarse_level  end_foreach_level
 @endif
 
+/* Colours for multicolour (Gauss-Seidel) relaxations. With `nc = 2`,
+   this is the red/black colouring: face neighbours have different
+   colours. With `nc = 1 << dimension`, all the neighbours (including
+   diagonal neighbours) have different colours. The (1 << dimension)
+   colours are ordered so that each red/black colour is a contiguous
+   range of colours. */
+
+#if dimension == 1
+# define colour_index(i,j,k) ((i) & 1)
+#elif dimension == 2
+# define colour_index(i,j,k) (((((i) + (j)) & 1) << 1) | ((i) & 1))
+#else // dimension == 3
+# define colour_index(i,j,k) (((((i) + (j) + (k)) & 1) << 2) |	\
+			      (((j) & 1) << 1) | ((i) & 1))
+#endif
+#define cell_colour(nc)							\
+  (colour_index (point.i, point.j, point.k)/((1 << dimension)/(nc)))
+
+@ifndef foreach_level_or_leaf_colour
+@ define foreach_level_or_leaf_colour(l, c, nc) foreach_level_or_leaf(l) if (cell_colour (nc) == (c)) {
+@ define end_foreach_level_or_leaf_colour() } end_foreach_level_or_leaf()
+@endif
+
 // scalar attributes
 
 attribute {
@@ -27,6 +27,20 @@ typedef struct {
   size_t field_size;
 } Multigrid;
 
+/**
+The data pointer and field size are also stored in global variables,
+so that foreach() can make local copies of them. This tells the
+compiler that they are loop invariants, which is necessary for
+[vectorisation](stencils.h#vectorisation). */
+
+static real * _mgdata = NULL;
+static size_t _mgsize = 0;
+
+@def MULTIGRID_DATA()
+  real * _mgdata0 = _mgdata, * _mgdata = _mgdata0; NOT_UNUSED(_mgdata);
+  size_t _mgsize0 = _mgsize, _mgsize = _mgsize0; NOT_UNUSED(_mgsize);
+@
+
 struct _Point {
   int i;
 #if dimension > 1
@@ -62,25 +76,25 @@ static Point last_point;
 /***** Cartesian macros *****/
 #if dimension == 1
 @undef val
-@def val(a,k,l,m) (((real *)multigrid->d)[point.i + (k) +
-					  _shift (point.level) +
-					  _index(a,m)*multigrid->field_size])
+@def val(a,k,l,m) (_mgdata[point.i + (k) +
+			   _shift (point.level) +
+			   _index(a,m)*_mgsize])
 @
 #elif dimension == 2
 @undef val
-@def val(a,k,l,m) (((real *)multigrid->d)[point.j + (l) +
-					  (point.i + (k))*((1 << point.level) + 2*GHOSTS) +
-					  _shift (point.level) +
-					  _index(a,m)*multigrid->field_size])
+@def val(a,k,l,m) (_mgdata[point.j + (l) +
+			   (point.i + (k))*((1 << point.level) + 2*GHOSTS) +
+			   _shift (point.level) +
+			   _index(a,m)*_mgsize])
 @
 #elif dimension == 3
 @undef val
-@def val(a,l,m,o) (((real *)multigrid->d)[point.k + (o) +
-					  ((1 << point.level) + 2*GHOSTS)*
-					  (point.j + (m) +
-					   (point.i + (l))*((1 << point.level) + 2*GHOSTS)) +
-					  _shift (point.level) +
-					  _index(a,0)*multigrid->field_size])
+@def val(a,l,m,o) (_mgdata[point.k + (o) +
+			   ((1 << point.level) + 2*GHOSTS)*
+			   (point.j + (m) +
+			    (point.i + (l))*((1 << point.level) + 2*GHOSTS)) +
+			   _shift (point.level) +
+			   _index(a,0)*_mgsize])
 @
 #endif
 
@@ -129,14 +143,14 @@ static Point last_point;
 @define depth()       (grid->depth)
 #if dimension == 1
 @def fine(a,k,l,m)
-(((real *)multigrid->d)[2*point.i - GHOSTS + (k) +
-			_shift (point.level + 1) +
-			_index(a,m)*multigrid->field_size])
+(_mgdata[2*point.i - GHOSTS + (k) +
+	 _shift (point.level + 1) +
+	 _index(a,m)*_mgsize])
 @
 @def coarse(a,k,l,m)
-(((real *)multigrid->d)[(point.i + GHOSTS)/2 + (k) +
-			_shift (point.level - 1) +
-			_index(a,m)*multigrid->field_size])
+(_mgdata[(point.i + GHOSTS)/2 + (k) +
+	 _shift (point.level - 1) +
+	 _index(a,m)*_mgsize])
 @
 @def POINT_VARIABLES
   VARIABLES
@@ -148,16 +162,16 @@ static Point last_point;
 @
 #elif dimension == 2
 @def fine(a,k,l,m)
-(((real *)multigrid->d)[2*point.j - GHOSTS + (l) +
-			(2*point.i - GHOSTS + (k))*((1 << point.level)*2 + 2*GHOSTS) +
-			_shift (point.level + 1) +
-			_index(a,m)*multigrid->field_size])
+(_mgdata[2*point.j - GHOSTS + (l) +
+	 (2*point.i - GHOSTS + (k))*((1 << point.level)*2 + 2*GHOSTS) +
+	 _shift (point.level + 1) +
+	 _index(a,m)*_mgsize])
 @
 @def coarse(a,k,l,m)
-(((real *)multigrid->d)[(point.j + GHOSTS)/2 + (l) +
-			((point.i + GHOSTS)/2 + (k))*((1 << point.level)/2 + 2*GHOSTS) +
-			_shift (point.level - 1) +
-			_index(a,m)*multigrid->field_size])
+(_mgdata[(point.j + GHOSTS)/2 + (l) +
+	 ((point.i + GHOSTS)/2 + (k))*((1 << point.level)/2 + 2*GHOSTS) +
+	 _shift (point.level - 1) +
+	 _index(a,m)*_mgsize])
 @
 @def POINT_VARIABLES
   VARIABLES
@@ -171,20 +185,20 @@ static Point last_point;
 @
 #elif dimension == 3
 @def fine(a,l,m,o)
-(((real *)multigrid->d)[2*point.k - GHOSTS + (o) +
-			((1 << point.level)*2 + 2*GHOSTS)*
-			(2*point.j - GHOSTS + (m) +
-			 (2*point.i - GHOSTS + (l))*((1 << point.level)*2 + 2*GHOSTS)) +
-			_shift (point.level + 1) +
-			_index(a,0)*multigrid->field_size])
+(_mgdata[2*point.k - GHOSTS + (o) +
+	 ((1 << point.level)*2 + 2*GHOSTS)*
+	 (2*point.j - GHOSTS + (m) +
+	  (2*point.i - GHOSTS + (l))*((1 << point.level)*2 + 2*GHOSTS)) +
+	 _shift (point.level + 1) +
+	 _index(a,0)*_mgsize])
 @
 @def coarse(a,l,m,o)
-(((real *)multigrid->d)[(point.k + GHOSTS)/2 + (o) +
-			((1 << point.level)/2 + 2*GHOSTS)*
-			((point.j + GHOSTS)/2 + (m) +
-			 ((point.i + GHOSTS)/2 + (l))*((1 << point.level)/2 + 2*GHOSTS)) +
-			_shift (point.level - 1) +
-			_index(a,0)*multigrid->field_size])
+(_mgdata[(point.k + GHOSTS)/2 + (o) +
+	 ((1 << point.level)/2 + 2*GHOSTS)*
+	 ((point.j + GHOSTS)/2 + (m) +
+	  ((point.i + GHOSTS)/2 + (l))*((1 << point.level)/2 + 2*GHOSTS)) +
+	 _shift (point.level - 1) +
+	 _index(a,0)*_mgsize])
 @
 @def POINT_VARIABLES
   VARIABLES
@@ -228,27 +242,38 @@ OMP_PARALLEL() {
 }
 @
 
+/**
+The innermost loops of foreach() and foreach_face() can be
+vectorised, see [stencils.h](stencils.h#vectorisation). */
+
 @def foreach()
   OMP_PARALLEL() {
   int ig = 0, jg = 0, kg = 0; NOT_UNUSED(ig); NOT_UNUSED(jg); NOT_UNUSED(kg);
   Point point = {0};
   point.level = depth(); point.n = 1 << point.level;
+  MULTIGRID_DATA();
   int _k;
   OMP(omp for schedule(static))
   for (_k = GHOSTS; _k < point.n + GHOSTS; _k++) {
     point.i = _k;
-#if dimension > 1
-    for (point.j = GHOSTS; point.j < point.n + GHOSTS; point.j++)
-#if dimension > 2
-      for (point.k = GHOSTS; point.k < point.n + GHOSTS; point.k++)
-#endif
-	{
+#if dimension == 2
+    OMP_SIMD()
+    for (int _l = GHOSTS; _l < point.n + GHOSTS; _l++) {
+      point.j = _l;
+#elif dimension > 2
+    for (point.j = GHOSTS; point.j < point.n + GHOSTS; point.j++) {
+      OMP_SIMD()
+      for (int _l = GHOSTS; _l < point.n + GHOSTS; _l++) {
+	point.k = _l;
 #endif
           POINT_VARIABLES
 @
 @def end_foreach()
+#if dimension > 2
+      }
+#endif
 #if dimension > 1
-	}
+    }
 #endif
   }
 }
@@ -271,22 +296,29 @@ OMP_PARALLEL() {
   int ig = 0, jg = 0, kg = 0; NOT_UNUSED(ig); NOT_UNUSED(jg); NOT_UNUSED(kg);
   Point point = {0};
   point.level = depth(); point.n = 1 << point.level;
+  MULTIGRID_DATA();
   int _k;
   OMP(omp for schedule(static))
   for (_k = GHOSTS; _k <= point.n + GHOSTS; _k++) {
     point.i = _k;
-#if dimension > 1
-    for (point.j = GHOSTS; point.j <= point.n + GHOSTS; point.j++)
-#if dimension > 2
-      for (point.k = GHOSTS; point.k <= point.n + GHOSTS; point.k++)
-#endif
-        {
+#if dimension == 2
+    OMP_SIMD()
+    for (int _l = GHOSTS; _l <= point.n + GHOSTS; _l++) {
+      point.j = _l;
+#elif dimension > 2
+    for (point.j = GHOSTS; point.j <= point.n + GHOSTS; point.j++) {
+      OMP_SIMD()
+      for (int _l = GHOSTS; _l <= point.n + GHOSTS; _l++) {
+	point.k = _l;
 #endif
 	  POINT_VARIABLES
 @
 @def end_foreach_face_generic()
+#if dimension > 2
+      }
+#endif
 #if dimension > 1
-	}
+    }
 #endif
   }
 }
@@ -797,6 +829,7 @@ void init_grid (int n)
   // allocate grid: this must be after mpi_boundary_new() since this modifies depth()
   m->field_size = _shift (depth() + 1);
   m->d = (char *) malloc(m->field_size*datasize);
+  _mgdata = (real *) m->d, _mgsize = m->field_size;
   reset (all, 0.);
 }
 
@@ -805,6 +838,7 @@ void realloc_scalar (int size)
   Multigrid * p = multigrid;
   datasize += size;
   qrealloc (p->d, p->field_size*datasize, char);
+  _mgdata = (real *) p->d;
 }
 
 #if _MPI
@@ -17,6 +17,7 @@ conditions for each field. */
 attribute {
   // fixme: use a structure
   bool input, output;
+  bool shifted; // read at another point than the current one
   int width; // maximum stencil width/height/depth
   int dirty; // // boundary conditions status:
   // 0: all conditions applied
@@ -49,9 +50,41 @@ typedef struct {
   scalar * listc;     // the scalar fields on which to apply boundary conditions
   vectorl listf;      // the face vector fields on which to apply (flux) boundary conditions
   scalar * dirty;     // the dirty fields (i.e. write-accessed)
+  bool simd;          // can the loop be vectorised?
   void * data;        // user data
 } ForeachData;
 
+/**
+## Vectorisation
+
+When compiled with `-DSIMD=1` (and `-fopenmp-simd` or `-fopenmp`),
+the innermost loops of foreach() and foreach_face() on
+[Cartesian](cartesian.h) and [multigrid](multigrid.h) grids are
+annotated with `omp simd`. Vectorisation is only safe if iterations
+are independent, i.e. if no field written by the loop is also read at
+a neighboring point. This is checked using the stencil of the loop
+(see `check_stencil()` below), which sets `_foreach_simd`. This value
+is consumed by the next loop, so that loops without stencils
+(i.e. `noauto` loops or loops for which `qcc` could not build the
+stencil) are never vectorised.
+
+Reductions are declared for `omp simd` by `qcc`, except for `coord`,
+`mat3` and array reductions which disable vectorisation. `serial`
+loops are not vectorised either. As for OpenMP, the body of a
+vectorised loop cannot use `break` or `return`. */
+
+static bool _foreach_simd = false;
+#if SIMD
+static const bool _simd = false;
+@undef BEGIN_FOREACH
+@def BEGIN_FOREACH {
+  const bool _simd = _foreach_simd; NOT_UNUSED(_simd);
+  _foreach_simd = false;
+@
+@undef END_FOREACH
+@define END_FOREACH }
+#endif
+
 // fixme: this should be rewritten using better macros
 @def foreach_stencil(...) {
   static int _first = 1.;
@@ -61,6 +94,7 @@ typedef struct {
   if (baseblock) for (scalar s = baseblock[0], * i = baseblock;
 		s.i >= 0; i++, s = *i) {
     _attribute[s.i].input = _attribute[s.i].output = false;
+    _attribute[s.i].shifted = false;
     _attribute[s.i].width = 0;
   }
   int ig = 0, jg = 0, kg = 0; NOT_UNUSED(ig); NOT_UNUSED(jg); NOT_UNUSED(kg);
@@ -70,6 +104,7 @@ typedef struct {
 @def end_foreach_stencil()
   check_stencil (&_loop);
   boundary_stencil (&_loop);
+  _foreach_simd = _loop.simd;
   _first = 0;
 }
 @
@@ -204,12 +239,20 @@ applied. */
 void check_stencil (ForeachData * loop)
 {
   loop->listf = (vectorl){NULL};
+  loop->simd = true;
   
   /**
   We check the accesses for each field... */
   
   for (scalar s in baseblock) {
     bool write = s.output, read = s.input;
+
+    /**
+    The loop cannot be vectorised if a field is written and read at
+    a neighboring point. */
+
+    if (write && s.shifted)
+      loop->simd = false;
     
 #ifdef foreach_layer
     if (_layer == 0 || s.block == 1)
@@ -16,9 +16,13 @@ attribute {
     else if (a >= GHOSTS + (1 << level)) a -= 1 << level; } while(0)
 
 /*
-  A cache of refined cells is maintained (if not NULL).
+  A cache of refined cells is maintained (if not NULL). If `fresh` is
+  not NULL, the scalars are not initialised and the cell is appended
+  to `fresh[(level << dimension) + cell_colour (1 << dimension)]`
+  instead (see refine_fields()).
 */
-int refine_cell (Point point, scalar * list, int flag, Cache * refined)
+static int refine_cell_fresh (Point point, scalar * list, int flag,
+			      Cache * refined, Cache * fresh)
 {
   int nr = 0;
 #if TWO_ONE
@@ -46,7 +50,7 @@ int refine_cell (Point point, scalar * list, int flag, Cache * refined)
 	      p.k = (point.k + GHOSTS)/2 + m;
 	      periodic_clamp (p.k, p.level);
             #endif
-	    nr += refine_cell (p, list, flag, refined);
+	    nr += refine_cell_fresh (p, list, flag, refined, fresh);
 	    aparent(k,l,m).flags |= flag;
 	  }
 #endif
@@ -59,9 +63,13 @@ int refine_cell (Point point, scalar * list, int flag, Cache * refined)
     cell.flags |= cflag;
     
   /* initialise scalars */
-  for (scalar s in list)
-    if (is_local(cell) || s.face)
-      s.refine (point, s);
+  if (fresh)
+    cache_append (&fresh[(level << dimension) +
+			 cell_colour (1 << dimension)], point, 0);
+  else
+    for (scalar s in list)
+      if (is_local(cell) || s.face)
+	s.refine (point, s);
 
   /* refine */
   cell.flags &= ~leaf;
@@ -93,28 +101,75 @@ int refine_cell (Point point, scalar * list, int flag, Cache * refined)
   return nr;
 }
 
+int refine_cell (Point point, scalar * list, int flag, Cache * refined)
+{
+  return refine_cell_fresh (point, list, flag, refined, NULL);
+}
+
+/*
+  The scalars of the cells appended to `fresh` by refine_cell_fresh(),
+  for levels smaller than `nl`, are initialised in parallel. Levels
+  are processed from coarse to fine and, within a level, one colour at
+  a time so that the children (and faces) written by concurrent
+  threads are distinct. The cells are leaves until their scalars are
+  initialised, as with refine_cell().
+*/
+static void refine_fields (Cache * fresh, int nl, scalar * list)
+{
+  for (int l = 0; l < nl; l++) {
+    Cache * c = fresh + (l << dimension);
+    for (int i = 0; i < 1 << dimension; i++)
+      foreach_cache (c[i])
+	cell.flags |= leaf;
+    for (int i = 0; i < 1 << dimension; i++) {
+      foreach_cache (c[i])
+	for (scalar s in list)
+	  if (is_local(cell) || s.face)
+	    s.refine (point, s);
+      foreach_cache (c[i])
+	cell.flags &= ~leaf;
+    }
+  }
+}
+
 attribute {
   void (* coarsen) (Point, scalar);
 }
 
-bool coarsen_cell (Point point, scalar * list)
+/*
+  Whether `point` can be coarsened: its neighbors must not be too fine
+  and its children must not be different boundaries. This only depends
+  on the children of `point`.
+*/
+static bool can_coarsen (Point point)
 {
 #if TWO_ONE
-  /* check that neighboring cells are not too fine.
-     check that children are not different boundaries */
   int pid = cell.pid;
   foreach_child()
     if (cell.neighbors || (cell.pid < 0 && cell.pid != pid))
-      return false; // cannot coarsen
+      return false;
 #endif
+  return true;
+}
 
-  /* restriction/coarsening */
+/*
+  Restriction/coarsening of the scalars. This only modifies `point`
+  and its faces.
+*/
+static void coarsen_fields (Point point, scalar * list)
+{
   for (scalar s in list) {
     s.restriction (point, s);
     if (s.coarsen)
       s.coarsen (point, s);
   }
-    
+}
+
+/*
+  Coarsening of the tree itself, which is not thread-safe.
+*/
+static void coarsen_tree (Point point)
+{
   /* coarsen */
   cell.flags |= leaf;
 
@@ -131,7 +186,14 @@ bool coarsen_cell (Point point, scalar * list)
 	    cell.flags |= border;
   }
 @endif
+}
 
+bool coarsen_cell (Point point, scalar * list)
+{
+  if (!can_coarsen (point))
+    return false; // cannot coarsen
+  coarsen_fields (point, list);
+  coarsen_tree (point);
   return true;
 }
 
@@ -169,6 +231,170 @@ typedef struct {
   int nc, nf;
 } astats;
 
+#if _OPENMP
+# define ADAPT_THREADS omp_get_max_threads()
+# define ADAPT_THREAD  tid()
+#else
+# define ADAPT_THREADS 1
+# define ADAPT_THREAD  0
+#endif
+
+/**
+## Parallel adaptation
+
+The estimation of the wavelet error, the initialisation of the
+refined cells and the restriction of the coarsened cells run in
+parallel (with OpenMP). Only the modification of the tree itself
+(allocating and freeing cells through the layer mempools and updating
+the neighbour counters of the surrounding cells) is serial.
+
+The coarse (i.e. non-leaf) cells are first collected for each level,
+using a single traversal of the tree. If `estimate` is true, only the
+active coarse cells which are local or have local children (i.e. the
+cells for which the wavelet error needs to be estimated) are
+collected. */
+
+static Cache * coarse_cells (bool estimate)
+{
+  Cache * coarse = qcalloc (depth() + 1, Cache);
+  foreach_cell() {
+    if (is_leaf(cell) || (estimate && !is_active(cell)))
+      continue;
+    bool local = !estimate || is_local(cell);
+    if (!local)
+      foreach_child()
+	if (is_local(cell)) {
+	  local = true; break;
+	}
+    if (local)
+      cache_append (&coarse[level], point, 0);
+  }
+  return coarse;
+}
+
+static void free_coarse_cells (Cache * coarse, int nl)
+{
+  for (int l = 0; l < nl; l++)
+    free (coarse[l].p);
+  free (coarse);
+}
+
+/**
+The wavelet error, estimated on the children of `point`, sets their
+`too_coarse` and `too_fine` flags. Only the children of `point` are
+modified (their values are restored after prolongation) so that the
+coarse cells of a given level can be processed concurrently. The
+leaves which are too coarse are appended to `leaves`. */
+
+static void wavelet_estimate (Point point, scalar * slist, double * max,
+			      int maxlevel, int minlevel,
+			      int too_coarse, int too_fine, Cache * leaves)
+{
+  int i = 0;
+  static const int just_fine = 1 << (user + 3);
+  for (scalar s in slist) {
+    double emax = max[i++], sc[1 << dimension];
+    int c = 0;
+    foreach_child()
+      sc[c++] = s[];
+    s.prolongation (point, s);
+    c = 0;
+    foreach_child() {
+      double e = fabs(sc[c] - s[]);
+      if (e > emax && level < maxlevel) {
+	cell.flags &= ~too_fine;
+	cell.flags |= too_coarse;
+      }
+      else if ((e <= emax/1.5 || level > maxlevel) &&
+	       !(cell.flags & (too_coarse|just_fine))) {
+	if (level >= minlevel)
+	  cell.flags |= too_fine;
+      }
+      else if (!(cell.flags & too_coarse)) {
+	cell.flags &= ~too_fine;
+	cell.flags |= just_fine;
+      }
+      s[] = sc[c++];
+    }
+  }
+  foreach_child() {
+    cell.flags &= ~just_fine;
+    if (!is_leaf(cell)) {
+      cell.flags &= ~too_coarse;
+      if (level >= maxlevel)
+	cell.flags |= too_fine;
+    }
+    else if (!is_active(cell))
+      cell.flags &= ~too_coarse;
+    else if (cell.flags & too_coarse)
+      cache_append (leaves, point, 0);
+  }
+}
+
+/**
+The leaves are refined (serially) in the order in which they would be
+reached by a traversal of the tree i.e. in "pre-order". This is the
+[Z-order](/src/grid/tree.h#compaction) of the ancestors on the
+coarsest of the two levels, coarser cells first. Their scalars are
+then initialised in parallel, see `refine_fields()`. */
+
+static unsigned long zorder (const Index * p, int l)
+{
+  unsigned long key = 0;
+  int shift = p->level - l;
+  for (int b = l - 1; b >= 0; b--) {
+    key = (key << 1) | ((((p->i - GHOSTS) >> shift) >> b) & 1);
+#if dimension >= 2
+    key = (key << 1) | ((((p->j - GHOSTS) >> shift) >> b) & 1);
+#endif
+#if dimension >= 3
+    key = (key << 1) | ((((p->k - GHOSTS) >> shift) >> b) & 1);
+#endif
+  }
+  return key;
+}
+
+static int compare_preorder (const void * a, const void * b)
+{
+  const Index * p = a, * q = b;
+  int l = min (p->level, q->level);
+  unsigned long kp = zorder (p, l), kq = zorder (q, l);
+  return kp < kq ? -1 : kp > kq ? 1 : p->level - q->level;
+}
+
+/**
+Leaves may already have been refined to enforce the 2:1 constraint. */
+
+static int refine_too_coarse (Point point, scalar * list, int flag,
+			      int too_coarse, Cache * fresh)
+{
+  cell.flags &= ~too_coarse;
+  if (!is_leaf(cell))
+    return 0;
+  refine_cell_fresh (point, list, flag, &tree->refined, fresh);
+  return 1;
+}
+
+/**
+Whether `point` is to be coarsened. Since `can_coarsen()` only depends
+on the children, this can be decided concurrently for all the cells of
+a level, before any of them is coarsened. */
+
+static bool coarsen_too_fine (Point point, int refined, int too_fine)
+{
+  bool coarsen = false;
+  if (is_boundary(cell))
+    return coarsen;
+  if (cell.flags & refined)
+    // cell was refined previously, unset the flag
+    cell.flags &= ~(refined|too_fine);
+  else if (cell.flags & too_fine) {
+    coarsen = is_local(cell) && can_coarsen (point);
+    cell.flags &= ~too_fine; // do not coarsen parent
+  }
+  return coarsen;
+}
+
 trace
 astats adapt_wavelet (scalar * slist,       // list of scalars
 		      double * max,         // tolerance for each scalar
@@ -205,110 +431,93 @@ astats adapt_wavelet (scalar * slist,       // list of scalars
   if (minlevel < 1)
     minlevel = 1;
   tree->refined.n = 0;
-  static const int refined = 1 << user, too_fine = 1 << (user + 1);
-  foreach_cell() {
-    if (is_active(cell)) {
-      static const int too_coarse = 1 << (user + 2);
-      if (is_leaf (cell)) {
-	if (cell.flags & too_coarse) {
-	  cell.flags &= ~too_coarse;
-	  refine_cell (point, listc, refined, &tree->refined);
-	  st.nf++;
-	}
-	continue;
-      }
-      else { // !is_leaf (cell)
-	if (cell.flags & refined) {
-	  // cell has already been refined, skip its children
-	  cell.flags &= ~too_coarse;
-	  continue;
-	}
-	// check whether the cell or any of its children is local
-	bool local = is_local(cell);
-	if (!local)
-	  foreach_child()
-	    if (is_local(cell)) {
-	      local = true; break;
-	    }
-	if (local) {
-	  int i = 0;
-	  static const int just_fine = 1 << (user + 3);
-	  for (scalar s in slist) {
-	    double emax = max[i++], sc[1 << dimension];
-	    int c = 0;
-	    foreach_child()
-	      sc[c++] = s[];
-	    s.prolongation (point, s);
-	    c = 0;
-	    foreach_child() {
-	      double e = fabs(sc[c] - s[]);
-	      if (e > emax && level < maxlevel) {
-		cell.flags &= ~too_fine;
-		cell.flags |= too_coarse;
-	      }
-	      else if ((e <= emax/1.5 || level > maxlevel) &&
-		       !(cell.flags & (too_coarse|just_fine))) {
-		if (level >= minlevel)
-		  cell.flags |= too_fine;
-	      }
-	      else if (!(cell.flags & too_coarse)) {
-		cell.flags &= ~too_fine;
-		cell.flags |= just_fine;
-	      }
-	      s[] = sc[c++];
-	    }
-	  }
-	  foreach_child() {
-	    cell.flags &= ~just_fine;
-	    if (!is_leaf(cell)) {
-	      cell.flags &= ~too_coarse;
-	      if (level >= maxlevel)
-		cell.flags |= too_fine;
-	    }
-	    else if (!is_active(cell))
-	      cell.flags &= ~too_coarse;
-	  }
-	}
-      }
-    }
-    else // inactive cell
-      continue;
+  static const int refined = 1 << user, too_fine = 1 << (user + 1),
+    too_coarse = 1 << (user + 2);
+
+  /* the wavelet error is estimated in parallel, one level at a time,
+     for the coarse cells which are local or have local children. Each
+     thread collects the leaves which are too coarse. */
+  int nl = depth() + 1;
+  Cache * coarse = coarse_cells (true);
+  Cache * leaves = qcalloc (ADAPT_THREADS, Cache);
+  for (int l = 0; l < nl; l++)
+    foreach_cache (coarse[l])
+      wavelet_estimate (point, slist, max, maxlevel, minlevel,
+			too_coarse, too_fine, &leaves[ADAPT_THREAD]);
+  free_coarse_cells (coarse, nl);
+
+  /* the tree is then refined (serially) and the scalars of the
+     refined cells initialised (in parallel) */
+  for (int t = 1; t < ADAPT_THREADS; t++) {
+    cache_extend (&leaves[0], leaves[t].p, leaves[t].n);
+    free (leaves[t].p);
   }
+  qsort (leaves[0].p, leaves[0].n, sizeof (Index), compare_preorder);
+  Cache * fresh = qcalloc (nl << dimension, Cache);
+  for (Index * p = leaves[0].p; p < leaves[0].p + leaves[0].n; p++)
+    st.nf += refine_too_coarse (index_point (p), listc, refined, too_coarse,
+				fresh);
+  free (leaves[0].p);
+  free (leaves);
+  refine_fields (fresh, nl, listc);
+  free_coarse_cells (fresh, nl << dimension);
   mpi_boundary_refine (listc);
   
   // coarsening
-  // the loop below is only necessary to ensure symmetry of 2:1 constraint
-  for (int l = depth(); l >= 0; l--) {
-    foreach_cell()
-      if (!is_boundary(cell)) {
-	if (level == l) {
-	  if (!is_leaf(cell)) {
-	    if (cell.flags & refined)
-	      // cell was refined previously, unset the flag
-	      cell.flags &= ~(refined|too_fine);
-	    else if (cell.flags & too_fine) {
-	      if (is_local(cell) && coarsen_cell (point, listc))
-		st.nc++;
-	      cell.flags &= ~too_fine; // do not coarsen parent
-	    }
+  nl = depth() + 1;
+  coarse = coarse_cells (false);
+  Cache * coarsened = qcalloc (ADAPT_THREADS << dimension, Cache);
+  for (int l = nl - 1; l >= 0; l--) {
+    /* the cells to coarsen are collected in parallel, by thread and
+       colour, then merged by colour, in the order of coarse[l] */
+    foreach_cache (coarse[l])
+      if (coarsen_too_fine (point, refined, too_fine))
+	cache_append (&coarsened[(ADAPT_THREAD << dimension) +
+				 cell_colour (1 << dimension)], point, 0);
+    for (int t = 1; t < ADAPT_THREADS; t++)
+      for (int i = 0; i < 1 << dimension; i++) {
+	Cache * c = &coarsened[(t << dimension) + i];
+	cache_extend (&coarsened[i], c->p, c->n);
+	c->n = 0;
+      }
+    /* restriction is done in parallel, one colour at a time, since
+       neighboring cells share faces */
+    for (int i = 0; i < 1 << dimension; i++)
+      foreach_cache (coarsened[i])
+	coarsen_fields (point, listc);
+    // coarsening modifies the tree and must be done serially
+    for (int i = 0; i < 1 << dimension; i++) {
+      for (Index * p = coarsened[i].p; p < coarsened[i].p + coarsened[i].n;
+	   p++)
+	coarsen_tree (index_point (p));
+      st.nc += coarsened[i].n;
+      coarsened[i].n = 0;
+    }
+    // this is only necessary to ensure symmetry of 2:1 constraint
+    if (l > 0)
+      foreach_cache (coarse[l - 1]) {
+	bool fine = true;
+	foreach_child()
+	  if (!is_boundary(cell)) {
+	    if (cell.flags & too_fine)
+	      cell.flags &= ~too_fine;
+	    else
+	      fine = false;
 	  }
-	  if (cell.flags & too_fine)
-	    cell.flags &= ~too_fine;
-	  else if (level > 0 && (aparent(0).flags & too_fine))
-	    aparent(0).flags &= ~too_fine;
-	  continue;
-	}
-	else if (is_leaf(cell))
-	  continue;
+	if (!fine)
+	  cell.flags &= ~too_fine; // do not coarsen parent
       }
     mpi_boundary_coarsen (l, too_fine);
   }
+  free_coarse_cells (coarse, nl);
+  free_coarse_cells (coarsened, ADAPT_THREADS << dimension);
   free (listc);
 
   mpi_all_reduce (st.nf, MPI_INT, MPI_SUM);
   mpi_all_reduce (st.nc, MPI_INT, MPI_SUM);
   if (st.nc || st.nf)
     mpi_boundary_update (list);
+  tree_compact_check();
 
   if (list != ilist)
     free (list);
@@ -336,6 +545,42 @@ astats adapt_wavelet (scalar * slist,       // list of scalars
   } while (refined);							\
 } while(0)
 
+/* Sorts the active cells of each level by colour, for
+   foreach_level_or_leaf_colour(). Within a colour, cells are kept in
+   the order of the active caches. */
+
+void update_colours (void)
+{
+  update_cache();
+  Tree * q = tree;
+  if (q->coloured)
+    return;
+  for (int l = depth() + 1; l < q->ncolours; l++)
+    free (q->colours[l].cells.p);
+  qrealloc (q->colours, depth() + 1, ColourLevel);
+  for (int l = q->ncolours; l <= depth(); l++)
+    q->colours[l].cells = (CacheLevel){0};
+  q->ncolours = depth() + 1;
+  for (int l = 0; l <= depth(); l++) {
+    CacheLevel * a = &q->active[l];
+    ColourLevel * c = &q->colours[l];
+    int n[1 << dimension] = {0};
+    for (IndexLevel * p = a->p; p < a->p + a->n; p++)
+      n[colour_index (p->i, p->j, p->k)]++;
+    c->start[0] = 0;
+    for (int i = 0; i < 1 << dimension; i++)
+      c->start[i + 1] = c->start[i] + n[i], n[i] = c->start[i];
+    if (a->n > c->cells.nm) {
+      c->cells.nm = a->n;
+      qrealloc (c->cells.p, c->cells.nm, IndexLevel);
+    }
+    c->cells.n = a->n;
+    for (IndexLevel * p = a->p; p < a->p + a->n; p++)
+      c->cells.p[n[colour_index (p->i, p->j, p->k)]++] = *p;
+  }
+  q->coloured = true;
+}
+
 static void refine_level (int depth)
 {
   int refined;
@@ -3,10 +3,47 @@ int debug_iteration = -1;
 
 void debug_mpi (FILE * fp1);
 
+/* copies the values of the block field `s` at the given stencil
+   index to (or from) the buffer `b` */
+#if MIXED_PRECISION
+# define get_block(b, s, ...)						\
+  do									\
+    for (int _n = 0; _n < s.block; _n++) {				\
+      scalar _c = {s.i + _n};						\
+      (b)[_n] = _c[__VA_ARGS__];					\
+    }									\
+  while (0)
+# define set_block(s, b, ...)						\
+  do									\
+    for (int _n = 0; _n < s.block; _n++) {				\
+      scalar _c = {s.i + _n};						\
+      _c[__VA_ARGS__] = (b)[_n];					\
+    }									\
+  while (0)
+#else
+# define get_block(b, s, ...)						\
+  memcpy (b, &s[__VA_ARGS__], sizeof(double)*s.block)
+# define set_block(s, b, ...)						\
+  memcpy (&s[__VA_ARGS__], b, sizeof(double)*s.block)
+#endif
+
+/**
+# Halo buffers
+
+The send and receive buffers of each neighbouring PE are persistent:
+they are only reallocated when a larger halo needs to be exchanged and
+they are kept when the halos are [rebuilt](#mpi_boundary_update_buffers)
+after adaptation or load-balancing, so that the exchanges performed at
+each timestep (and each multigrid relaxation) do not allocate any
+memory. A buffer is freed only when the corresponding PE is not a
+neighbour anymore. */
+
 typedef struct {
   CacheLevel * halo; // ghost cell indices for each level
-  void * buf;        // MPI buffer
+  double * buf;      // MPI buffer
+  size_t size;       // the allocated size of buf (in doubles)
   MPI_Request r;     // MPI request
+  bool pending;      // whether r is still active
   int depth;         // the maximum number of levels
   int pid;           // the rank of the PE  
   int maxdepth;      // the maximum depth for this PE (= depth or depth + 1)
@@ -16,6 +53,7 @@ typedef struct {
   Rcv * rcv;
   char * name;
   int npid;
+  int nused; // the number of PEs used since the last reset
 } RcvPid;
 
 typedef struct {
@@ -56,26 +94,46 @@ void rcv_print (Rcv * rcv, FILE * fp, const char * prefix)
 	fprintf (fp, "%s%g %g %g %d %d\n", prefix, x, y, z, rcv->pid, level);
 }
 
-static void rcv_free_buf (Rcv * rcv)
+static double * rcv_buffer (Rcv * rcv, size_t size)
+{
+  assert (!rcv->pending);
+  if (size > rcv->size) {
+    free (rcv->buf);
+    rcv->buf = malloc (sizeof (double)*size);
+    rcv->size = size;
+  }
+  return rcv->buf;
+}
+
+static void rcv_wait (Rcv * rcv)
 {
-  if (rcv->buf) {
+  if (rcv->pending) {
     prof_start ("rcv_pid_receive");
     MPI_Wait (&rcv->r, MPI_STATUS_IGNORE);
-    free (rcv->buf);
-    rcv->buf = NULL;
+    rcv->pending = false;
     prof_stop();
   }
 }
 
 static void rcv_destroy (Rcv * rcv)
 {
-  rcv_free_buf (rcv);
+  rcv_wait (rcv);
+  free (rcv->buf);
   for (int i = 0; i <= rcv->depth; i++)
-    if (rcv->halo[i].n > 0)
-      free (rcv->halo[i].p);
+    free (rcv->halo[i].p);
   free (rcv->halo);
 }
 
+/* empties the halos but keeps the buffers */
+static void rcv_reset (Rcv * rcv)
+{
+  rcv_wait (rcv);
+  for (int i = 0; i <= rcv->depth; i++)
+    rcv->halo[i].n = 0;
+  rcv->maxdepth = 0;
+}
+
+
 static RcvPid * rcv_pid_new (const char * name)
 {
   RcvPid * r = qcalloc (1, RcvPid);
@@ -99,8 +157,19 @@ static Rcv * rcv_pid_pointer (RcvPid * p, int pid)
     rcv->depth = rcv->maxdepth = 0;
     rcv->halo = qmalloc (1, CacheLevel);
     rcv->buf = NULL;
+    rcv->size = 0;
+    rcv->pending = false;
     cache_level_init (&rcv->halo[0]);
   }
+
+  /* PEs are kept in the order in which they are first used since the
+     last reset */
+  if (i >= p->nused) {
+    Rcv rcv = p->rcv[i];
+    p->rcv[i] = p->rcv[p->nused];
+    p->rcv[p->nused] = rcv;
+    i = p->nused++;
+  }
   return &p->rcv[i];
 }
 
@@ -149,6 +218,21 @@ static void rcv_pid_destroy (RcvPid * p)
   free (p);
 }
 
+static void rcv_pid_reset (RcvPid * p)
+{
+  for (int i = 0; i < p->npid; i++)
+    rcv_reset (&p->rcv[i]);
+  p->nused = 0;
+}
+
+static void rcv_pid_compact (RcvPid * p)
+{
+  // removes the PEs which have not been used since the last reset
+  for (int i = p->nused; i < p->npid; i++)
+    rcv_destroy (&p->rcv[i]);
+  p->npid = p->nused;
+}
+
 static Boundary * mpi_boundary = NULL;
 
 #define BOUNDARY_TAG(level) (level)
@@ -164,15 +248,15 @@ static void apply_bc (Rcv * rcv, scalar * list, scalar * listv,
   double * b = rcv->buf;
   foreach_cache_level(rcv->halo[l], l) {
     for (scalar s in list) {
-      memcpy (&s[], b, sizeof(double)*s.block);
+      set_block (s, b);
       b += s.block;
     }
     for (vector v in listf)
       foreach_dimension() {
-	memcpy (&v.x[], b, sizeof(double)*v.x.block);
+	set_block (v.x, b);
 	b += v.x.block;
 	if (*b != nodata && allocated(1))
-	  memcpy (&v.x[1], b, sizeof(double)*v.x.block);
+	  set_block (v.x, b, 1);
 	b += v.x.block;
       }
     for (scalar s in listv) {
@@ -181,21 +265,19 @@ static void apply_bc (Rcv * rcv, scalar * list, scalar * listv,
 #if dimension == 3
 	  for (int k = 0; k <= 1; k++) {
 	    if (*b != nodata && allocated(i,j,k))
-	      memcpy (&s[i,j,k], b, sizeof(double)*s.block);
+	      set_block (s, b, i, j, k);
 	    b += s.block;
 	  }
 #else // dimension == 2
           {
 	    if (*b != nodata && allocated(i,j))
-	      memcpy (&s[i,j], b, sizeof(double)*s.block);
+	      set_block (s, b, i, j);
 	    b += s.block;	    
           }
 #endif // dimension == 2
     }
   }
-  size_t size = b - (double *) rcv->buf;
-  free (rcv->buf);
-  rcv->buf = NULL;
+  size_t size = b - rcv->buf;
 
   int rlen;
   MPI_Get_count (&s, MPI_DOUBLE, &rlen);
@@ -308,44 +390,37 @@ static int vectors_lenb (vector * list) {
   return len;
 }
 
-static void rcv_pid_receive (RcvPid * m, scalar * list, scalar * listv,
-			     vector * listf, int l)
+static void rcv_pid_post (RcvPid * m, int len, int l)
 {
-  if (m->npid == 0)
-    return;
-  
-  prof_start ("rcv_pid_receive");
-
-  int len = list_lenb (list) + 2*dimension*vectors_lenb (listf) +
-    (1 << dimension)*list_lenb (listv);
-
-  MPI_Request r[m->npid];
-  Rcv * rrcv[m->npid]; // fixme: using NULL requests should be OK
-  int nr = 0;
+  /* initiate non-blocking receives */
   for (int i = 0; i < m->npid; i++) {
     Rcv * rcv = &m->rcv[i];
     if (l <= rcv->depth && rcv->halo[l].n > 0) {
-      assert (!rcv->buf);
-      rcv->buf = malloc (sizeof (double)*rcv->halo[l].n*len);
+      double * buf = rcv_buffer (rcv, rcv->halo[l].n*len);
 #if 0
       fprintf (stderr, "%s receiving %d doubles from %d level %d\n",
 	       m->name, rcv->halo[l].n*len, rcv->pid, l);
       fflush (stderr);
 #endif
-#if 1 /* initiate non-blocking receive */
-      MPI_Irecv (rcv->buf, rcv->halo[l].n*len, MPI_DOUBLE, rcv->pid,
-		 BOUNDARY_TAG(l), MPI_COMM_WORLD, &r[nr]);
-      rrcv[nr++] = rcv;
-#else /* blocking receive (useful for debugging) */
-      MPI_Status s;
-      mpi_recv_check (rcv->buf, rcv->halo[l].n*len, MPI_DOUBLE, rcv->pid,
-		      BOUNDARY_TAG(l), MPI_COMM_WORLD, &s, "rcv_pid_receive");
-      apply_bc (rcv, list, listf, listv, l, s);
-#endif
+      MPI_Irecv (buf, rcv->halo[l].n*len, MPI_DOUBLE, rcv->pid,
+		 BOUNDARY_TAG(l), MPI_COMM_WORLD, &rcv->r);
+      rcv->pending = true;
     }
   }
+}
+
+static void rcv_pid_complete (RcvPid * m, scalar * list, scalar * listv,
+			      vector * listf, int l)
+{
+  MPI_Request r[m->npid];
+  Rcv * rrcv[m->npid];
+  int nr = 0;
+  for (int i = 0; i < m->npid; i++)
+    if (m->rcv[i].pending) {
+      rrcv[nr] = &m->rcv[i];
+      r[nr++] = m->rcv[i].r;
+    }
 
-  /* non-blocking receives (does nothing when using blocking receives) */
   if (nr > 0) {
     int i;
     MPI_Status s;
@@ -353,12 +428,28 @@ static void rcv_pid_receive (RcvPid * m, scalar * list, scalar * listv,
     while (i != MPI_UNDEFINED) {
       Rcv * rcv = rrcv[i];
       assert (l <= rcv->depth && rcv->halo[l].n > 0);
-      assert (rcv->buf);
+      rcv->pending = false;
       apply_bc (rcv, list, listv, listf, l, s);
       mpi_waitany (nr, r, &i, &s);
     }
   }
+}
+
+static int rcv_pid_len (scalar * list, scalar * listv, vector * listf)
+{
+  return list_lenb (list) + 2*dimension*vectors_lenb (listf) +
+    (1 << dimension)*list_lenb (listv);
+}
+
+static void rcv_pid_receive (RcvPid * m, scalar * list, scalar * listv,
+			     vector * listf, int l)
+{
+  if (m->npid == 0)
+    return;
   
+  prof_start ("rcv_pid_receive");
+  rcv_pid_post (m, rcv_pid_len (list, listv, listf), l);
+  rcv_pid_complete (m, list, listv, listf, l);
   prof_stop();
 }
 
@@ -367,7 +458,7 @@ static void rcv_pid_wait (RcvPid * m)
 {
   /* wait for completion of send requests */
   for (int i = 0; i < m->npid; i++)
-    rcv_free_buf (&m->rcv[i]);
+    rcv_wait (&m->rcv[i]);
 }
 
 static void rcv_pid_send (RcvPid * m, scalar * list, scalar * listv,
@@ -378,27 +469,24 @@ static void rcv_pid_send (RcvPid * m, scalar * list, scalar * listv,
 
   prof_start ("rcv_pid_send");
 
-  int len = list_lenb (list) + 2*dimension*vectors_lenb (listf) +
-    (1 << dimension)*list_lenb (listv);
+  int len = rcv_pid_len (list, listv, listf);
 
   /* send ghost values */
   for (int i = 0; i < m->npid; i++) {
     Rcv * rcv = &m->rcv[i];
     if (l <= rcv->depth && rcv->halo[l].n > 0) {
-      assert (!rcv->buf);
-      rcv->buf = malloc (sizeof (double)*rcv->halo[l].n*len);
-      double * b = rcv->buf;
+      double * b = rcv_buffer (rcv, rcv->halo[l].n*len);
       foreach_cache_level(rcv->halo[l], l) {
 	for (scalar s in list) {
-	  memcpy (b, &s[], sizeof(double)*s.block);
+	  get_block (b, s);
 	  b += s.block;
 	}
 	for (vector v in listf)
 	  foreach_dimension() {
-	    memcpy (b, &v.x[], sizeof(double)*v.x.block);
+	    get_block (b, v.x);
 	    b += v.x.block;
 	    if (allocated(1))
-	      memcpy (b, &v.x[1], sizeof(double)*v.x.block);
+	      get_block (b, v.x, 1);
 	    else
 	      *b = nodata;
 	    b += v.x.block;
@@ -409,7 +497,7 @@ static void rcv_pid_send (RcvPid * m, scalar * list, scalar * listv,
 #if dimension == 3
 	      for (int k = 0; k <= 1; k++) {
 		if (allocated(i,j,k))
-		  memcpy (b, &s[i,j,k], sizeof(double)*s.block);
+		  get_block (b, s, i, j, k);
 		else
 		  *b = nodata;
 		b += s.block;
@@ -417,7 +505,7 @@ static void rcv_pid_send (RcvPid * m, scalar * list, scalar * listv,
 #else // dimension == 2
 	      {
 		if (allocated(i,j))
-		  memcpy (b, &s[i,j], sizeof(double)*s.block);
+		  get_block (b, s, i, j);
 		else
 		  *b = nodata;
 		b += s.block;
@@ -430,28 +518,37 @@ static void rcv_pid_send (RcvPid * m, scalar * list, scalar * listv,
 	       m->name, rcv->halo[l].n*len, rcv->pid, l);
       fflush (stderr);
 #endif
-      MPI_Isend (rcv->buf, (b - (double *) rcv->buf),
+      MPI_Isend (rcv->buf, (b - rcv->buf),
 		 MPI_DOUBLE, rcv->pid, BOUNDARY_TAG(l), MPI_COMM_WORLD,
 		 &rcv->r);
+      rcv->pending = true;
     }
   }
 
   prof_stop();
 }
 
-static void rcv_pid_sync (SndRcv * m, scalar * list, int l)
+/* splits the list into "regular", vertex and face fields */
+static void rcv_pid_lists (scalar * list,
+			   scalar ** listr, scalar ** listv, vector ** listf)
 {
-  scalar * listr = NULL, * listv = NULL;
-  vector * listf = NULL;
+  *listr = *listv = NULL, *listf = NULL;
   for (scalar s in list)
     if (!is_constant(s) && s.block > 0) {
       if (s.face)
-	listf = vectors_add (listf, s.v);
+	*listf = vectors_add (*listf, s.v);
       else if (s.restriction == restriction_vertex)
-	listv = list_add (listv, s);
+	*listv = list_add (*listv, s);
       else
-	listr = list_add (listr, s);
+	*listr = list_add (*listr, s);
     }
+}
+
+static void rcv_pid_sync (SndRcv * m, scalar * list, int l)
+{
+  scalar * listr, * listv;
+  vector * listf;
+  rcv_pid_lists (list, &listr, &listv, &listf);
   rcv_pid_send (m->snd, listr, listv, listf, l);
   rcv_pid_receive (m->rcv, listr, listv, listf, l);
   rcv_pid_wait (m->snd);
@@ -460,6 +557,38 @@ static void rcv_pid_sync (SndRcv * m, scalar * list, int l)
   free (listv);
 }
 
+/**
+## Split-phase exchanges
+
+For [split-phase](/src/grid/cartesian-common.h#split-phase-boundary-conditions)
+boundary conditions, `mpi_boundary_start()` posts the receives and
+sends of the level halos and applies the other (i.e. physical)
+boundary conditions, which only depend on local values. The
+exchanges are completed by `mpi_boundary_finish()`, which then
+applies the "root" halos (which depend on the values just received)
+and the physical boundary conditions again, to update the ghost values
+which depend on halo values.
+
+This is only possible when the level halos are all that is needed
+i.e. when the tree is full (see `tree_boundary_level()`). Otherwise
+boundary conditions are applied entirely by `mpi_boundary_start()`. */
+
+static struct {
+  scalar * listr, * listv;
+  vector * listf;
+  scalar * list;
+  int l;
+  bool pending;
+} mpi_split = {NULL};
+
+static void box_boundaries_level (scalar * list, int l)
+{
+  Boundary ** i = boundaries, * b;
+  while ((b = *i++))
+    if (b != mpi_boundary && b->level)
+      b->level (b, list, l);
+}
+
 static void snd_rcv_destroy (SndRcv * m)
 {
   rcv_pid_destroy (m->rcv);
@@ -480,6 +609,7 @@ static void snd_rcv_init (SndRcv * m, const char * name)
 static void mpi_boundary_destroy (Boundary * b)
 {
   MpiBoundary * m = (MpiBoundary *) b;
+  assert (!mpi_split.pending);
   snd_rcv_destroy (&m->mpi_level);
   snd_rcv_destroy (&m->mpi_level_root);
   snd_rcv_destroy (&m->restriction);
@@ -503,6 +633,58 @@ static void mpi_boundary_restriction (const Boundary * b, scalar * list, int l)
   rcv_pid_sync (&m->restriction, list, l);
 }
 
+trace
+static void mpi_boundary_start (scalar * list, int l)
+{
+  assert (!mpi_split.pending);
+  if (npe() == 1 || !tree_is_full()) {
+    cartesian_boundary_start (list, l);
+    return;
+  }
+
+  MpiBoundary * m = (MpiBoundary *) mpi_boundary;
+  mpi_split.l = l < 0 ? depth() : l;
+  mpi_split.list = list_copy (list);
+  rcv_pid_lists (list, &mpi_split.listr, &mpi_split.listv, &mpi_split.listf);
+  if (m->mpi_level.rcv->npid > 0) {
+    prof_start ("rcv_pid_receive");
+    rcv_pid_post (m->mpi_level.rcv,
+		  rcv_pid_len (mpi_split.listr, mpi_split.listv,
+			       mpi_split.listf),
+		  mpi_split.l);
+    prof_stop();
+  }
+  rcv_pid_send (m->mpi_level.snd, mpi_split.listr, mpi_split.listv,
+		mpi_split.listf, mpi_split.l);
+  box_boundaries_level (list, mpi_split.l);
+  mpi_split.pending = true;
+
+  if (l < 0)
+    for (scalar s in list)
+      if (!is_constant(s))
+	s.dirty = false;
+}
+
+trace
+static void mpi_boundary_finish()
+{
+  if (!mpi_split.pending)
+    return;
+
+  MpiBoundary * m = (MpiBoundary *) mpi_boundary;
+  prof_start ("rcv_pid_receive");
+  rcv_pid_complete (m->mpi_level.rcv, mpi_split.listr, mpi_split.listv,
+		    mpi_split.listf, mpi_split.l);
+  prof_stop();
+  rcv_pid_wait (m->mpi_level.snd);
+  rcv_pid_sync (&m->mpi_level_root, mpi_split.list, mpi_split.l);
+  box_boundaries_level (mpi_split.list, mpi_split.l);
+
+  free (mpi_split.listr), free (mpi_split.listv), free (mpi_split.listf);
+  free (mpi_split.list);
+  mpi_split.pending = false;
+}
+
 void mpi_boundary_new()
 {
   mpi_boundary = (Boundary *) qcalloc (1, MpiBoundary);
@@ -516,6 +698,8 @@ void mpi_boundary_new()
   mpi->send = array_new();
   mpi->receive = array_new();
   add_boundary (mpi_boundary);
+  boundary_start = mpi_boundary_start;
+  boundary_finish = mpi_boundary_finish;
 }
 
 static FILE * fopen_prefix (FILE * fp, const char * name, char * prefix)
@@ -682,15 +866,16 @@ void debug_mpi (FILE * fp1)
     fclose (fp);
 }
 
-static void snd_rcv_free (SndRcv * p)
+static void snd_rcv_reset (SndRcv * p)
+{
+  rcv_pid_reset (p->rcv);
+  rcv_pid_reset (p->snd);
+}
+
+static void snd_rcv_compact (SndRcv * p)
 {
-  char name[strlen(p->rcv->name) + 1];
-  strcpy (name, p->rcv->name);
-  rcv_pid_destroy (p->rcv);
-  p->rcv = rcv_pid_new (name);
-  strcpy (name, p->snd->name);
-  rcv_pid_destroy (p->snd);
-  p->snd = rcv_pid_new (name);
+  rcv_pid_compact (p->rcv);
+  rcv_pid_compact (p->snd);
 }
 
 static bool is_root (Point point)
@@ -866,10 +1051,12 @@ void mpi_boundary_update_buffers()
   SndRcv * mpi_level = &m->mpi_level;
   SndRcv * mpi_level_root = &m->mpi_level_root;
   SndRcv * restriction = &m->restriction;
+  assert (!mpi_split.pending);
 
-  snd_rcv_free (mpi_level);
-  snd_rcv_free (mpi_level_root);
-  snd_rcv_free (restriction);
+  /* the halos are rebuilt from scratch, but the buffers are kept */
+  snd_rcv_reset (mpi_level);
+  snd_rcv_reset (mpi_level_root);
+  snd_rcv_reset (restriction);
   
   static const unsigned short used = 1 << user;
   foreach_cell() {
@@ -990,6 +1177,10 @@ void mpi_boundary_update_buffers()
 	continue; // level == l
       }
 
+  snd_rcv_compact (mpi_level);
+  snd_rcv_compact (mpi_level_root);
+  snd_rcv_compact (restriction);
+
   /* we update the list of send/receive pids */
   m->send->len = m->receive->len = 0;
   rcv_pid_append_pids (mpi_level->snd, m->send);
@@ -1162,7 +1353,10 @@ void mpi_boundary_coarsen (int l, int too_fine)
 	else if (is_leaf(cell) && cell.neighbors && REMOTE()->leaf) {
 	  int pid = cell.pid;
 	  foreach_child()
-	    cell.pid = pid;
+	    if (cell.pid != pid) {
+	      tree_changed (point);
+	      cell.pid = pid;
+	    }
 	}
       }
       continue;
@@ -1292,126 +1486,6 @@ void mpi_partitioning()
   mpi_boundary_update_buffers();
 }
 
-void restore_mpi (FILE * fp, scalar * list1)
-{
-  long index = 0, nt = 0, start = ftell (fp);
-  scalar size[], * list = list_concat ({size}, list1);;
-  long offset = sizeof(double)*list_len(list);
-
-  // read local cells
-  static const unsigned short set = 1 << user;
-  scalar * listm = is_constant(cm) ? NULL : (scalar *){fm};
-  foreach_cell()
-    if (balanced_pid (index, nt, npe()) <= pid()) {
-      unsigned flags;
-      if (fread (&flags, sizeof(unsigned), 1, fp) != 1) {
-	fprintf (stderr, "restore(): error: expecting 'flags'\n");
-	exit (1);
-      }
-      for (scalar s in list) {
-	double val;
-	if (fread (&val, sizeof(double), 1, fp) != 1) {
-	  fprintf (stderr, "restore(): error: expecting scalar\n");
-	  exit (1);
-	}
-	if (s.i != INT_MAX)
-	  s[] = val;
-      }
-      if (level == 0)
-	nt = size[];
-      cell.pid = balanced_pid (index, nt, npe());
-      cell.flags |= set;
-      if (!(flags & leaf) && is_leaf(cell)) {
-	if (balanced_pid (index + size[] - 1, nt, npe()) < pid()) {
-	  fseek (fp, (sizeof(unsigned) + offset)*(size[] - 1), SEEK_CUR);
-	  index += size[];
-	  continue;
-	}
-	refine_cell (point, listm, 0, NULL);
-      }
-      index++;
-      if (is_leaf(cell))
-	continue;
-    }
-
-  // read non-local neighbors
-  fseek (fp, start, SEEK_SET);
-  index = 0;
-  foreach_cell() {
-    unsigned flags;
-    if (fread (&flags, sizeof(unsigned), 1, fp) != 1) {
-      fprintf (stderr, "restore(): error: expecting 'flags'\n");
-      exit (1);
-    }
-    if (cell.flags & set)
-      fseek (fp, offset, SEEK_CUR);
-    else {
-      for (scalar s in list) {
-	double val;
-	if (fread (&val, sizeof(double), 1, fp) != 1) {
-	  fprintf (stderr, "restore(): error: expecting a scalar\n");
-	  exit (1);
-	}
-	if (s.i != INT_MAX)
-	  s[] = val;
-      }
-      cell.pid = balanced_pid (index, nt, npe());
-      if (is_leaf(cell) && cell.neighbors) {
-	int pid = cell.pid;
-	foreach_child()
-	  cell.pid = pid;
-      }
-    }
-    if (!(flags & leaf) && is_leaf(cell)) {
-      bool locals = false;
-      foreach_neighbor(1)
-	if ((cell.flags & set) && (is_local(cell) || is_root(point))) {
-	  locals = true; break;
-	}
-      if (locals)
-	refine_cell (point, listm, 0, NULL);
-      else {
-	fseek (fp, (sizeof(unsigned) + offset)*(size[] - 1), SEEK_CUR);
-	index += size[];
-	continue;
-      }
-    }
-    index++;
-    if (is_leaf(cell))
-      continue;
-  }
-
-  /* set active flags */
-  foreach_cell_post (is_active (cell)) {
-    cell.flags &= ~set;
-    if (is_active (cell)) {
-      if (is_leaf (cell)) {
-	if (cell.neighbors > 0) {
-	  int pid = cell.pid;
-	  foreach_child()
-	    cell.pid = pid;
-	}
-	if (!is_local(cell))
-	  cell.flags &= ~active;
-      }
-      else if (!is_local(cell)) {
-	bool inactive = true;
-	foreach_child()
-	  if (is_active(cell)) {
-	    inactive = false; break;
-	  }
-	if (inactive)
-	  cell.flags &= ~active;
-      }
-    }
-  }
-
-  flag_border_cells();
-
-  mpi_boundary_update (list);
-  free (list);
-}
-
 /**
 # *z_indexing()*: fills *index* with the Z-ordering index.
    
@@ -70,6 +70,12 @@ typedef struct {
   int n, nm;
 } CacheLevel;
 
+/* active cells of a level ordered by colour (see cell_colour()) */
+typedef struct {
+  CacheLevel cells;
+  int start[(1 << dimension) + 1]; /* first index of each colour */
+} ColourLevel;
+
 typedef struct {
   int i;
 #if dimension >= 2
@@ -100,6 +106,7 @@ static size_t _size (size_t depth)
   return (1 << depth) + 2*GHOSTS;
 }
 
+#if !TREE_SOA
 static size_t poolsize (size_t depth, size_t size)
 {
   // the maximum amount of data at a given level
@@ -111,19 +118,160 @@ static size_t poolsize (size_t depth, size_t size)
   return cube(_size(depth))*size;
 #endif
 }
+#endif // !TREE_SOA
+
+#if TREE_SOA
+/**
+## Structure-of-arrays storage
+
+By default the data of a cell directly follow its `Cell` header
+(i.e. the fields are interleaved, an "array of structures"). When
+compiled with `-DTREE_SOA=1`, each memory pool chunk holds the headers
+of `soa.n` cells followed by one contiguous array of `soa.n` values
+for each field. A loop which only accesses a few fields then only
+needs to bring these fields into cache.
+
+The `Memindex` still returns the address of the cell header. As a
+header and a value have the same size, the value of field `v` is
+found `(v + 1)*soa.n` values further. */
+
+#ifndef TREE_SOA_CHUNK
+# define TREE_SOA_CHUNK (1 << 18)
+#endif
+
+typedef struct {
+  size_t n;     // the number of cells in a chunk
+  size_t chunk; // the size of a chunk in bytes
+} SoaLayout;
+
+static SoaLayout soa = {0};
+
+static SoaLayout soa_layout (size_t datasize)
+{
+  assert (sizeof(Cell) == sizeof(real));
+  SoaLayout l;
+  l.n = (TREE_SOA_CHUNK - sizeof(Pool))/(sizeof(Cell) + datasize);
+  // the number of cells must be a multiple of the block size
+  l.n = max (l.n - l.n % (1 << dimension), 8*(1 << dimension));
+  l.chunk = sizeof(Pool) + l.n*(sizeof(Cell) + datasize);
+  return l;
+}
+
+@define cell_val(_m,_v) ((real *)(_m))[((_v) + 1)*soa.n]
+
+/* sets to zero the data of `n` consecutive cells */
+static void soa_clear (char * c, int n)
+{
+  real * v = (real *) c;
+  for (int i = 0; i < datasize/sizeof(real); i++) {
+    v += soa.n;
+    memset (v, 0, n*sizeof(real));
+  }
+}
+#else // !TREE_SOA
+@define cell_val(_m,_v) ((real *)((_m) + sizeof(Cell)))[_v]
+#endif // !TREE_SOA
+
+/**
+## Mixed precision storage
+
+When compiled with `-DMIXED_PRECISION=1`, the fields declared with
+the `float` qualifier (e.g. `float scalar T[];`) are stored in single
+precision while all the other fields (pressure, multigrid residuals
+etc.) are still stored in double precision.
+
+The data of a cell are then no longer an array of `real`: the byte
+offset of field `v` within the data of a cell is `_offset[v]`, its
+lowest bit being set for single precision fields. `fieldsize` is the
+size of the data of a cell (in bytes). Field values are always read
+as doubles and [qcc](/src/ast/translate.c#mixed-precision) turns
+assignments into stores of the right type. The accesses to the fields
+allocated by a declaration (e.g. `float scalar T[];`) are typed at
+compile time. Only the accesses to other fields (function arguments,
+lists etc.) test the precision at run time.
+
+The `nodata` value is stored as `(float) nodata` in single
+precision and read back as `nodata`. The `undefined` value (a
+signaling NaN, see [config.h](config.h)) cannot be converted to
+single precision without raising FE_INVALID: qcc stores single
+precision values with `_float_store()`, which copies `undefined` as a
+single precision signaling NaN, read back as `undefined`. */
+
+#if MIXED_PRECISION
+# if TREE_SOA
+#  error "MIXED_PRECISION cannot be combined with TREE_SOA"
+# endif
+
+size_t * _offset = NULL;
+size_t fieldsize = 0;
+
+@define _cell_data(_m,_v) ((_m) + sizeof(Cell) + (_offset[_v] & ~(size_t)1))
+@define _cell_float(_m,_v) (*((float *) _cell_data(_m,_v)))
+@define _cell_double(_m,_v) (*((double *) _cell_data(_m,_v)))
+@define _cell_read(_m,_v) ((_offset[_v] & 1) ? _float_value (_cell_float(_m,_v)) : _cell_double(_m,_v))
+@define _cell_write(_m,_v,_x) ((_offset[_v] & 1) ? (void) (_cell_float(_m,_v) = _float_store (_x)) : (void) (_cell_double(_m,_v) = (_x)))
+@define _is_float(a) (_offset[(a).i] & 1)
+
+/* the address of a value of `s` (which must be double precision) */
+static inline double * _double_ref (scalar s, double * p)
+{
+  if (_offset[s.i] & 1) {
+    fprintf (stderr, "tree: cannot take the address of single precision "
+	     "field '%s'\n", s.name);
+    exit (1);
+  }
+  return p;
+}
+
+@include <stdint.h>
+
+static const uint32_t _float_undefined = 0x7f800001;
+
+static inline float _float_store (double x)
+{
+  double u = undefined;
+  if (!memcmp (&x, &u, sizeof (double))) {
+    float f;
+    memcpy (&f, &_float_undefined, sizeof (float));
+    return f;
+  }
+  return x;
+}
+
+static inline double _float_value (float x)
+{
+  uint32_t u;
+  memcpy (&u, &x, sizeof (float));
+  if (u == _float_undefined)
+    return undefined;
+  return x == (float) nodata ? nodata : x;
+}
+#else // !MIXED_PRECISION
+# define fieldsize datasize
+#endif // !MIXED_PRECISION
+
+static Mempool * layer_pool (int depth)
+{
+#if TREE_SOA
+  // the root layer allocates cells one at a time
+  size_t block = (depth == 0 ? 1 : 1 << dimension)*sizeof(Cell);
+  return mempool_new_reserved (soa.chunk, sizeof(Pool) + soa.n*sizeof(Cell),
+			       block);
+#else
+  if (depth == 0)
+    return NULL; // the root layer does not use a pool
+  size_t size = sizeof(Cell) + fieldsize;
+  // the block size is 2^dimension*size because we allocate
+  // 2^dimension children at a time
+  return mempool_new (poolsize (depth, size), (1 << dimension)*size);
+#endif
+}
 
 static Layer * new_layer (int depth)
 {
   Layer * l = qmalloc (1, Layer);
   l->len = _size (depth);
-  if (depth == 0)
-    l->pool = NULL; // the root layer does not use a pool
-  else {
-    size_t size = sizeof(Cell) + datasize;
-    // the block size is 2^dimension*size because we allocate
-    // 2^dimension children at a time
-    l->pool = mempool_new (poolsize (depth, size), (1 << dimension)*size);
-  }
+  l->pool = layer_pool (depth);
   l->m = mem_new (l->len);
   l->nc = 0;
   return l;
@@ -139,6 +287,49 @@ static void destroy_layer (Layer * l)
 
 // Tree
 
+/**
+## Incremental cache updates
+
+By default, the caches of leaves, faces, vertices and per-level
+indices are entirely rebuilt after each modification of the tree.
+When compiled with `-DTREE_INCREMENTAL_CACHE=1`, the domain is instead
+divided into *segments*: the subtrees rooted at the cells of level
+`TREE_SEGMENT_LEVEL`. Each segment keeps a copy of the cache entries
+it contributed during the last traversal. When cells are refined or
+coarsened, only the segments close to the modified cells are marked
+as dirty and traversed again, the entries of clean segments are simply
+copied back, in the same order. The stored entries roughly double the
+memory used by the caches.
+
+A modification at a level coarser than `TREE_SEGMENT_LEVEL` marks all
+the segments it covers. A modification of the tree depth (or of the
+cell flags, e.g. by `mask()`) triggers a full rebuild.
+
+With MPI, the segments are also marked when cells change process
+(when the grid is rebalanced) or when the halos are updated. */
+
+#ifndef TREE_SEGMENT_LEVEL
+# define TREE_SEGMENT_LEVEL (dimension == 3 ? 4 : 5)
+#endif
+
+#if TREE_INCREMENTAL_CACHE
+# define TREE_SEGMENTS 1
+#else
+# define TREE_SEGMENTS 0
+#endif
+
+/* the (conservative) distance, in cells of the modified level, beyond
+   which cache entries are unaffected by a refinement or coarsening */
+#define SEGMENT_RADIUS (2*BGHOSTS + 2)
+
+enum { seg_active, seg_prolongation, seg_boundary, seg_restriction };
+
+typedef struct {
+  Cache leaves, faces, vertices;
+  Cache levels; /* per-level indices (flags is seg_active, etc.) */
+  bool dirty, boundary; /* boundary is true if levels has boundary indices */
+} Segment;
+
 typedef struct {
   Grid g;
   Layer ** L; /* the grids at each level */
@@ -152,8 +343,14 @@ typedef struct {
   CacheLevel * boundary;  /* boundary indices for each level */
   /* indices of boundary cells with non-boundary parents */
   CacheLevel * restriction;
+  ColourLevel * colours; /* coloured active cells (built on demand) */
+  int ncolours;          /* number of levels in colours */
+  int version;           /* changed each time the caches are rebuilt */
   
-  bool dirty;       /* whether caches should be updated */
+  bool dirty;       /* whether caches should be entirely rebuilt */
+  bool coloured;    /* whether colours is up to date */
+  bool changed;     /* whether some segments should be updated */
+  Segment * segments;
 } Tree;
 
 #define tree ((Tree *)grid)
@@ -227,6 +424,17 @@ void cache_shrink (Cache * c)
   cache_level_shrink ((CacheLevel *)c);
 }
 
+/* appends the `n` indices `p` to `c` */
+static void cache_extend (Cache * c, const Index * p, int n)
+{
+  if (c->n + n > c->nm) {
+    c->nm = ((c->n + n)/BSIZE + 1)*BSIZE;
+    qrealloc (c->p, c->nm, Index);
+  }
+  memcpy (c->p + c->n, p, n*sizeof (Index));
+  c->n += n;
+}
+
 #undef BSIZE
 
 /* low-level memory management */
@@ -307,9 +515,35 @@ void cache_shrink (Cache * c)
 @
 			
 /***** Data macros *****/
+#if TREE_SOA
+@undef val
+@define val(a,k,l,n)    cell_val(NEIGHBOR(k,l,n), _index(a,n))
+#elif MIXED_PRECISION
+@undef val
+@define val(a,k,l,n)    _cell_read(NEIGHBOR(k,l,n), _index(a,n))
+@define fine(a,k,p,n)   _cell_read(CHILD(k,p,n), _index(a,n))
+@define coarse(a,k,p,n) _cell_read(PARENT(k,p,n), _index(a,n))
+
+/* the accesses of known precision, assignments and addresses used by qcc */
+@define _val_float(a,k,l,n)     _cell_float(NEIGHBOR(k,l,n), _index(a,n))
+@define _val_double(a,k,l,n)    _cell_double(NEIGHBOR(k,l,n), _index(a,n))
+@define _val_ref(a,k,l,n)       (*_double_ref (a, &_val_double(a,k,l,n)))
+@define _val_float_value(a,k,l,n) _float_value (_val_float(a,k,l,n))
+@define _fine_float(a,k,p,n)    _cell_float(CHILD(k,p,n), _index(a,n))
+@define _fine_double(a,k,p,n)   _cell_double(CHILD(k,p,n), _index(a,n))
+@define _fine_ref(a,k,p,n)      (*_double_ref (a, &_fine_double(a,k,p,n)))
+@define _fine_float_value(a,k,p,n) _float_value (_fine_float(a,k,p,n))
+@define _coarse_float(a,k,p,n)  _cell_float(PARENT(k,p,n), _index(a,n))
+@define _coarse_double(a,k,p,n) _cell_double(PARENT(k,p,n), _index(a,n))
+@define _coarse_ref(a,k,p,n)    (*_double_ref (a, &_coarse_double(a,k,p,n)))
+@define _coarse_float_value(a,k,p,n) _float_value (_coarse_float(a,k,p,n))
+#else
 @define data(k,l,n)     ((double *) (NEIGHBOR(k,l,n) + sizeof(Cell)))
-@define fine(a,k,p,n)   ((double *) (CHILD(k,p,n) + sizeof(Cell)))[_index(a,n)]
-@define coarse(a,k,p,n) ((double *) (PARENT(k,p,n) + sizeof(Cell)))[_index(a,n)]
+#endif
+#if !MIXED_PRECISION
+@define fine(a,k,p,n)   cell_val(CHILD(k,p,n), _index(a,n))
+@define coarse(a,k,p,n) cell_val(PARENT(k,p,n), _index(a,n))
+#endif
 
 @def POINT_VARIABLES
   VARIABLES
@@ -400,7 +634,7 @@ void cache_shrink (Cache * c)
 @define foreach_child_break() _l = _m = _n = 2
 #endif // dimension == 3
   
-#define update_cache() { if (tree->dirty) update_cache_f(); }
+#define update_cache() { if (tree->dirty || tree->changed) update_cache_f(); }
 
 #define is_refined(cell)      (!is_leaf (cell) && cell.neighbors && cell.pid >= 0)
 #define is_prolongation(cell) (!is_leaf(cell) && !cell.neighbors && cell.pid >= 0)
@@ -560,29 +794,219 @@ static inline void cache_append_face (Point point, unsigned short flags)
 
 #define FBOUNDARY 1 // fixme: this should work with zero
 
+static inline int segments_size (void)
+{
+  return 1 << dimension*TREE_SEGMENT_LEVEL;
+}
+
+static inline Segment * segment (Point p)
+{
+  int n = 1 << TREE_SEGMENT_LEVEL, index = p.i - GHOSTS;
+#if dimension >= 2
+  index = index*n + p.j - GHOSTS;
+#endif
+#if dimension >= 3
+  index = index*n + p.k - GHOSTS;
+#endif
+  return tree->segments + index;
+}
+
+static inline Cell * index_cell (const Index * p)
+{
+  Layer * L = tree->L[p->level];
+#if dimension == 1
+  return (Cell *) mem_data (L->m, p->i);
+#elif dimension == 2
+  return (Cell *) mem_data (L->m, p->i, p->j);
+#else // dimension == 3
+  return (Cell *) mem_data (L->m, p->i, p->j, p->k);
+#endif
+}
+
+static inline bool index_allocated (const Index * p)
+{
+  if (p->level > depth())
+    return false;
+  Layer * L = tree->L[p->level];
+#if dimension == 1
+  return mem_allocated (L->m, p->i);
+#elif dimension == 2
+  return mem_allocated (L->m, p->i, p->j);
+#else // dimension == 3
+  return mem_allocated (L->m, p->i, p->j, p->k);
+#endif
+}
+
+static inline Point index_point (const Index * p)
+{
+  Point q = {0};
+  q.i = p->i;
+#if dimension >= 2
+  q.j = p->j;
+#endif
+#if dimension >= 3
+  q.k = p->k;
+#endif
+  q.level = p->level;
+  return q;
+}
+
+static void cache_level_append_index (CacheLevel * c, const Index * p)
+{
+  cache_level_append (c, index_point (p));
+}
+
+/* appends to the `kind` cache of `point.level` and records the index
+   in segment `s` (if any) */
+static inline void cache_level_record (CacheLevel * c, Point point,
+				       Segment * s, int kind)
+{
+  cache_level_append (&c[point.level], point);
+  if (s) {
+    cache_append (&s->levels, point, kind);
+    if (kind == seg_boundary)
+      s->boundary = true;
+  }
+}
+
+/* Marks all segments as dirty if `full` is true. Otherwise, clears
+   the vertex flags of dirty segments and of the coarse levels and
+   flags the boundary cells already claimed by clean segments. The
+   vertex flags of clean segments are left untouched. */
+static void segments_begin (bool full)
+{
+  Tree * q = tree;
+  int n = segments_size();
+  if (full || !q->segments) {
+    foreach_cache (q->vertices)
+      if (level <= depth() && allocated(0))
+	cell.flags &= ~vertex;
+    if (!TREE_SEGMENTS)
+      return;
+    if (!q->segments)
+      q->segments = qcalloc (n, Segment);
+    for (Segment * s = q->segments; s < q->segments + n; s++) {
+      s->dirty = true;
+      s->vertices.n = 0;
+    }
+    return;
+  }
+  for (Index * p = q->vertices.p; p < q->vertices.p + q->vertices.n; p++)
+    if (p->level < TREE_SEGMENT_LEVEL && index_allocated (p))
+      index_cell (p)->flags &= ~vertex;
+  for (Segment * s = q->segments; s < q->segments + n; s++)
+    if (s->dirty) {
+      for (Index * p = s->vertices.p; p < s->vertices.p + s->vertices.n; p++)
+	if (index_allocated (p))
+	  index_cell (p)->flags &= ~vertex;
+      /* the segment is not traversed (and its vertices not stored
+	 again) if it is below a leaf */
+      s->vertices.n = 0;
+    }
+#if FBOUNDARY
+    else if (s->boundary) {
+      for (Index * p = s->levels.p; p < s->levels.p + s->levels.n; p++)
+	if (p->flags == seg_boundary)
+	  index_cell (p)->flags |= 1 << user;
+    }
+#endif
+}
+
+/* copies the entries of clean segment `s` into the caches */
+static void segment_splice (Segment * s)
+{
+  Tree * q = tree;
+  cache_extend (&q->leaves, s->leaves.p, s->leaves.n);
+  cache_extend (&q->faces, s->faces.p, s->faces.n);
+  cache_extend (&q->vertices, s->vertices.p, s->vertices.n);
+  CacheLevel * c[] = {q->active, q->prolongation, q->boundary, q->restriction};
+  for (Index * p = s->levels.p; p < s->levels.p + s->levels.n; p++)
+    cache_level_append_index (&c[p->flags][p->level], p);
+}
+
+/* sets `c` to the `n` indices `p`, using as little memory as possible */
+static void cache_set (Cache * c, const Index * p, int n)
+{
+  if (n != c->nm) {
+    c->nm = n;
+    c->p = (Index *) realloc (c->p, (n > 0 ? n : 1)*sizeof (Index));
+  }
+  if (n > 0)
+    memcpy (c->p, p, n*sizeof (Index));
+  c->n = n;
+}
+
+/* stores the entries appended since `start` into segment `s` */
+static void segment_close (Segment * s, const int start[3])
+{
+  Tree * q = tree;
+  cache_set (&s->leaves, q->leaves.p + start[0], q->leaves.n - start[0]);
+  cache_set (&s->faces, q->faces.p + start[1], q->faces.n - start[1]);
+  cache_set (&s->vertices, q->vertices.p + start[2],
+	     q->vertices.n - start[2]);
+  if (s->levels.nm > s->levels.n) {
+    s->levels.nm = s->levels.n;
+    s->levels.p = (Index *) realloc (s->levels.p,
+				     (s->levels.n + 1)*sizeof (Index));
+  }
+  s->dirty = false;
+}
+
+static void segments_free (void)
+{
+  Tree * q = tree;
+  if (q->segments) {
+    for (Segment * s = q->segments; s < q->segments + segments_size(); s++) {
+      free (s->leaves.p);
+      free (s->faces.p);
+      free (s->vertices.p);
+      free (s->levels.p);
+    }
+    free (q->segments);
+    q->segments = NULL;
+  }
+}
+
 static void update_cache_f (void)
 {
   Tree * q = tree;
 
-  foreach_cache (q->vertices)
-    if (level <= depth() && allocated(0))
-      cell.flags &= ~vertex;
+  segments_begin (q->dirty);
   
   /* empty caches */
   q->leaves.n = q->faces.n = q->vertices.n = 0;
   for (int l = 0; l <= depth(); l++)
     q->active[l].n = q->prolongation[l].n =
       q->boundary[l].n = q->restriction[l].n = 0;
+  Segment * seg = NULL;
+  int start[3];
 #if FBOUNDARY
   const unsigned short fboundary = 1 << user;
   foreach_cell() {
 #else    
   foreach_cell_all() {
 #endif
+    if (TREE_SEGMENTS && level <= TREE_SEGMENT_LEVEL) {
+      if (seg) {
+	segment_close (seg, start);
+	seg = NULL;
+      }
+      if (level == TREE_SEGMENT_LEVEL) {
+	Segment * s = segment (point);
+	if (!s->dirty) {
+	  segment_splice (s);
+	  continue;
+	}
+	seg = s;
+	seg->levels.n = 0;
+	seg->boundary = false;
+	start[0] = q->leaves.n, start[1] = q->faces.n, start[2] = q->vertices.n;
+      }
+    }
     if (is_local(cell) && is_active(cell)) {
       // active cells
       //      assert (is_active(cell));
-      cache_level_append (&q->active[level], point);
+      cache_level_record (q->active, point, seg, seg_active);
     }
 #if !FBOUNDARY
     if (is_boundary(cell)) {
@@ -593,10 +1017,10 @@ static void update_cache_f (void)
 	  has_neighbors = true; break;
 	}
       if (has_neighbors)
-	cache_level_append (&q->boundary[level], point);
+	cache_level_record (q->boundary, point, seg, seg_boundary);
       // restriction for masked cells
       if (level > 0 && is_local(aparent(0)))
-	cache_level_append (&q->restriction[level], point);
+	cache_level_record (q->restriction, point, seg, seg_restriction);
     }
 #else
     // boundaries
@@ -604,13 +1028,13 @@ static void update_cache_f (void)
       // look in a 5x5 neighborhood for boundary cells
       foreach_neighbor (BGHOSTS)
 	if (allocated(0) && is_boundary(cell) && !(cell.flags & fboundary)) {
-	  cache_level_append (&q->boundary[level], point);
+	  cache_level_record (q->boundary, point, seg, seg_boundary);
 	  cell.flags |= fboundary;
 	}
     }
     // restriction for masked cells
     else if (level > 0 && is_local(aparent(0)))
-      cache_level_append (&q->restriction[level], point);
+      cache_level_record (q->restriction, point, seg, seg_restriction);
 #endif
     if (is_leaf (cell)) {
       if (is_local(cell)) {
@@ -641,7 +1065,7 @@ static void update_cache_f (void)
 	      }
 	// halo prolongation
         if (cell.neighbors > 0)
-	  cache_level_append (&q->prolongation[level], point);
+	  cache_level_record (q->prolongation, point, seg, seg_prolongation);
       }
       else if (!is_boundary(cell) || is_local(aparent(0))) { // non-local
 	// faces
@@ -662,6 +1086,8 @@ static void update_cache_f (void)
 #endif
     }
   }
+  if (seg)
+    segment_close (seg, start);
 
   /* optimize caches */
   cache_shrink (&q->leaves);
@@ -674,7 +1100,10 @@ static void update_cache_f (void)
     cache_level_shrink (&q->restriction[l]);
 }
   
-  q->dirty = false;
+  q->dirty = q->changed = false;
+  q->coloured = false;
+  static int version = 0; // unique across grids
+  q->version = ++version;
 
 #if FBOUNDARY
   for (int l = depth(); l >= 0; l--)
@@ -751,6 +1180,22 @@ static void update_cache_f (void)
 @
 @define end_foreach_level_or_leaf() } end_foreach_level(); }
 
+/* Cells of foreach_level_or_leaf() with colour `c` out of `nc`
+   colours. The active cells of each level are sorted by colour so
+   that each colour is a contiguous (parallel) loop. */
+
+@def foreach_level_or_leaf_colour(l, c, nc) {
+  update_colours();
+  for (int _l1 = min (l, depth()); _l1 >= 0; _l1--) {
+    ColourLevel _cl = tree->colours[_l1];
+    int _cs = (1 << dimension)/(nc);
+    CacheLevel _coloured = {_cl.cells.p + _cl.start[(c)*_cs],
+			    _cl.start[((c) + 1)*_cs] - _cl.start[(c)*_cs]};
+    foreach_cache_level (_coloured, _l1)
+      if (_l1 == l || is_leaf (cell)) {
+@
+@define end_foreach_level_or_leaf_colour() } end_foreach_cache_level(); } }
+
 @if TRASH
 @ undef trash
 @ define trash(list) reset(list, undefined)
@@ -768,7 +1213,11 @@ void reset (void * alist, double val)
       for (scalar s in list) {
 	if (!is_constant(s))
 	  for (int b = 0; b < s.block; b++)
-	    data(0,0,0)[s.i + b] = val;
+#if MIXED_PRECISION
+	    _cell_write (NEIGHBOR(0,0,0), s.i + b, val);
+#else
+	    cell_val(NEIGHBOR(0,0,0), s.i + b) = val;
+#endif
       }
     }
   }
@@ -785,6 +1234,7 @@ static CacheLevel * cache_level_resize (CacheLevel * name, int a)
 static void update_depth (int inc)
 {
   Tree * q = tree;
+  q->dirty = true;
   grid->depth += inc;
   q->L = &(q->L[-1]);
   qrealloc (q->L, grid->depth + 2, Layer *);
@@ -947,8 +1397,14 @@ static void alloc_children (Point point)
   /* low-level memory management */
   Layer * L = tree->L[point.level + 1];
   L->nc++;
-  size_t len = sizeof(Cell) + datasize;
+#if TREE_SOA
+  size_t len = sizeof(Cell);
   char * b = (char *) mempool_alloc0 (L->pool);
+  soa_clear (b, 1 << dimension);
+#else
+  size_t len = sizeof(Cell) + fieldsize;
+  char * b = (char *) mempool_alloc0 (L->pool);
+#endif
   int i = 2*point.i - GHOSTS;
   for (int k = 0; k < 2; k++, i++) {
 #if dimension == 1
@@ -1040,9 +1496,54 @@ static void free_children (Point point)
 }
 #endif // dimension == 3
 
+/* Marks the segments within `SEGMENT_RADIUS` of `point` as dirty, or
+   the whole tree if this is not possible. The cells of levels coarser
+   than `TREE_SEGMENT_LEVEL` are not stored in segments, only their
+   neighborhood needs to be marked. */
+static void tree_changed (Point point)
+{
+  Tree * q = tree;
+  if (!TREE_SEGMENTS || q->dirty || !q->segments) {
+    q->dirty = true;
+    return;
+  }
+  int n = 1 << TREE_SEGMENT_LEVEL, shift = point.level - TREE_SEGMENT_LEVEL;
+  int o[3] = {point.i}, lo[3] = {0}, hi[3] = {0};
+#if dimension >= 2
+  o[1] = point.j;
+#endif
+#if dimension >= 3
+  o[2] = point.k;
+#endif
+  for (int d = 0; d < dimension; d++) {
+    if (shift >= 0) {
+      lo[d] = (o[d] - GHOSTS - SEGMENT_RADIUS) >> shift;
+      hi[d] = (o[d] - GHOSTS + SEGMENT_RADIUS) >> shift;
+    }
+    else {
+      lo[d] = (o[d] - GHOSTS - SEGMENT_RADIUS)*(1 << -shift);
+      hi[d] = (o[d] - GHOSTS + SEGMENT_RADIUS + 1)*(1 << -shift) - 1;
+    }
+    if (hi[d] - lo[d] >= n - 1)
+      lo[d] = 0, hi[d] = n - 1;
+    else if (!(&Period.x)[d]) {
+      if (lo[d] < 0) lo[d] = 0;
+      if (hi[d] > n - 1) hi[d] = n - 1;
+    }
+  }
+  // indices wrap around for periodic directions
+  for (int i = lo[0]; i <= hi[0]; i++)
+    for (int j = lo[1]; j <= hi[1]; j++)
+      for (int k = lo[2]; k <= hi[2]; k++)
+	q->segments[((i & (n - 1))*(dimension > 1 ? n : 1) +
+		     (j & (n - 1)))*(dimension > 2 ? n : 1) +
+		    (k & (n - 1))].dirty = true;
+  q->changed = true;
+}
+
 void increment_neighbors (Point point)
 {
-  tree->dirty = true;
+  tree_changed (point);
   if (cell.neighbors++ == 0)
     alloc_children (point);
   foreach_neighbor (GHOSTS/2)
@@ -1053,7 +1554,7 @@ void increment_neighbors (Point point)
 
 void decrement_neighbors (Point point)
 {
-  tree->dirty = true;
+  tree_changed (point);
   foreach_neighbor (GHOSTS/2)
     if (allocated(0)) {
       cell.neighbors--;
@@ -1069,13 +1570,69 @@ void decrement_neighbors (Point point)
   }
 }
 
+#if TREE_SOA
+static void soa_copy (SoaLayout from, const char * src, char * dst, int nvar)
+{
+  memcpy (dst, src, sizeof(Cell));
+  for (int i = 1; i <= nvar; i++)
+    ((real *)dst)[i*soa.n] = ((real *)src)[i*from.n];
+}
+
 void realloc_scalar (int size)
 {
   /* low-level memory management */
   Tree * q = tree;
-  size_t oldlen = sizeof(Cell) + datasize;
-  size_t newlen = oldlen + size;
+  SoaLayout old = soa;
+  int nvar = datasize/sizeof(real);
   datasize += size;
+  soa = soa_layout (datasize);
+  /* the field arrays of each chunk are resized by copying all the
+     cells into a new pool with the new layout */
+  for (int l = 0; l <= depth(); l++) {
+    Layer * L = q->L[l];
+    Mempool * oldpool = L->pool;
+    int nb = l == 0 ? 1 : 2; // block size in each direction
+    L->pool = layer_pool (l);
+    foreach_mem (L->m, L->len, nb) {
+      char * new = (char *) mempool_alloc (L->pool);
+#if dimension == 1
+      for (int k = 0; k < nb; k++) {
+	soa_copy (old, mem_data (L->m, point.i + k), new, nvar);
+	assign_periodic (L->m, point.i + k, L->len, new);
+	new += sizeof(Cell);
+      }
+#elif dimension == 2
+      for (int k = 0; k < nb; k++)
+	for (int o = 0; o < nb; o++) {
+	  soa_copy (old, mem_data (L->m, point.i + k, point.j + o), new, nvar);
+	  assign_periodic (L->m, point.i + k, point.j + o, L->len, new);
+	  new += sizeof(Cell);
+	}
+#else // dimension == 3
+      for (int l = 0; l < nb; l++)
+	for (int m = 0; m < nb; m++)
+	  for (int n = 0; n < nb; n++) {
+	    soa_copy (old,
+		      mem_data (L->m, point.i + l, point.j + m, point.k + n),
+		      new, nvar);
+	    assign_periodic (L->m, point.i + l, point.j + m, point.k + n,
+			     L->len, new);
+	    new += sizeof(Cell);
+	  }
+#endif // dimension == 3
+    }
+    mempool_destroy (oldpool);
+  }
+}
+#else // !TREE_SOA
+/* adds `size` bytes to the data of each cell */
+static void realloc_cells (int size)
+{
+  /* low-level memory management */
+  Tree * q = tree;
+  size_t oldlen = sizeof(Cell) + fieldsize;
+  size_t newlen = oldlen + size;
+  fieldsize += size;
   /* the root level is allocated differently */
   Layer * L = q->L[0];
   foreach_mem (L->m, L->len, 1) {
@@ -1128,6 +1685,309 @@ void realloc_scalar (int size)
   }
 }
 
+#if !MIXED_PRECISION
+void realloc_scalar (int size)
+{
+  realloc_cells (size);
+}
+#else // MIXED_PRECISION
+/**
+With mixed precision, allocating new fields only extends `_offset[]`:
+the storage of each field is then chosen by *field_storage()*, either
+in the free space left by deleted fields or at the end of the data of
+each cell. */
+
+#define UNASSIGNED (~(size_t)1)
+
+static int offset_len = 0;
+
+static void offset_free (void)
+{
+  free (_offset), _offset = NULL;
+  offset_len = 0;
+}
+
+static void offset_resize (void)
+{
+  int nvar = datasize/sizeof(real);
+  if (nvar > offset_len) {
+    if (!_offset)
+      free_solver_func_add (offset_free);
+    _offset = (size_t *) realloc (_offset, nvar*sizeof(size_t));
+    for (; offset_len < nvar; offset_len++)
+      _offset[offset_len] = grid ? UNASSIGNED : 0;
+  }
+}
+
+void realloc_scalar (int size)
+{
+  datasize += size;
+  offset_resize();
+}
+
+/* whether the `size` bytes at offset `o` are not used by any other
+   field than `v` */
+static bool storage_is_free (int v, size_t o, size_t size)
+{
+  int nvar = datasize/sizeof(real);
+  for (int i = 0; i < nvar; i++)
+    if (i != v && _offset[i] != UNASSIGNED && !_attribute[i].freed) {
+      size_t oi = _offset[i] & ~(size_t)1;
+      size_t si = (_offset[i] & 1) ? sizeof(float) : sizeof(double);
+      if (oi < o + size && o < oi + si)
+	return false;
+    }
+  return true;
+}
+
+/* sets the precision of field index `v` and allocates its storage */
+static void field_storage (int v, bool single)
+{
+  offset_resize();
+  if (!grid) { // the storage is allocated by init_grid()
+    _offset[v] = single;
+    return;
+  }
+  size_t size = single ? sizeof(float) : sizeof(double);
+  if (_offset[v] != UNASSIGNED && (_offset[v] & 1) == single &&
+      storage_is_free (v, _offset[v] & ~(size_t)1, size))
+    return;
+  size_t o = 0;
+  while (o < fieldsize && !storage_is_free (v, o, size))
+    o += size;
+  if (o >= fieldsize)
+    realloc_cells (sizeof(double));
+  _offset[v] = o | single;
+}
+
+/* the storage of all the fields, doubles first, allocated before the
+   cells of a new grid */
+static void field_layout (void)
+{
+  offset_resize();
+  int nvar = datasize/sizeof(real);
+  fieldsize = 0;
+  for (int single = 0; single <= 1; single++)
+    for (int i = 0; i < nvar; i++)
+      if ((_offset[i] & 1) == single) {
+	_offset[i] = fieldsize | single;
+	fieldsize += single ? sizeof(float) : sizeof(double);
+      }
+  fieldsize = (fieldsize + sizeof(double) - 1)/sizeof(double)*sizeof(double);
+}
+
+/**
+These functions set the precision of all the components of a field
+and are called by qcc for fields declared with the `float`
+qualifier. */
+
+scalar float_scalar (scalar s)
+{
+  for (int b = 0; b < max(s.block, 1); b++)
+    field_storage (s.i + b, true);
+  return s;
+}
+
+vector float_vector (vector v)
+{
+  foreach_dimension()
+    float_scalar (v.x);
+  return v;
+}
+
+tensor float_tensor (tensor t)
+{
+  foreach_dimension()
+    float_vector (t.x);
+  return t;
+}
+#endif // MIXED_PRECISION
+#endif // !TREE_SOA
+
+/**
+## Compaction
+
+Cells are allocated (by blocks of $2^{dimension}$ siblings) from the
+memory pool of each level in whatever order refinement happens. After
+many adaptation cycles, blocks which are neighbors in the tree (and in
+the cache of leaves) end up scattered in memory. The
+`tree_compact()` function re-packs the blocks of each level in
+Z-order (i.e. the order of the `foreach_cell()` traversal) into a new
+memory pool.
+
+The `leaf_stride()` function returns the average distance in memory
+(in number of cells) between consecutive leaves (of the same level)
+of the cache of leaves. It is one for leaves which are contiguous. */
+
+typedef struct {
+  unsigned long key;
+  int i;
+#if dimension >= 2
+  int j;
+#endif
+#if dimension >= 3
+  int k;
+#endif
+} Block;
+
+/* interleaves the bits of the (interior) indices of the parent, with
+   the same priorities as foreach_child(): ghost blocks come last */
+static unsigned long block_key (Point point)
+{
+  unsigned long key = 0, mask = (1UL << (64/dimension - 1)) - 1;
+  unsigned long i = ((point.i + GHOSTS)/2 - GHOSTS) & mask;
+#if dimension >= 2
+  unsigned long j = ((point.j + GHOSTS)/2 - GHOSTS) & mask;
+#endif
+#if dimension >= 3
+  unsigned long k = ((point.k + GHOSTS)/2 - GHOSTS) & mask;
+#endif
+  for (int b = 64/dimension - 1; b >= 0; b--) {
+    key = (key << 1) | ((i >> b) & 1);
+#if dimension >= 2
+    key = (key << 1) | ((j >> b) & 1);
+#endif
+#if dimension >= 3
+    key = (key << 1) | ((k >> b) & 1);
+#endif
+  }
+  return key;
+}
+
+static int compare_blocks (const void * a, const void * b)
+{
+  unsigned long ka = ((Block *)a)->key, kb = ((Block *)b)->key;
+  return ka < kb ? -1 : ka > kb;
+}
+
+static void move_block (int l, Block * b, char * new)
+{
+  Layer * L = tree->L[l];
+  Point point = {0};
+  point.level = l;
+  point.i = b->i;
+#if dimension >= 2
+  point.j = b->j;
+#endif
+#if dimension >= 3
+  point.k = b->k;
+#endif
+  char * old = NEIGHBOR(0,0,0);
+#if TREE_SOA
+  int nc = 1 << dimension;
+  memcpy (new, old, nc*sizeof(Cell));
+  for (int v = 1; v <= datasize/sizeof(real); v++)
+    memcpy (((real *)new) + v*soa.n, ((real *)old) + v*soa.n,
+	    nc*sizeof(real));
+  size_t len = sizeof(Cell);
+#else
+  size_t len = sizeof(Cell) + fieldsize;
+  memcpy (new, old, (1 << dimension)*len);
+#endif
+  for (int k = 0; k < 2; k++) {
+#if dimension == 1
+    assign_periodic (L->m, point.i + k, L->len, new);
+    new += len;
+#elif dimension == 2
+    for (int o = 0; o < 2; o++) {
+      assign_periodic (L->m, point.i + k, point.j + o, L->len, new);
+      new += len;
+    }
+#else // dimension == 3
+    for (int o = 0; o < 2; o++)
+      for (int m = 0; m < 2; m++) {
+	assign_periodic (L->m, point.i + k, point.j + o, point.k + m,
+			 L->len, new);
+	new += len;
+      }
+#endif
+  }
+}
+
+trace
+void tree_compact (void)
+{
+  Tree * q = tree;
+  for (int l = 1; l <= depth(); l++) {
+    Layer * L = q->L[l];
+    Block * blocks = qmalloc (L->nc, Block);
+    long n = 0;
+    foreach_mem (L->m, L->len, 2) {
+      assert (n < L->nc);
+      Block * b = &blocks[n++];
+      b->key = block_key (point);
+      b->i = point.i;
+#if dimension >= 2
+      b->j = point.j;
+#endif
+#if dimension >= 3
+      b->k = point.k;
+#endif
+    }
+    assert (n == L->nc);
+    qsort (blocks, n, sizeof(Block), compare_blocks);
+    Mempool * oldpool = L->pool;
+    L->pool = layer_pool (l);
+    for (long i = 0; i < n; i++)
+      move_block (l, &blocks[i], (char *) mempool_alloc (L->pool));
+    mempool_destroy (oldpool);
+    free (blocks);
+  }
+}
+
+double leaf_stride (void)
+{
+  update_cache();
+  Cache * c = &tree->leaves;
+#if TREE_SOA
+  size_t len = sizeof(Cell);
+#else
+  size_t len = sizeof(Cell) + fieldsize;
+#endif
+  double stride = 0.;
+  long n = 0;
+  char * prev = NULL;
+  Point point = {0};
+  for (int k = 0; k < c->n; k++) {
+    point.i = c->p[k].i;
+#if dimension >= 2
+    point.j = c->p[k].j;
+#endif
+#if dimension >= 3
+    point.k = c->p[k].k;
+#endif
+    char * p = NULL;
+    if (c->p[k].level == point.level) {
+      p = NEIGHBOR(0,0,0);
+      if (prev)
+	stride += fabs ((double)(p - prev))/len, n++;
+    }
+    else {
+      point.level = c->p[k].level;
+      p = NEIGHBOR(0,0,0);
+    }
+    prev = p;
+  }
+  return n ? stride/n : 0.;
+}
+
+/* The leaf stride is checked every `every` calls to adapt_wavelet()
+   and the tree is compacted when it is larger than `stride`. This is
+   off by default (`every` is zero). */
+
+struct {
+  int every;
+  double stride;
+} tree_compaction = {0, 4.};
+
+static void tree_compact_check (void)
+{
+  static int n = 0;
+  if (tree_compaction.every > 0 && ++n % tree_compaction.every == 0 &&
+      leaf_stride() > tree_compaction.stride)
+    tree_compact();
+}
+
 /* Boundaries */
 
 @define VN v.x
@@ -1470,7 +2330,9 @@ void free_grid (void)
   free (q->faces.p);
   free (q->vertices.p);
   free (q->refined.p);
+  segments_free();
   /* low-level memory management */
+#if !TREE_SOA
   /* the root level is allocated differently */
   Layer * L = q->L[0];
   foreach_mem (L->m, L->len, 1) {
@@ -1482,6 +2344,7 @@ void free_grid (void)
     free (mem_data (L->m, point.i, point.j, point.k));
 #endif // dimension == 3
   }
+#endif // !TREE_SOA
   for (int l = 0; l <= depth(); l++)
     destroy_layer (q->L[l]);
   q->L = &(q->L[-1]);
@@ -1490,12 +2353,26 @@ void free_grid (void)
   free_cache (q->prolongation);
   free_cache (q->boundary);
   free_cache (q->restriction);
+  for (int l = 0; l < q->ncolours; l++)
+    free (q->colours[l].cells.p);
+  free (q->colours);
   free (q);
   grid = NULL;
 }
 
 static void refine_level (int depth);
 
+static char * new_root_cell (Layer * L)
+{
+#if TREE_SOA
+  char * c = (char *) mempool_alloc0 (L->pool);
+  soa_clear (c, 1);
+  return c;
+#else
+  return (char *) calloc (1, sizeof(Cell) + fieldsize);
+#endif
+}
+
 trace
 void init_grid (int n)
 {
@@ -1521,12 +2398,17 @@ void init_grid (int n)
   /* make sure we don't try to access level -1 */
   q->L[0] = NULL; q->L = &(q->L[1]);
   /* initialise the root cell */
+#if TREE_SOA
+  soa = soa_layout (datasize);
+#elif MIXED_PRECISION
+  field_layout();
+#endif
   Layer * L = new_layer (0);
   q->L[0] = L;
 #if dimension == 1
   for (int i = Period.x*GHOSTS; i < L->len - Period.x*GHOSTS; i++)
     assign_periodic (L->m, i, L->len, 
-		     (char *) calloc (1, sizeof(Cell) + datasize));
+		     new_root_cell (L));
   CELL(mem_data (L->m,GHOSTS)).flags |= leaf;
   if (pid() == 0)
     CELL(mem_data (L->m,GHOSTS)).flags |= active;
@@ -1539,7 +2421,7 @@ void init_grid (int n)
   for (int i = Period.x*GHOSTS; i < L->len - Period.x*GHOSTS; i++)
     for (int j = Period.y*GHOSTS; j < L->len - Period.y*GHOSTS; j++)
       assign_periodic (L->m, i, j, L->len,
-		       (char *) calloc (1, sizeof(Cell) + datasize));
+		       new_root_cell (L));
   CELL(mem_data (L->m,GHOSTS,GHOSTS)).flags |= leaf;
   if (pid() == 0)
     CELL(mem_data (L->m,GHOSTS,GHOSTS)).flags |= active;
@@ -1557,7 +2439,7 @@ void init_grid (int n)
     for (int j = Period.y*GHOSTS; j < L->len - Period.y*GHOSTS; j++)
       for (int k = Period.z*GHOSTS; k < L->len - Period.z*GHOSTS; k++)
 	assign_periodic (L->m, i, j, k, L->len,
-			 (char *) calloc (1, sizeof(Cell) + datasize));
+			 new_root_cell (L));
   CELL(mem_data (L->m,GHOSTS,GHOSTS,GHOSTS)).flags |= leaf;
   if (pid() == 0)
     CELL(mem_data (L->m,GHOSTS,GHOSTS,GHOSTS)).flags |= active;
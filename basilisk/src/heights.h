@@ -233,6 +233,192 @@ static void column_propagation (vector h)
 	  h.x[] = h.x[i] + i;
 }
 
+/**
+## Incremental updates
+
+The height function associated with a volume fraction field (see
+[below](#incremental_heights)) can be updated incrementally, rather
+than recomputed entirely each time. We keep a copy *cprev* of the
+volume fraction when the heights were last computed and only recompute
+the columns close to the cells where the volume fraction changed by
+more than *threshold*. The heights before column propagation are
+stored in *hraw*, so that the propagation can be redone exactly. */
+
+typedef struct {
+  vector h;         // the height function updated incrementally
+  vector hraw;      // the heights before column propagation
+  scalar cprev;     // the volume fraction when the heights were computed
+  double threshold; // the minimum change of the volume fraction
+  bool reset;       // whether the heights must be recomputed entirely
+} HeightsCache;
+
+attribute {
+  void * hcache; // the HeightsCache (if any)
+}
+
+static HeightsCache * heights_cache (scalar c, vector h)
+{
+  HeightsCache * hc = c.hcache;
+  return hc && hc->h.x.i == h.x.i ? hc : NULL;
+}
+
+#if !TREE
+
+/**
+On regular grids, the heights are only recomputed if the volume
+fraction changed. */
+
+static int heights_changes (scalar c, HeightsCache * hc)
+{
+  scalar cprev = hc->cprev;
+  double threshold = hc->reset ? -1. : hc->threshold;
+  int n = 0;
+  foreach (reduction(+:n))
+    if (fabs (c[] - cprev[]) > threshold)
+      cprev[] = c[], n++;
+  hc->reset = false;
+  return n;
+}
+
+#else // TREE
+
+/**
+On trees, we need to know which cells changed (on all levels), either
+because their volume fraction changed or because they have been
+refined or coarsened. Two permanent flags record whether the heights
+of a cell are known and whether it was a leaf when they were
+computed. New cells are allocated with cleared flags.
+
+The heights of a cell only depend on the volume fractions within a
+few cells along each direction, on its level and on the two coarser
+levels (through the prolongation of the volume fraction and of the
+shifted field). We group the cells of level *l* in blocks of $4^d$
+cells i.e. their ancestors on level *l - 2*. The columns of a block
+are recomputed if a cell (or one of the descendants of a cell) changed
+in its $5^d$ neighborhood, or if a coarser cell changed in the $5^d$
+neighborhood of its parent or grand-parent. This covers a distance of
+at least 8 cells of level *l*, which is more than the distance on
+which the heights depend.
+
+Rather than looking for changes around each block, the cells which
+changed (and their ancestors) mark their neighborhood using temporary
+flags. Note that the volume fraction of a parent cell changes when
+that of one of its children changes (through restriction). The finer
+levels do not need to be recomputed in this case, so that only the
+leaves (or the cells which have been refined or coarsened) mark their
+neighborhood as changed for the finer levels. */
+
+static const unsigned short
+  heights_known = 1 << (user + 8),
+  heights_leaf = 1 << (user + 9),
+  heights_below = 1 << user,       // ancestor of a cell which changed
+  heights_near = 1 << (user + 1),  // near a cell (or descendant) which changed
+  heights_nearc = 1 << (user + 2); // near a cell which changed
+
+static Point heights_parent (Point point)
+{
+  Point p = point;
+  p.level--;
+  p.i = (point.i + GHOSTS)/2;
+#if dimension >= 2
+  p.j = (point.j + GHOSTS)/2;
+#endif
+#if dimension >= 3
+  p.k = (point.k + GHOSTS)/2;
+#endif
+  return p;
+}
+
+/**
+Only the blocks and their parents and grand-parents (i.e. the cells
+with at least two levels of descendants) need to be marked. */
+
+static void heights_mark_near (Point point, unsigned short flags)
+{
+  if (point.level <= depth() - 2)
+    foreach_neighbor()
+      if (allocated(0) && (is_leaf(cell) || is_refined(cell)))
+	cell.flags |= flags;
+}
+
+static void heights_mark_ancestors (Point point)
+{
+  while (point.level > 0) {
+    point = heights_parent (point);
+    if (cell.flags & heights_below)
+      break;
+    cell.flags |= heights_below;
+    heights_mark_near (point, heights_near);
+  }
+}
+
+static int heights_changes (scalar c, HeightsCache * hc)
+{
+  scalar cprev = hc->cprev;
+  int n = 0;
+  foreach_cell() {
+    if (is_boundary(cell))
+      continue;
+    unsigned short flags = cell.flags;
+    bool isleaf = is_leaf(cell);
+    bool topology = hc->reset || !(flags & heights_known) ||
+      isleaf != !!(flags & heights_leaf);
+    if (topology || fabs (c[] - cprev[]) > hc->threshold) {
+      cprev[] = c[];
+      cell.flags |= heights_known;
+      if (isleaf)
+	cell.flags |= heights_leaf;
+      else
+	cell.flags &= ~heights_leaf;
+      heights_mark_near (point, topology || isleaf ?
+			 heights_near|heights_nearc : heights_near);
+      heights_mark_ancestors (point);
+      n++;
+    }
+    if (isleaf)
+      continue;
+  }
+  hc->reset = false;
+  return n;
+}
+
+static bool heights_recompute (Point point)
+{
+  if (point.level <= 2)
+    return true;
+  point = heights_parent (heights_parent (point));
+  if (cell.flags & heights_near)
+    return true;
+  point = heights_parent (point);
+  if (cell.flags & heights_nearc)
+    return true;
+  if (point.level == 0)
+    return false;
+  point = heights_parent (point);
+  return cell.flags & heights_nearc;
+}
+
+/**
+The raw heights are then copied into the height function (which is
+modified by column propagation) and the temporary flags are
+cleared. */
+
+static void heights_copy (HeightsCache * hc)
+{
+  vector h = hc->h, hraw = hc->hraw;
+  foreach_cell() {
+    if (is_boundary(cell))
+      continue;
+    foreach_dimension()
+      h.x[] = hraw.x[];
+    cell.flags &= ~(heights_below|heights_near|heights_nearc);
+    if (is_leaf(cell))
+      continue;
+  }
+}
+
+#endif // TREE
+
 /**
 ## Multigrid implementation
 
@@ -243,6 +429,9 @@ the height function vector field *h*. */
 trace
 void heights (scalar c, vector h)
 {
+  HeightsCache * hc = heights_cache (c, h);
+  if (hc && !heights_changes (c, hc))
+    return;
 
   /**
   We need a 9-points-high stencil (rather than the default
@@ -373,6 +562,22 @@ void heights (scalar c, vector h)
   fraction on all levels. */
   
   restriction ({c});
+
+  /**
+  When the heights are updated incrementally (with a single process),
+  we return if nothing changed. Otherwise the raw heights are computed
+  in *hraw* and only for the blocks close to the changes. */
+
+  HeightsCache * hc = heights_cache (c, h);
+  if (npe() > 1)
+    hc = NULL;
+  vector hr = h;
+  if (hc) {
+    if (!heights_changes (c, hc))
+      return;
+    hr = hc->hraw;
+  }
+  
   for (int j = -1; j <= 1; j += 2) {
 
     /**
@@ -381,7 +586,7 @@ void heights (scalar c, vector h)
   
     foreach_level(0)
       foreach_dimension()
-        h.x[] = nodata;
+        hr.x[] = nodata;
   
     for (int l = 1; l <= depth(); l++) {
 
@@ -421,9 +626,12 @@ void heights (scalar c, vector h)
       according to *j*. */
 
       foreach_level (l)
-        half_column (point, c, h, s, j);
+	if (!hc || heights_recompute (point))
+	  half_column (point, c, hr, s, j);
     }
   }
+  if (hc)
+    heights_copy (hc);
     
   /**
   We fill the prolongation cells with "nodata". The restriction
@@ -459,3 +667,76 @@ associated to a (VOF) tracer. */
 attribute {
   vector height;
 }
+
+/**
+<div id="incremental_heights"></div>
+
+The height function associated with *c* (allocated if necessary) can
+be updated incrementally, using
+
+~~~literatec
+incremental_heights (f);
+~~~
+
+after which `heights (f, f.height)` only recomputes the columns
+intersecting the cells where the volume fraction changed by more than
+*threshold* (or which have been refined or coarsened) since the last
+update. `curvature()` and `position()` then also update the heights
+before using them, so that the heights are only computed once per
+timestep. With the default (zero) threshold, the result is identical
+to that of a complete computation. A positive threshold ignores
+smaller changes of the volume fraction (which accumulate until they
+exceed the threshold). With MPI, the heights are always recomputed
+entirely.
+
+The heights are recomputed entirely after a call to
+`heights_reset()`, which is necessary only if the boundary conditions
+of the volume fraction have changed. */
+
+static void heights_free()
+{
+  for (scalar s in all)
+    if (s.hcache) {
+      free (s.hcache);
+      s.hcache = NULL;
+    }
+}
+
+void incremental_heights (scalar c, double threshold = 0.)
+{
+  static bool registered = false;
+  if (!registered) {
+    free_solver_func_add (heights_free);
+    registered = true;
+  }
+  if (!c.height.x.i) {
+    vector h = new vector;
+    c.height = h;
+  }
+  HeightsCache * hc = c.hcache;
+  if (!hc) {
+    c.hcache = hc = qcalloc (1, HeightsCache);
+    scalar cprev = new scalar;
+    cprev.nodump = true;
+    hc->cprev = cprev;
+#if TREE
+    vector hraw = new vector;
+    foreach_dimension() {
+      hraw.x.restriction = no_restriction;
+      hraw.x.prolongation = no_data;
+      hraw.x.nodump = true;
+    }
+    hc->hraw = hraw;
+#endif
+  }
+  hc->h = c.height;
+  hc->threshold = threshold;
+  hc->reset = true;
+}
+
+void heights_reset (scalar c)
+{
+  HeightsCache * hc = c.hcache;
+  if (hc)
+    hc->reset = true;
+}
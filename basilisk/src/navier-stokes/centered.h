@@ -60,7 +60,16 @@ zero.
 
 The statistics for the (multigrid) solution of the pressure Poisson
 problems and implicit viscosity are stored in *mgp*, *mgpf*, *mgu*
-respectively. 
+respectively. Their *solver* field selects the [Krylov
+acceleration](/src/poisson.h#krylov-acceleration) of the
+corresponding solver, for example
+
+~~~literatec
+event init (i = 0) {
+  mgp.solver = mgpf.solver = MG_CG;
+  mgu.solver = MG_BICGSTAB;
+}
+~~~
 
 If *stokes* is set to *true*, the velocity advection term
 $\nabla\cdot(\mathbf{u}\otimes\mathbf{u})$ is omitted. This is a
@@ -324,7 +333,7 @@ event advection_term (i++,last)
 {
   if (!stokes) {
     prediction();
-    mgpf = project (uf, pf, alpha, dt/2., mgpf.nrelax);
+    mgpf = project (uf, pf, alpha, dt/2., mgpf.nrelax, mgpf.solver);
     advection ((scalar *){u}, uf, dt, (scalar *){g});
   }
 }
@@ -353,7 +362,7 @@ event viscous_term (i++,last)
 {
   if (constant(mu.x) != 0.) {
     correction (dt);
-    mgu = viscosity (u, mu, rho, dt, mgu.nrelax);
+    mgu = viscosity (u, mu, rho, dt, mgu.nrelax, solver = mgu.solver);
     correction (-dt);
   }
 
@@ -427,7 +436,7 @@ next timestep). Then compute the centered gradient field *g*. */
 
 event projection (i++,last)
 {
-  mgp = project (uf, p, alpha, dt, mgp.nrelax);
+  mgp = project (uf, p, alpha, dt, mgp.nrelax, mgp.solver);
   centered_gradient (p, g);
 
   /**
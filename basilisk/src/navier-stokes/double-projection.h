@@ -173,7 +173,7 @@ event end_timestep (i++)
   swap (scalar, p, dp);
   a = ab;
   // this could be optimised since we do not use Af
-  mgp = project (Af, p, alpha, dt, mgp.nrelax);
+  mgp = project (Af, p, alpha, dt, mgp.nrelax, mgp.solver);
   delete ((scalar *){Af});
   centered_gradient (p, g);
 }
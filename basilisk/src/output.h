@@ -989,7 +989,35 @@ default is "dump".
 
 *unbuffered*
 : whether to use a file buffer. Default is false.
-*/
+
+*compress*
+: whether to [compress](#compressed-snapshots) the file. Default is
+false.
+
+*blocks*
+: whether to use the block format (see below). Default is false.
+
+### File format
+
+The file starts with a header (the *DumpHeader* structure, the names
+of the fields and the coordinates of the domain).
+
+By default, the cells follow in the order of `foreach_cell()` (i.e. in
+Z-order), the flags and values of each cell being contiguous (the
+first field is the size of the subtree of each cell). This is the
+format of version 170901, which can be read by any version of
+Basilisk.
+
+With `blocks = true`, the header is followed by the total number of
+cells *n* and the cells are stored as blocks: a block of *n* flags,
+followed by one block of *n* values for each field. Each block starts
+at a multiple of eight bytes. Reading a few fields of a snapshot (see
+[dumpmap](dumpmap/dumpmap.h)) is then much faster.
+
+The files are independent of the number of processes. In parallel,
+each process packs its cells into a single buffer which is written
+with collective MPI-IO calls. *restore()* can read files in any of
+these formats, written with any number of processes. */
 
 struct DumpHeader {
   double t;
@@ -1002,6 +1030,8 @@ static const int dump_version =
   // 161020
   170901;
 
+static const int dump_version_blocks = 250301;
+
 static scalar * dump_list (scalar * lista)
 {
   scalar * list = is_constant(cm) ? NULL : list_concat ({cm}, NULL);
@@ -1011,36 +1041,334 @@ static scalar * dump_list (scalar * lista)
   return list;
 }
 
-static void dump_header (FILE * fp, struct DumpHeader * header, scalar * list)
+/**
+The file is written through a *DumpSink*, either to a file (through a
+large buffer), or to memory (if *fp* is `NULL`). */
+
+#define DUMP_BUFFER 65536
+
+typedef struct {
+  FILE * fp;
+  char * buf;
+  size_t len, size;
+} DumpSink;
+
+static void dump_sink_init (DumpSink * o, FILE * fp)
+{
+  o->fp = fp, o->len = 0, o->size = DUMP_BUFFER;
+  o->buf = (char *) malloc (o->size);
+}
+
+static void dump_flush (DumpSink * o)
 {
-  if (fwrite (header, sizeof(struct DumpHeader), 1, fp) < 1) {
-    perror ("dump(): error while writing header");
-    exit (1);
+  if (o->fp && o->len) {
+    if (fwrite (o->buf, 1, o->len, o->fp) < o->len) {
+      perror ("dump(): error while writing");
+      exit (1);
+    }
+    o->len = 0;
+  }
+}
+
+static void dump_write (DumpSink * o, const void * data, size_t size)
+{
+  if (o->len + size > o->size) {
+    if (o->fp) {
+      dump_flush (o);
+      if (size > o->size) {
+	if (fwrite (data, 1, size, o->fp) < size) {
+	  perror ("dump(): error while writing");
+	  exit (1);
+	}
+	return;
+      }
+    }
+    else {
+      o->size = max (2*o->size, o->len + size);
+      o->buf = (char *) realloc (o->buf, o->size);
+    }
   }
+  memcpy (o->buf + o->len, data, size);
+  o->len += size;
+}
+
+static void dump_header (DumpSink * o, struct DumpHeader * header,
+			 scalar * list)
+{
+  dump_write (o, header, sizeof(struct DumpHeader));
   for (scalar s in list) {
     unsigned len = strlen(s.name);
-    if (fwrite (&len, sizeof(unsigned), 1, fp) < 1) {
-      perror ("dump(): error while writing len");
-      exit (1);
+    dump_write (o, &len, sizeof(unsigned));
+    dump_write (o, s.name, sizeof(char)*len);
+  }
+  double c[4] = {X0,Y0,Z0,L0};
+  dump_write (o, c, 4*sizeof(double));
+}
+
+/**
+The position of the first block, given the size of the header, and
+the position of block *b* (0 for the flags, *i* + 1 for field *i*) of
+a file of *n* cells. */
+
+static long dump_start (long header)
+{
+  return (header + sizeof(long) + 7)/8*8;
+}
+
+static long dump_block (long start, long n, int b)
+{
+  return b == 0 ? start :
+    start + (n*sizeof(unsigned) + 7)/8*8 + (b - 1)*n*sizeof(double);
+}
+
+static long dump_header_size (scalar * list)
+{
+  long size = sizeof(struct DumpHeader) + 4*sizeof(double);
+  for (scalar s in list)
+    size += sizeof(unsigned) + sizeof(char)*strlen(s.name);
+  return size;
+}
+
+/**
+### Compressed snapshots
+
+With `compress = true`, the blocks are split into *segments* of at
+most `DUMP_SEGMENT` consecutive cells, which are compressed
+independently using [byte shuffling and LZ77](compression.h). The
+values of scalars with a non-zero `dump_tolerance` attribute are
+[quantized](compression.h#error-bounded-quantization) first, so that
+the (absolute) error on restoring is at most `dump_tolerance` e.g.
+
+~~~literatec
+foreach_dimension()
+  u.x.dump_tolerance = 1e-6;
+p.dump_tolerance = 1e-6;
+dump (file = "snapshot", compress = true);
+~~~
+
+The values of the fields on non-leaf cells are not stored (only the
+size of the subtree is), they are recomputed by restriction by
+*restore()*.
+
+Each segment starts with the index of its first cell and its number
+of cells, followed by a *DumpBlock* header and the compressed data
+for each block. The file ends with the positions of the segments and
+their number. */
+
+#include "compression.h"
+
+attribute {
+  double dump_tolerance;
+}
+
+static const int dump_version_compressed = 250302;
+
+static int dump_format (bool compress, bool blocks)
+{
+  return (compress ? dump_version_compressed :
+	  blocks ? dump_version_blocks :
+	  dump_version);
+}
+
+#define DUMP_SEGMENT 65536
+
+typedef struct {
+  double tolerance;
+  long size, usize; // the compressed and uncompressed sizes
+} DumpBlock;
+
+typedef struct {
+  int len;                  // the number of fields
+  double * tolerance;       // the tolerance for each field
+  long first, count;        // the current segment
+  char * raw;               // the (uncompressed) blocks of the segment
+  char * tmp, * tmp1;
+  char * out;               // the compressed segments
+  size_t size, len_out;     // the size and length of out
+  long pos, * offset, nseg; // the position of out and of each segment
+} DumpPacker;
+
+static char * dump_raw (char * raw, int b)
+{
+  return b ? raw + DUMP_SEGMENT*(sizeof(unsigned) + (b - 1)*sizeof(double)) :
+    raw;
+}
+
+static void dump_packer_init (DumpPacker * p, scalar * list, long pos)
+{
+  p->len = list_len (list);
+  p->tolerance = (double *) malloc ((p->len + 1)*sizeof(double));
+  int b = 1;
+  p->tolerance[0] = 0.;
+  for (scalar s in list)
+    p->tolerance[b++] = s.dump_tolerance;
+  p->first = p->count = 0;
+  p->raw = (char *) malloc (DUMP_SEGMENT*(sizeof(unsigned) +
+					  p->len*sizeof(double)));
+  p->tmp = (char *) malloc (2*DUMP_SEGMENT*sizeof(double));
+  p->tmp1 = (char *) malloc (2*DUMP_SEGMENT*sizeof(double));
+  p->out = NULL, p->size = p->len_out = 0;
+  p->pos = pos, p->offset = NULL, p->nseg = 0;
+}
+
+static void dump_packer_free (DumpPacker * p)
+{
+  free (p->tolerance), free (p->raw), free (p->tmp), free (p->tmp1);
+  free (p->out), free (p->offset);
+}
+
+static void dump_packer_append (DumpPacker * p, const void * data, size_t size)
+{
+  if (p->len_out + size > p->size) {
+    p->size = max (2*p->size, p->len_out + size);
+    p->out = (char *) realloc (p->out, p->size);
+  }
+  memcpy (p->out + p->len_out, data, size);
+  p->len_out += size;
+}
+
+/**
+Compresses the current segment and appends it to the output. */
+
+static void dump_packer_flush (DumpPacker * p)
+{
+  if (!p->count)
+    return;
+  p->offset = (long *) realloc (p->offset, (p->nseg + 1)*sizeof(long));
+  p->offset[p->nseg++] = p->pos + p->len_out;
+  long header[2] = {p->first, p->count};
+  dump_packer_append (p, header, sizeof(header));
+  for (int b = 0; b <= p->len; b++) {
+    DumpBlock block = {p->tolerance[b]};
+    size_t size = b ? sizeof(double) : sizeof(unsigned), n = p->count;
+    char * data = dump_raw (p->raw, b);
+    if (block.tolerance > 0.) {
+      n = quantize ((double *) data, n, block.tolerance,
+		    (unsigned long *) p->tmp1);
+      data = p->tmp1;
     }
-    if (fwrite (s.name, sizeof(char), len, fp) < len) {
-      perror ("dump(): error while writing s.name");
-      exit (1);
+    byte_shuffle (data, p->tmp, n, size);
+    block.usize = n*size;
+    size_t bound = lz_bound (block.usize);
+    if (p->len_out + sizeof(DumpBlock) + bound > p->size) {
+      p->size = max (2*p->size, p->len_out + sizeof(DumpBlock) + bound);
+      p->out = (char *) realloc (p->out, p->size);
     }
+    char * o = p->out + p->len_out + sizeof(DumpBlock);
+    block.size = lz_compress (p->tmp, block.usize, o);
+    memcpy (p->out + p->len_out, &block, sizeof(DumpBlock));
+    p->len_out += sizeof(DumpBlock) + block.size;
   }
-  double o[4] = {X0,Y0,Z0,L0};
-  if (fwrite (o, sizeof(double), 4, fp) < 4) {
-    perror ("dump(): error while writing coordinates");
-    exit (1);
+  p->count = 0;
+}
+
+/**
+Adds the cell of (global) *index* to the current segment. */
+
+static void dump_pack (DumpPacker * p, long index, Point point, scalar * list)
+{
+  if (p->count == DUMP_SEGMENT || (p->count && index != p->first + p->count))
+    dump_packer_flush (p);
+  if (!p->count)
+    p->first = index;
+  long i = p->count++;
+  unsigned flags = is_leaf(cell) ? leaf : 0;
+  memcpy (p->raw + i*sizeof(unsigned), &flags, sizeof(unsigned));
+  int b = 1;
+  for (scalar s in list) {
+    double val = b == 1 || is_leaf(cell) ? s[] : 0.;
+    memcpy (dump_raw (p->raw, b++) + i*sizeof(double), &val, sizeof(double));
   }
 }
 
 #if !_MPI
+/**
+In serial, the cells are written in order, block by block or segment
+by segment. */
+
+static void dump_cells (DumpSink * o, scalar * list, bool compress,
+			bool blocks)
+{
+  scalar * dlist = dump_list (list);
+  scalar size[];
+  scalar * slist = list_concat ({size}, dlist); free (dlist);
+  struct DumpHeader header = { t, list_len(slist), iter, depth(), npe(),
+			       dump_format (compress, blocks) };
+  dump_header (o, &header, slist);
+  
+  subtree_size (size, false);
+  if (header.version == dump_version) {
+    foreach_cell() {
+      unsigned flags = is_leaf(cell) ? leaf : 0;
+      dump_write (o, &flags, sizeof(unsigned));
+      for (scalar s in slist) {
+	double val = s[];
+	dump_write (o, &val, sizeof(double));
+      }
+      if (is_leaf(cell))
+	continue;
+    }
+    free (slist);
+    return;
+  }
+  long n = 0;
+  foreach_level (0, serial)
+    n = size[];
+
+  char zero[8] = {0};
+  long pos = dump_header_size (slist), start = dump_start (pos);
+  dump_write (o, &n, sizeof(long));
+  dump_write (o, zero, start - pos - sizeof(long));
+  if (compress) {
+    DumpPacker p;
+    dump_packer_init (&p, slist, start);
+    long index = 0;
+    foreach_cell() {
+      dump_pack (&p, index++, point, slist);
+      if (p.len_out > DUMP_BUFFER) {
+	dump_write (o, p.out, p.len_out);
+	p.pos += p.len_out, p.len_out = 0;
+      }
+      if (is_leaf(cell))
+	continue;
+    }
+    dump_packer_flush (&p);
+    dump_write (o, p.out, p.len_out);
+    dump_write (o, p.offset, p.nseg*sizeof(long));
+    dump_write (o, &p.nseg, sizeof(long));
+    dump_packer_free (&p);
+  }
+  else for (int b = 0; b <= header.len; b++) {
+    if (b == 0) {
+      foreach_cell() {
+	unsigned flags = is_leaf(cell) ? leaf : 0;
+	dump_write (o, &flags, sizeof(unsigned));
+	if (is_leaf(cell))
+	  continue;
+      }
+      if (n % 2)
+	dump_write (o, zero, sizeof(unsigned));
+    }
+    else {
+      scalar s = slist[b - 1];
+      foreach_cell() {
+	double val = s[];
+	dump_write (o, &val, sizeof(double));
+	if (is_leaf(cell))
+	  continue;
+      }
+    }
+  }
+  free (slist);
+}
+
 trace
 void dump (const char * file = "dump",
 	   scalar * list = all,
 	   FILE * fp = NULL,
-	   bool unbuffered = false)
+	   bool unbuffered = false,
+	   bool compress = false,
+	   bool blocks = false)
 {
   char * name = NULL;
   if (!fp) {
@@ -1054,32 +1382,13 @@ void dump (const char * file = "dump",
     }
   }
   assert (fp);
+
+  DumpSink o;
+  dump_sink_init (&o, fp);
+  dump_cells (&o, list, compress, blocks);
+  dump_flush (&o);
+  free (o.buf);
   
-  scalar * dlist = dump_list (list);
-  scalar size[];
-  scalar * slist = list_concat ({size}, dlist); free (dlist);
-  struct DumpHeader header = { t, list_len(slist), iter, depth(), npe(),
-			       dump_version };
-  dump_header (fp, &header, slist);
-  
-  subtree_size (size, false);
-  
-  foreach_cell() {
-    unsigned flags = is_leaf(cell) ? leaf : 0;
-    if (fwrite (&flags, sizeof(unsigned), 1, fp) < 1) {
-      perror ("dump(): error while writing flags");
-      exit (1);
-    }
-    for (scalar s in slist)
-      if (fwrite (&s[], sizeof(double), 1, fp) < 1) {
-	perror ("dump(): error while writing scalars");
-	exit (1);
-      }
-    if (is_leaf(cell))
-      continue;
-  }
-  
-  free (slist);
   if (file) {
     fclose (fp);
     if (!unbuffered)
@@ -1088,82 +1397,620 @@ void dump (const char * file = "dump",
   }
 }
 #else // _MPI
-trace
-void dump (const char * file = "dump",
-	   scalar * list = all,
-	   FILE * fp = NULL,
-	   bool unbuffered = false)
+/**
+In parallel, each process first builds an *image* of its part of the
+file: a buffer and the list of the *extents* (position and length in
+the file) of its consecutive parts. */
+
+typedef struct {
+  char * buf;
+  long len, size;             // the length and size of buf
+  long n, * offset, * length; // the extents
+} DumpImage;
+
+static char * dump_image_append (DumpImage * img, long offset, long size)
 {
-  if (fp != NULL || file == NULL) {
-    fprintf (ferr, "dump(): must specify a file name when using MPI\n");
-    exit(1);
+  if (img->n && img->offset[img->n - 1] + img->length[img->n - 1] == offset)
+    img->length[img->n - 1] += size;
+  else {
+    img->offset = (long *) realloc (img->offset, (img->n + 1)*sizeof(long));
+    img->length = (long *) realloc (img->length, (img->n + 1)*sizeof(long));
+    img->offset[img->n] = offset, img->length[img->n++] = size;
+  }
+  if (img->len + size > img->size) {
+    img->size = max (2*img->size, img->len + size);
+    img->buf = (char *) realloc (img->buf, img->size);
   }
+  img->len += size;
+  return img->buf + img->len - size;
+}
 
-  char name[strlen(file) + 2];
-  strcpy (name, file);
-  if (!unbuffered)
-    strcat (name, "~");
-  FILE * fh = fopen (name, "w");
-  if (fh == NULL) {
-    perror (name);
-    exit (1);    
+static void dump_image_free (DumpImage * img)
+{
+  free (img->buf), free (img->offset), free (img->length);
+}
+
+/**
+For the block format, the local cells are usually a single range of
+indices, but we do not need to assume so: the ranges of consecutive
+indices are stored in *first* and *count*. */
+
+static void dump_blocks_image (DumpImage * img, scalar * list,
+			       scalar index, long n, long start)
+{
+  long nl = 0, nr = 0, last = -2, * first = NULL, * count = NULL;
+  foreach_cell() {
+    // fixme: this won't work when combining MPI and mask()
+    if (is_local(cell)) {
+      long i = index[];
+      if (i != last + 1) {
+	first = (long *) realloc (first, (nr + 1)*sizeof(long));
+	count = (long *) realloc (count, (nr + 1)*sizeof(long));
+	first[nr] = i, count[nr++] = 0;
+      }
+      count[nr - 1]++, nl++, last = i;
+    }
+    if (is_leaf(cell))
+      continue;
+  }
+
+  int len = list_len (list);
+  for (int b = 0; b <= len; b++) {
+    long bsize = b ? sizeof(double) : sizeof(unsigned);
+    for (long r = 0; r < nr; r++)
+      dump_image_append (img, dump_block (start, n, b) + first[r]*bsize,
+			 count[r]*bsize);
+  }
+  char * p = img->buf + img->len - nl*(sizeof(unsigned) + len*sizeof(double));
+  foreach_cell() {
+    if (is_local(cell)) {
+      unsigned flags = is_leaf(cell) ? leaf : 0;
+      memcpy (p, &flags, sizeof(unsigned));
+      p += sizeof(unsigned);
+    }
+    if (is_leaf(cell))
+      continue;
+  }
+  for (scalar s in list)
+    foreach_cell() {
+      if (is_local(cell)) {
+	double val = s[];
+	memcpy (p, &val, sizeof(double));
+	p += sizeof(double);
+      }
+      if (is_leaf(cell))
+	continue;
+    }
+  free (first), free (count);
+}
+
+/**
+For the record format, the cell of index *i* is at position *start* +
+*i* times the size of a cell. */
+
+static void dump_records_image (DumpImage * img, scalar * list,
+				scalar index, long start)
+{
+  long size = sizeof(unsigned) + list_len (list)*sizeof(double);
+  foreach_cell() {
+    // fixme: this won't work when combining MPI and mask()
+    if (is_local(cell)) {
+      char * p = dump_image_append (img, start + index[]*size, size);
+      unsigned flags = is_leaf(cell) ? leaf : 0;
+      memcpy (p, &flags, sizeof(unsigned));
+      p += sizeof(unsigned);
+      for (scalar s in list) {
+	double val = s[];
+	memcpy (p, &val, sizeof(double));
+	p += sizeof(double);
+      }
+    }
+    if (is_leaf(cell))
+      continue;
+  }
+}
+
+/**
+For compressed snapshots, each process compresses its segments, which
+are stored after those of the processes of lower rank. The master
+process then appends the positions of all the segments. */
+
+static void dump_segments_image (DumpImage * img, scalar * list,
+				 scalar index, long start)
+{
+  DumpPacker p;
+  dump_packer_init (&p, list, 0);
+  foreach_cell() {
+    // fixme: this won't work when combining MPI and mask()
+    if (is_local(cell))
+      dump_pack (&p, index[], point, list);
+    if (is_leaf(cell))
+      continue;
+  }
+  dump_packer_flush (&p);
+
+  long len = p.len_out, base = 0, total = len;
+  MPI_Exscan (&len, &base, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+  if (pid() == 0)
+    base = 0;
+  MPI_Allreduce (MPI_IN_PLACE, &total, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+  for (long i = 0; i < p.nseg; i++)
+    p.offset[i] += start + base;
+
+  int nseg = p.nseg, counts[npe()], displs[npe()];
+  MPI_Gather (&nseg, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  long ntotal = 0, * offset = NULL;
+  if (pid() == 0) {
+    for (int i = 0; i < npe(); i++)
+      displs[i] = ntotal, ntotal += counts[i];
+    offset = (long *) malloc ((ntotal + 1)*sizeof(long));
+    offset[ntotal] = ntotal;
+  }
+  MPI_Gatherv (p.offset, nseg, MPI_LONG,
+	       offset, counts, displs, MPI_LONG, 0, MPI_COMM_WORLD);
+
+  if (len)
+    memcpy (dump_image_append (img, start + base, len), p.out, len);
+  if (pid() == 0) {
+    memcpy (dump_image_append (img, start + total, (ntotal + 1)*sizeof(long)),
+	    offset, (ntotal + 1)*sizeof(long));
+    free (offset);
   }
+  dump_packer_free (&p);
+}
 
+static void dump_image (DumpImage * img, scalar * list, bool compress,
+			bool blocks)
+{
   scalar * dlist = dump_list (list);
   scalar size[];
   scalar * slist = list_concat ({size}, dlist); free (dlist);
   struct DumpHeader header = { t, list_len(slist), iter, depth(), npe(),
-			       dump_version };
+			       dump_format (compress, blocks) };
 
 #if MULTIGRID_MPI
   for (int i = 0; i < dimension; i++)
     (&header.n.x)[i] = mpi_dims[i];
-  MPI_Barrier (MPI_COMM_WORLD);
 #endif
 
-  if (pid() == 0)
-    dump_header (fh, &header, slist);
-  
   scalar index = {-1};
   
   index = new scalar;
-  z_indexing (index, false);
-  int cell_size = sizeof(unsigned) + header.len*sizeof(double);
-  int sizeofheader = sizeof(header) + 4*sizeof(double);
-  for (scalar s in slist)
-    sizeofheader += sizeof(unsigned) + sizeof(char)*strlen(s.name);
-  long pos = pid() ? 0 : sizeofheader;
+  double maxi = z_indexing (index, false);
+  MPI_Allreduce (MPI_IN_PLACE, &maxi, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  long n = maxi + 1, start = dump_start (dump_header_size (slist));
+
+  img->buf = NULL, img->len = img->size = 0;
+  img->n = 0, img->offset = img->length = NULL;
+  if (pid() == 0) {
+    DumpSink o;
+    dump_sink_init (&o, NULL);
+    dump_header (&o, &header, slist);
+    if (header.version != dump_version)
+      dump_write (&o, &n, sizeof(long));
+    memcpy (dump_image_append (img, 0, o.len), o.buf, o.len);
+    free (o.buf);
+  }
   
   subtree_size (size, false);
+  if (compress)
+    dump_segments_image (img, slist, index, start);
+  else if (blocks)
+    dump_blocks_image (img, slist, index, n, start);
+  else
+    dump_records_image (img, slist, index, dump_header_size (slist));
   
+  delete ({index});
+  free (slist);
+}
+
+/**
+The images of all processes are then written with collective MPI-IO
+calls, using the extents as file view. MPI counts are *int*s, so
+that the extents are split and the image is written in chunks of at
+most `DUMP_CHUNK` bytes (one call is usually enough). */
+
+#define DUMP_CHUNK (1L << 30)
+
+trace
+void dump (const char * file = "dump",
+	   scalar * list = all,
+	   FILE * fp = NULL,
+	   bool unbuffered = false,
+	   bool compress = false,
+	   bool blocks = false)
+{
+  if (fp != NULL || file == NULL) {
+    fprintf (ferr, "dump(): must specify a file name when using MPI\n");
+    exit(1);
+  }
+
+  char name[strlen(file) + 2];
+  strcpy (name, file);
+  if (!unbuffered)
+    strcat (name, "~");
+
+  DumpImage img;
+  dump_image (&img, list, compress, blocks);
+
+  long n = 0;
+  for (long i = 0; i < img.n; i++)
+    n += (img.length[i] + DUMP_CHUNK - 1)/DUMP_CHUNK;
+  if (n > INT_MAX) {
+    fprintf (ferr, "dump(): error: too many extents (%ld)\n", n);
+    exit (1);
+  }
+  int * lengths = (int *) malloc (max(n, 1)*sizeof(int));
+  MPI_Aint * displs = (MPI_Aint *) malloc (max(n, 1)*sizeof(MPI_Aint));
+  n = 0;
+  for (long i = 0; i < img.n; i++)
+    for (long o = 0; o < img.length[i]; o += DUMP_CHUNK) {
+      displs[n] = img.offset[i] + o;
+      lengths[n++] = min (DUMP_CHUNK, img.length[i] - o);
+    }
+  MPI_Datatype view;
+  MPI_Type_create_hindexed (n, lengths, displs, MPI_BYTE, &view);
+  MPI_Type_commit (&view);
+
+  MPI_File fh;
+  if (MPI_File_open (MPI_COMM_WORLD, name, MPI_MODE_CREATE|MPI_MODE_WRONLY,
+		     MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+    fprintf (ferr, "dump(): error: could not open '%s'\n", name);
+    exit (1);
+  }
+  MPI_File_set_size (fh, 0);
+  MPI_File_set_view (fh, 0, MPI_BYTE, view, "native", MPI_INFO_NULL);
+  long nchunks = (img.len + DUMP_CHUNK - 1)/DUMP_CHUNK;
+  mpi_all_reduce (nchunks, MPI_LONG, MPI_MAX);
+  for (long c = 0; c < nchunks; c++) {
+    long o = c*DUMP_CHUNK, len = max (0, min (DUMP_CHUNK, img.len - o));
+    MPI_Status status;
+    if (MPI_File_write_all (fh, img.buf + (len ? o : 0), len, MPI_BYTE,
+			    &status) != MPI_SUCCESS) {
+      fprintf (ferr, "dump(): error while writing\n");
+      exit (1);
+    }
+  }
+  MPI_File_close (&fh);
+
+  MPI_Type_free (&view);
+  free (lengths), free (displs);
+  dump_image_free (&img);
+  if (!unbuffered && pid() == 0)
+    rename (name, file);
+}
+#endif // _MPI
+
+/**
+### Reading dump files
+
+*restore()* reads the cells sequentially, in the order of
+`foreach_cell()`, possibly skipping entire subtrees. This is done
+through a *DumpReader* which hides the file format. For the block
+format, a window of each block is buffered, so that reading the
+(local) cells still results in large sequential reads. For compressed
+files, the segment containing the current cell is decompressed. */
+
+typedef struct {
+  FILE * fp;
+  int version;
+  long start, n, index; // n is zero for the record format
+  int len;              // the number of fields
+  long * first;         // the first index of the window of each block
+  char ** buf;          // the window of each block
+  // compressed files
+  long nseg, * sfirst, * soffset; // the segments, sorted by first index
+  long cfirst, ccount;            // the current (decompressed) segment
+  char * raw, * tmp, * tmp1;
+} DumpReader;
+
+#define DUMP_WINDOW 4096
+
+static int dump_compare_segments (const void * a, const void * b)
+{
+  const long * p = a, * q = b;
+  return p[0] < q[0] ? -1 : p[0] > q[0];
+}
+
+static void dump_reader_init (DumpReader * r, FILE * fp, int len, int version)
+{
+  r->fp = fp, r->len = len, r->version = version, r->index = 0, r->n = 0;
+  r->first = NULL, r->buf = NULL;
+  r->nseg = 0, r->sfirst = r->soffset = NULL, r->raw = NULL;
+  if (version == dump_version_blocks || version == dump_version_compressed) {
+    if (fread (&r->n, sizeof(long), 1, fp) < 1) {
+      fprintf (ferr, "restore(): error: expecting the number of cells\n");
+      exit (1);
+    }
+    r->start = dump_start (ftell (fp) - sizeof(long));
+  }
+  else
+    r->start = ftell (fp);
+  if (version == dump_version_blocks) {
+    r->first = (long *) malloc ((len + 1)*sizeof(long));
+    r->buf = (char **) malloc ((len + 1)*sizeof(char *));
+    for (int b = 0; b <= len; b++) {
+      r->first[b] = - 2*DUMP_WINDOW;
+      r->buf[b] = (char *) malloc (DUMP_WINDOW*sizeof(double));
+    }
+  }
+  else if (version == dump_version_compressed) {
+    if (fseek (fp, - sizeof(long), SEEK_END) < 0 ||
+	fread (&r->nseg, sizeof(long), 1, fp) < 1 ||
+	fseek (fp, - (r->nseg + 1)*sizeof(long), SEEK_END) < 0) {
+      fprintf (ferr, "restore(): error: expecting segments\n");
+      exit (1);
+    }
+    long * s = (long *) malloc (2*max(r->nseg, 1)*sizeof(long));
+    long * offset = (long *) malloc (max(r->nseg, 1)*sizeof(long));
+    if (fread (offset, sizeof(long), r->nseg, fp) != r->nseg) {
+      fprintf (ferr, "restore(): error: expecting segments\n");
+      exit (1);
+    }
+    for (long i = 0; i < r->nseg; i++) {
+      s[2*i + 1] = offset[i];
+      if (fseek (fp, offset[i], SEEK_SET) < 0 ||
+	  fread (&s[2*i], sizeof(long), 1, fp) < 1) {
+	fprintf (ferr, "restore(): error: expecting a segment\n");
+	exit (1);
+      }
+    }
+    free (offset);
+    qsort (s, r->nseg, 2*sizeof(long), dump_compare_segments);
+    r->sfirst = (long *) malloc (max(r->nseg, 1)*sizeof(long));
+    r->soffset = (long *) malloc (max(r->nseg, 1)*sizeof(long));
+    for (long i = 0; i < r->nseg; i++)
+      r->sfirst[i] = s[2*i], r->soffset[i] = s[2*i + 1];
+    free (s);
+    r->cfirst = r->ccount = 0;
+    r->raw = (char *) malloc (DUMP_SEGMENT*(sizeof(unsigned) +
+					    len*sizeof(double)));
+    r->tmp = (char *) malloc (2*DUMP_SEGMENT*sizeof(double));
+    r->tmp1 = (char *) malloc (lz_bound (2*DUMP_SEGMENT*sizeof(double)));
+  }
+}
+
+static void dump_reader_free (DumpReader * r)
+{
+  if (r->buf) {
+    for (int b = 0; b <= r->len; b++)
+      free (r->buf[b]);
+    free (r->buf), free (r->first);
+  }
+  if (r->raw) {
+    free (r->sfirst), free (r->soffset);
+    free (r->raw), free (r->tmp), free (r->tmp1);
+  }
+}
+
+/**
+Decompresses the segment containing cell *index*. */
+
+static void dump_load_segment (DumpReader * r, long index)
+{
+  long s = 0, e = r->nseg - 1;
+  while (s < e) {
+    long m = (s + e + 1)/2;
+    if (r->sfirst[m] <= index)
+      s = m;
+    else
+      e = m - 1;
+  }
+  long header[2];
+  if (r->nseg < 1 || fseek (r->fp, r->soffset[s], SEEK_SET) < 0 ||
+      fread (header, sizeof(long), 2, r->fp) < 2 ||
+      index < header[0] || index >= header[0] + header[1] ||
+      header[1] > DUMP_SEGMENT) {
+    fprintf (ferr, "restore(): error: expecting a segment\n");
+    exit (1);
+  }
+  r->cfirst = header[0], r->ccount = header[1];
+  for (int b = 0; b <= r->len; b++) {
+    DumpBlock block;
+    size_t size = b ? sizeof(double) : sizeof(unsigned);
+    if (fread (&block, sizeof(DumpBlock), 1, r->fp) < 1 ||
+	block.usize > 2*DUMP_SEGMENT*sizeof(double) ||
+	block.size > lz_bound (block.usize) ||
+	fread (r->tmp1, 1, block.size, r->fp) != block.size ||
+	!lz_decompress (r->tmp1, block.size, r->tmp, block.usize)) {
+      fprintf (ferr, "restore(): error: corrupted segment\n");
+      exit (1);
+    }
+    char * raw = dump_raw (r->raw, b);
+    if (block.tolerance > 0.) {
+      byte_unshuffle (r->tmp, r->tmp1, block.usize/size, size);
+      dequantize ((unsigned long *) r->tmp1, r->ccount, block.tolerance,
+		  (double *) raw);
+    }
+    else
+      byte_unshuffle (r->tmp, raw, r->ccount, size);
+  }
+}
+
+/**
+Reads the flags and the values of all the fields of the current
+cell. */
+
+static void dump_read (DumpReader * r, unsigned * flags, double * val)
+{
+  if (!r->n) { // record format
+    if (fread (flags, sizeof(unsigned), 1, r->fp) != 1) {
+      fprintf (ferr, "restore(): error: expecting 'flags'\n");
+      exit (1);
+    }
+    if (fread (val, sizeof(double), r->len, r->fp) != r->len) {
+      fprintf (ferr, "restore(): error: expecting a scalar\n");
+      exit (1);
+    }
+  }
+  else if (r->index >= r->n) {
+    fprintf (ferr, "restore(): error: expecting 'flags'\n");
+    exit (1);
+  }
+  else if (r->raw) { // compressed
+    if (r->index < r->cfirst || r->index >= r->cfirst + r->ccount)
+      dump_load_segment (r, r->index);
+    long i = r->index - r->cfirst;
+    memcpy (flags, r->raw + i*sizeof(unsigned), sizeof(unsigned));
+    for (int b = 1; b <= r->len; b++)
+      memcpy (&val[b - 1], dump_raw (r->raw, b) + i*sizeof(double),
+	      sizeof(double));
+  }
+  else
+    for (int b = 0; b <= r->len; b++) {
+      size_t size = b ? sizeof(double) : sizeof(unsigned);
+      if (r->index < r->first[b] || r->index >= r->first[b] + DUMP_WINDOW) {
+	size_t m = min (DUMP_WINDOW, r->n - r->index);
+	if (fseek (r->fp, dump_block (r->start, r->n, b) + r->index*size,
+		   SEEK_SET) < 0 ||
+	    fread (r->buf[b], size, m, r->fp) != m) {
+	  fprintf (ferr, "restore(): error: expecting %s\n",
+		   b ? "a scalar" : "'flags'");
+	  exit (1);
+	}
+	r->first[b] = r->index;
+      }
+      memcpy (b ? (void *) &val[b - 1] : (void *) flags,
+	      r->buf[b] + (r->index - r->first[b])*size, size);
+    }
+  r->index++;
+}
+
+#if (TREE && _MPI) || MULTIGRID_MPI
+/**
+Skips *n* cells. */
+
+static void dump_skip (DumpReader * r, long n)
+{
+  if (!r->n &&
+      fseek (r->fp, n*(sizeof(unsigned) + r->len*sizeof(double)),
+	     SEEK_CUR) < 0) {
+    perror ("restore(): error while seeking");
+    exit (1);
+  }
+  r->index += n;
+}
+#endif // (TREE && _MPI) || MULTIGRID_MPI
+
+#if TREE && _MPI
+static void dump_rewind (DumpReader * r)
+{
+  if (!r->n)
+    fseek (r->fp, r->start, SEEK_SET);
+  r->index = 0;
+}
+
+/**
+In parallel, each process reads its local cells (given by
+`balanced_pid()` i.e. independently of the number of processes which
+wrote the file), skipping the subtrees which belong to other
+processes, and then the non-local neighbors. */
+
+static void restore_mpi (DumpReader * r, scalar * list1)
+{
+  long index = 0, nt = 0;
+  scalar size[], * list = list_concat ({size}, list1);
+  double val[r->len];
+
+  // read local cells
+  static const unsigned short set = 1 << user;
+  scalar * listm = is_constant(cm) ? NULL : (scalar *){fm};
+  foreach_cell()
+    if (balanced_pid (index, nt, npe()) <= pid()) {
+      unsigned flags;
+      dump_read (r, &flags, val);
+      int i = 0;
+      for (scalar s in list) {
+	if (s.i != INT_MAX)
+	  s[] = val[i];
+	i++;
+      }
+      if (level == 0)
+	nt = size[];
+      cell.pid = balanced_pid (index, nt, npe());
+      cell.flags |= set;
+      if (!(flags & leaf) && is_leaf(cell)) {
+	if (balanced_pid (index + size[] - 1, nt, npe()) < pid()) {
+	  dump_skip (r, size[] - 1);
+	  index += size[];
+	  continue;
+	}
+	refine_cell (point, listm, 0, NULL);
+      }
+      index++;
+      if (is_leaf(cell))
+	continue;
+    }
+
+  // read non-local neighbors
+  dump_rewind (r);
+  index = 0;
   foreach_cell() {
-    // fixme: this won't work when combining MPI and mask()
-    if (is_local(cell)) {
-      long offset = sizeofheader + index[]*cell_size;
-      if (pos != offset) {
-	fseek (fh, offset, SEEK_SET);
-	pos = offset;
+    unsigned flags;
+    dump_read (r, &flags, val);
+    if (!(cell.flags & set)) {
+      int i = 0;
+      for (scalar s in list) {
+	if (s.i != INT_MAX)
+	  s[] = val[i];
+	i++;
       }
-      unsigned flags = is_leaf(cell) ? leaf : 0;
-      fwrite (&flags, 1, sizeof(unsigned), fh);
-      for (scalar s in slist) {
-	double val = s[];
-	fwrite (&val, 1, sizeof(double), fh);
+      cell.pid = balanced_pid (index, nt, npe());
+      if (is_leaf(cell) && cell.neighbors) {
+	int pid = cell.pid;
+	foreach_child()
+	  cell.pid = pid;
+      }
+    }
+    if (!(flags & leaf) && is_leaf(cell)) {
+      bool locals = false;
+      foreach_neighbor(1)
+	if ((cell.flags & set) && (is_local(cell) || is_root(point))) {
+	  locals = true; break;
+	}
+      if (locals)
+	refine_cell (point, listm, 0, NULL);
+      else {
+	dump_skip (r, size[] - 1);
+	index += size[];
+	continue;
       }
-      pos += cell_size;
     }
+    index++;
     if (is_leaf(cell))
       continue;
   }
+  /* set active flags */
+  foreach_cell_post (is_active (cell)) {
+    cell.flags &= ~set;
+    if (is_active (cell)) {
+      if (is_leaf (cell)) {
+	if (cell.neighbors > 0) {
+	  int pid = cell.pid;
+	  foreach_child()
+	    cell.pid = pid;
+	}
+	if (!is_local(cell))
+	  cell.flags &= ~active;
+      }
+      else if (!is_local(cell)) {
+	bool inactive = true;
+	foreach_child()
+	  if (is_active(cell)) {
+	    inactive = false; break;
+	  }
+	if (inactive)
+	  cell.flags &= ~active;
+      }
+    }
+  }
 
-  delete ({index});
-  
-  free (slist);
-  fclose (fh);
-  if (!unbuffered && pid() == 0)
-    rename (name, file);
+  flag_border_cells();
+
+  mpi_boundary_update (list);
+  free (list);
 }
-#endif // _MPI
+#endif // TREE && _MPI
 
 trace
 bool restore (const char * file = "dump",
@@ -1219,7 +2066,9 @@ bool restore (const char * file = "dump",
     }
   }
   else { // header.version != 161020
-    if (header.version != dump_version) {
+    if (header.version != dump_version &&
+	header.version != dump_version_blocks &&
+	header.version != dump_version_compressed) {
       fprintf (ferr,
 	       "restore(): error: file version mismatch: "
 	       "%d (file) != %d (code)\n",
@@ -1272,36 +2121,27 @@ bool restore (const char * file = "dump",
     size (o[3]);
   }
 
+  DumpReader r;
+  dump_reader_init (&r, fp, header.len, header.version);
+
 #if MULTIGRID_MPI
-  long cell_size = sizeof(unsigned) + header.len*sizeof(double);
-  long offset = pid()*((1 << dimension*(header.depth + 1)) - 1)/
-    ((1 << dimension) - 1)*cell_size;
-  if (fseek (fp, offset, SEEK_CUR) < 0) {
-    perror ("restore(): error while seeking");
-    exit (1);
-  }
+  dump_skip (&r, pid()*((1 << dimension*(header.depth + 1)) - 1)/
+	     ((1 << dimension) - 1));
 #endif // MULTIGRID_MPI
   
   scalar * listm = is_constant(cm) ? NULL : (scalar *){fm};
 #if TREE && _MPI
-  restore_mpi (fp, slist);
+  restore_mpi (&r, slist);
 #else
+  double val[header.len];
   foreach_cell() {
     unsigned flags;
-    if (fread (&flags, sizeof(unsigned), 1, fp) != 1) {
-      fprintf (ferr, "restore(): error: expecting 'flags'\n");
-      exit (1);
-    }
-    // skip subtree size
-    fseek (fp, sizeof(double), SEEK_CUR);
+    dump_read (&r, &flags, val);
+    int i = 1; // skip subtree size
     for (scalar s in slist) {
-      double val;
-      if (fread (&val, sizeof(double), 1, fp) != 1) {
-	fprintf (ferr, "restore(): error: expecting a scalar\n");
-	exit (1);
-      }
       if (s.i != INT_MAX)
-	s[] = val;
+	s[] = val[i];
+      i++;
     }
     if (!(flags & leaf) && is_leaf(cell))
       refine_cell (point, listm, 0, NULL);
@@ -1311,6 +2151,19 @@ bool restore (const char * file = "dump",
   for (scalar s in all)
     s.dirty = true;
 #endif
+  dump_reader_free (&r);
+
+  /**
+  The values on non-leaf cells are not stored in compressed files. */
+
+  if (header.version == dump_version_compressed) {
+    scalar * listr = NULL;
+    for (scalar s in slist)
+      if (s.i != INT_MAX)
+	listr = list_append (listr, s);
+    restriction (listr);
+    free (listr);
+  }
   
   scalar * other = NULL;
   for (scalar s in all)
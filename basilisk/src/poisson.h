@@ -27,14 +27,209 @@ approximate solution $\tilde{a}$.
 Here we implement the multigrid cycle proper. Given an initial guess
 *a*, a residual *res*, a correction field *da* and a relaxation
 function *relax*, we will provide an improved guess at the end of the
-cycle. */
+cycle.
+
+### Schedules
+
+The default cycle is a single sweep from the coarsest to the finest
+level: on each level, the initial guess is interpolated from the
+coarser level and relaxed. The low-frequency errors which remain on a
+level after relaxation are thus never corrected. For stiff problems
+(e.g. large density ratios) this is where convergence is lost.
+
+If a function *residual_level* computing the residual on a given level
+is provided, each level can also be corrected using the coarser
+levels, as in standard multigrid cycles. The residual on the level is
+restricted to all coarser levels where a correction is computed
+(using a single coarse-to-fine sweep), which is then interpolated and
+added. This is done once per level for an *F-cycle* and twice for a
+*W-cycle*.
+
+The schedule is set globally by *mg_schedule*. The number of
+relaxations on level *l* before the coarse correction is
+`mg_schedule.pre[l]` (or *nrelax* if zero) and the number of
+relaxations after the correction is `mg_schedule.post[l]` (zero by
+default). For example
+
+~~~literatec
+mg_schedule.cycle = MG_WCYCLE;
+for (int l = 0; l < 5; l++)
+  mg_schedule.pre[l] = mg_schedule.post[l] = 8;
+~~~
+
+uses W-cycles with more relaxations on the five coarsest levels. */
+
+enum {
+  MG_VCYCLE, // single coarse-to-fine sweep (the default)
+  MG_FCYCLE, // one coarse correction per level
+  MG_WCYCLE  // two coarse corrections per level
+};
+
+#define MG_LEVELS 32
+
+struct {
+  int cycle;           // MG_VCYCLE, MG_FCYCLE or MG_WCYCLE
+  int pre[MG_LEVELS];  // relaxations before the coarse correction
+  int post[MG_LEVELS]; // relaxations after the coarse correction
+  bool stats;          // collect per-level statistics
+  bool overlap;        // overlap halo exchanges and relaxations
+} mg_schedule = {MG_VCYCLE};
+
+/**
+### Per-level statistics
+
+If `mg_schedule.stats` is set (and *residual_level* is provided), the
+time spent on each level and the maximum residuals on this level
+before and after relaxation are accumulated over all cycles. */
+
+typedef struct {
+  int n;              // number of visits
+  int relax;          // number of relaxations
+  double t;           // time spent (in seconds)
+  double resb, resa;  // sum of the maximum residuals before and after
+} mglevel;
+
+/**
+### Overlapping communications and relaxations
+
+With MPI, the halos of the correction are exchanged before each
+relaxation. If `mg_schedule.overlap` is set, this exchange uses
+[split-phase boundary
+conditions](/src/grid/cartesian-common.h#split-phase-boundary-conditions):
+the cells which do not depend on the halos (i.e. which are not
+`is_border()`) are relaxed while the halos are in flight, and the
+border cells once they have been received.
+
+The relaxation function is then called twice, with *mg_relax_cells*
+set to *MG_INTERIOR* and *MG_BORDER*, and must only relax the
+corresponding cells, i.e. those for which `relax_cell()` is true. It
+declares that it does so by setting the *split* argument of
+`mg_solve()`. Since the border cells are relaxed last, the result
+depends on this option, as it does on the traversal order for
+non-Jacobi relaxations. The exchanges only overlap on full trees
+(see `mpi_boundary_start()`): on adaptive trees, or on a single
+process, the relaxation is not split. */
+
+enum { MG_ALL, MG_INTERIOR, MG_BORDER };
+
+int mg_relax_cells = MG_ALL;
+
+#if TREE && _MPI
+# define relax_cell() (mg_relax_cells == MG_ALL ||			\
+		       (mg_relax_cells == MG_BORDER) == (is_border(cell) != 0))
+#else
+# define relax_cell() true
+#endif
+
+/* whether the relaxation function of the current solve is split */
+static bool mg_split = false;
+
+static int mg_pre (int l, int nrelax)
+{
+  return l < MG_LEVELS && mg_schedule.pre[l] > 0 ? mg_schedule.pre[l] : nrelax;
+}
+
+static int mg_post (int l)
+{
+  return l < MG_LEVELS ? mg_schedule.post[l] : 0;
+}
+
+/**
+### Implementation
+
+On the coarsest grid, we take zero as initial guess. On all other
+grids, we take as initial guess the approximate solution on the
+coarser grid bilinearly interpolated onto the current grid. */
+
+static void mg_guess (scalar * da, int l, int minlevel)
+{
+  if (l == minlevel)
+    foreach_level_or_leaf (l)
+      for (scalar s in da)
+	foreach_blockf (s)
+	  s[] = 0.;
+  else {
+    boundary_level (da, l - 1);
+    foreach_level (l)
+      for (scalar s in da)
+	foreach_blockf (s)
+	  s[] = bilinear (point, s);
+  }
+}
+
+/**
+We apply homogeneous boundary conditions and do several iterations
+of the relaxation function to refine the guess. */
+
+static void mg_relax (scalar * da, scalar * res,
+		      void (* relax) (scalar * da, scalar * res,
+				      int depth, void * data),
+		      void * data, int l, int nrelax)
+{
+#if TREE && _MPI
+  if (mg_schedule.overlap && mg_split && npe() > 1 && tree_is_full()) {
+    for (int i = 0; i < nrelax; i++) {
+      boundary_start (da, l);
+      mg_relax_cells = MG_INTERIOR;
+      relax (da, res, l, data);
+      boundary_finish();
+      mg_relax_cells = MG_BORDER;
+      relax (da, res, l, data);
+      mg_relax_cells = MG_ALL;
+    }
+    return;
+  }
+#endif
+  for (int i = 0; i < nrelax; i++) {
+    boundary_level (da, l);
+    relax (da, res, l, data);
+  }
+}
+
+/**
+The coarse correction of level *l* uses the fields *c* (for the
+correction) and *d* (for the residual). */
+
+static void mg_correction (scalar * da, scalar * res, scalar * c, scalar * d,
+			   void (* relax) (scalar * da, scalar * res,
+					   int depth, void * data),
+			   double (* residual_level) (scalar * da, scalar * res,
+						      scalar * d, int l,
+						      void * data),
+			   void * data, int nrelax, int minlevel, int l)
+{
+  boundary_level (da, l);
+  residual_level (da, res, d, l, data);
+  boundary_level (d, l);
+  for (int k = l - 1; k >= minlevel; k--) {
+    foreach_coarse_level (k, nowarning)
+      for (scalar s in d)
+	foreach_block()
+	  s.restriction (point, s);
+    boundary_level (d, k);
+  }
+  for (int k = minlevel; k < l; k++) {
+    mg_guess (c, k, minlevel);
+    mg_relax (c, d, relax, data, k, mg_pre (k, nrelax) + mg_post (k));
+  }
+  boundary_level (c, l - 1);
+  foreach_level_or_leaf (l) {
+    scalar s, ds;
+    for (s, ds in da, c)
+      foreach_blockf (s)
+	s[] += level == l ? bilinear (point, ds) : ds[];
+  }
+}
 
 trace
 void mg_cycle (scalar * a, scalar * res, scalar * da,
 	       void (* relax) (scalar * da, scalar * res, 
 			       int depth, void * data),
 	       void * data,
-	       int nrelax, int minlevel, int maxlevel)
+	       int nrelax, int minlevel, int maxlevel,
+	       double (* residual_level) (scalar * da, scalar * res,
+					  scalar * d, int l, void * data) = NULL,
+	       mglevel * stats = NULL)
 {
 
   /**
@@ -42,41 +237,44 @@ void mg_cycle (scalar * a, scalar * res, scalar * da,
 
   restriction (res);
 
+  /**
+  We allocate the fields needed for the coarse corrections and for the
+  statistics. */
+  
+  int ncorrections = !residual_level ? 0 :
+    mg_schedule.cycle == MG_WCYCLE ? 2 : mg_schedule.cycle == MG_FCYCLE;
+  if (!residual_level)
+    stats = NULL;
+  scalar * c = ncorrections ? list_clone (da) : NULL;
+  scalar * d = ncorrections || stats ? list_clone (res) : NULL;
+
   /**
   We then proceed from the coarsest grid (*minlevel*) down to the
   finest grid. */
 
   minlevel = min (minlevel, maxlevel);
   for (int l = minlevel; l <= maxlevel; l++) {
-
-    /**
-    On the coarsest grid, we take zero as initial guess. */
-
-    if (l == minlevel)
-      foreach_level_or_leaf (l)
-	for (scalar s in da)
-	  foreach_blockf (s)
-	    s[] = 0.;
-
-    /**
-    On all other grids, we take as initial guess the approximate solution
-    on the coarser grid bilinearly interpolated onto the current grid. */
-
-    else {
-      boundary_level (da, l - 1);
-      foreach_level (l)
-	for (scalar s in da)
-	  foreach_blockf (s)
-	    s[] = bilinear (point, s);
+    timer t0 = timer_start();
+    mg_guess (da, l, minlevel);
+    double resb = 0.;
+    if (stats && l < MG_LEVELS) {
+      boundary_level (da, l);
+      resb = residual_level (da, res, d, l, data);
     }
-    
-    /**
-    We then apply homogeneous boundary conditions and do several
-    iterations of the relaxation function to refine the initial guess. */
-
-    for (int i = 0; i < nrelax; i++) {
+    int n = mg_pre (l, nrelax);
+    mg_relax (da, res, relax, data, l, n);
+    if (l > minlevel)
+      for (int i = 0; i < ncorrections; i++)
+	mg_correction (da, res, c, d, relax, residual_level, data,
+		       nrelax, minlevel, l);
+    mg_relax (da, res, relax, data, l, mg_post (l));
+    if (stats && l < MG_LEVELS) {
       boundary_level (da, l);
-      relax (da, res, l, data);
+      stats[l].resa += residual_level (da, res, d, l, data);
+      stats[l].resb += resb;
+      stats[l].relax += n + mg_post (l);
+      stats[l].n++;
+      stats[l].t += timer_elapsed (t0);
     }
   }
 
@@ -89,6 +287,11 @@ void mg_cycle (scalar * a, scalar * res, scalar * da,
       foreach_blockf (s)
 	s[] += ds[];
   }
+
+  if (c)
+    delete (c), free (c);
+  if (d)
+    delete (d), free (d);
 }
 
 /**
@@ -104,6 +307,17 @@ tolerance by *TOLERANCE* with the default values below. */
 int NITERMAX = 100, NITERMIN = 1;
 double TOLERANCE = 1e-3 [*];
 
+/**
+The solver either iterates multigrid cycles (the default) or uses a
+single cycle as the preconditioner of a [Krylov
+method](#krylov-acceleration). */
+
+enum {
+  MG_MULTIGRID, // multigrid cycles
+  MG_CG,        // multigrid-preconditioned conjugate gradient
+  MG_BICGSTAB   // multigrid-preconditioned BiCGStab
+};
+
 /**
 Information about the convergence of the solver is returned in a structure. */
 
@@ -113,8 +327,252 @@ typedef struct {
   double sum;         // sum of r.h.s.
   int nrelax;         // number of relaxations
   int minlevel;       // minimum level of the multigrid hierarchy
+  int solver;         // MG_MULTIGRID, MG_CG or MG_BICGSTAB
+  mglevel level[MG_LEVELS]; // per-level statistics (see mg_schedule)
 } mgstats;
 
+/**
+## Krylov acceleration
+
+When the operator is very stiff (e.g. for large density ratios),
+multigrid cycles can stall, even with many relaxations. The cycle is
+then much more effective as a preconditioner of the [conjugate
+gradient](https://en.wikipedia.org/wiki/Conjugate_gradient_method)
+(for symmetric operators such as the Poisson equation) or of
+[BiCGStab](https://en.wikipedia.org/wiki/Biconjugate_gradient_stabilized_method)
+(for non-symmetric operators such as the viscous terms with variable
+density).
+
+The operator is only known through the residual function, which
+returns $b - L(a)$: with a zero right-hand-side and homogeneous
+boundary conditions, it gives $-L(a)$. The scalar products are
+weighted by the volume of the cells, for which the discrete operator
+is symmetric on adaptive meshes. */
+
+static void mg_homogeneous (scalar * list)
+{
+  for (int b = 0; b < nboundary; b++)
+    for (scalar s in list)
+      s.boundary[b] = s.boundary_homogeneous[b];
+}
+
+static double mg_dot (scalar * a, scalar * b)
+{
+  double sum = 0.;
+  foreach (reduction(+:sum)) {
+    scalar s, ds;
+    for (s, ds in a, b)
+      foreach_blockf (s)
+	sum += pow (Delta, dimension)*s[]*ds[];
+  }
+  return sum;
+}
+
+/**
+The preconditioner is a single multigrid cycle, starting from a zero
+guess. */
+
+static void mg_precondition (scalar * w, scalar * r, scalar * da,
+			     void (* relax) (scalar * da, scalar * res,
+					     int depth, void * data),
+			     double (* residual_level) (scalar * da,
+							scalar * res,
+							scalar * d, int l,
+							void * data),
+			     void * data, int minlevel, mgstats * mg)
+{
+  foreach()
+    for (scalar s in w)
+      foreach_blockf (s)
+	s[] = 0.;
+  mg_cycle (w, r, da, relax, data, mg->nrelax, minlevel, grid->maxdepth,
+	    residual_level, mg_schedule.stats ? mg->level : NULL);
+}
+
+/**
+Since neither the relaxation nor the coarse/fine interpolations are
+symmetric, the cycle is not a symmetric preconditioner. We use the
+*flexible* (Polak-Ribière) variant of the conjugate gradient, which
+does not require it.
+
+Both methods update *a* and the residual *r* until the maximum
+residual is smaller than *tolerance*. The residual is then
+recomputed, and the iterations restarted if necessary, to avoid the
+drift of the updated residual. */
+
+static void mg_cg (scalar * a, scalar * b, scalar * r, scalar * da,
+		   double (* residual) (scalar * a, scalar * b, scalar * res,
+					void * data),
+		   void (* relax) (scalar * da, scalar * res, int depth,
+				   void * data),
+		   double (* residual_level) (scalar * da, scalar * res,
+					      scalar * d, int l, void * data),
+		   void * data, int minlevel, double tolerance, mgstats * mg)
+{
+  scalar * w = list_clone (a), * p = list_clone (a);
+  scalar * q = list_clone (b), * zero = list_clone (b);
+  mg_homogeneous (w), mg_homogeneous (p);
+  foreach()
+    for (scalar s in zero)
+      foreach_blockf (s)
+	s[] = 0.;
+
+  while (mg->i < NITERMAX && (mg->i < NITERMIN || mg->resa > tolerance)) {
+    int i0 = mg->i;
+    mg_precondition (w, r, da, relax, residual_level, data, minlevel, mg);
+    foreach() {
+      scalar s, ds;
+      for (s, ds in p, w)
+	foreach_blockf (s)
+	  s[] = ds[];
+    }
+    double rz = mg_dot (r, w);
+    while (mg->i < NITERMAX) {
+
+      /**
+      Note that *q* is $-L(p)$. */
+      
+      residual (p, zero, q, data);
+      double pq = mg_dot (p, q);
+      if (!pq || !rz)
+	break;
+      double alpha = - rz/pq, maxres = 0.;
+      foreach (reduction(max:maxres)) {
+	scalar s, ds;
+	for (s, ds in a, p)
+	  foreach_blockf (s)
+	    s[] += alpha*ds[];
+	for (s, ds in r, q)
+	  foreach_blockf (s) {
+	    s[] += alpha*ds[];
+	    if (fabs (s[]) > maxres)
+	      maxres = fabs (s[]);
+	  }
+      }
+      mg->i++, mg->resa = maxres;
+      if (maxres <= tolerance && mg->i >= NITERMIN)
+	break;
+      mg_precondition (w, r, da, relax, residual_level, data, minlevel, mg);
+      double rz1 = mg_dot (r, w), beta = alpha*mg_dot (w, q)/rz;
+      foreach() {
+	scalar s, ds;
+	for (s, ds in p, w)
+	  foreach_blockf (s)
+	    s[] = ds[] + beta*s[];
+      }
+      rz = rz1;
+    }
+    mg->resa = residual (a, b, r, data);
+    if (mg->i == i0) // breakdown
+      break;
+  }
+
+  delete (w), free (w), delete (p), free (p);
+  delete (q), free (q), delete (zero), free (zero);
+}
+
+/**
+Each iteration of BiCGStab uses two multigrid cycles. */
+
+static void mg_bicgstab (scalar * a, scalar * b, scalar * r, scalar * da,
+			 double (* residual) (scalar * a, scalar * b,
+					      scalar * res, void * data),
+			 void (* relax) (scalar * da, scalar * res, int depth,
+					 void * data),
+			 double (* residual_level) (scalar * da, scalar * res,
+						    scalar * d, int l,
+						    void * data),
+			 void * data, int minlevel, double tolerance,
+			 mgstats * mg)
+{
+  scalar * w = list_clone (a), * p = list_clone (b), * r0 = list_clone (b);
+  scalar * v = list_clone (b), * q = list_clone (b), * zero = list_clone (b);
+  mg_homogeneous (w);
+  foreach()
+    for (scalar s in zero)
+      foreach_blockf (s)
+	s[] = 0.;
+
+  while (mg->i < NITERMAX && (mg->i < NITERMIN || mg->resa > tolerance)) {
+    int i0 = mg->i;
+    double rho = 1., alpha = 1., omega = 1.;
+    foreach() {
+      scalar s, ds;
+      for (s, ds in r0, r)
+	foreach_blockf (s)
+	  s[] = ds[];
+      for (s, ds in p, v)
+	foreach_blockf (s)
+	  s[] = ds[] = 0.;
+    }
+    while (mg->i < NITERMAX) {
+      double rho1 = mg_dot (r0, r);
+      if (!rho1)
+	break;
+
+      /**
+      Note that *v* and *q* are $-L(w)$. */
+      
+      double beta = (rho1/rho)*(alpha/omega);
+      foreach() {
+	scalar s, ds, dv;
+	for (s, ds, dv in p, r, v)
+	  foreach_blockf (s)
+	    s[] = ds[] + beta*(s[] + omega*dv[]);
+      }
+      mg_precondition (w, p, da, relax, residual_level, data, minlevel, mg);
+      residual (w, zero, v, data);
+      double rv = mg_dot (r0, v);
+      if (!rv)
+	break;
+      alpha = - rho1/rv;
+      double maxres = 0.;
+      foreach (reduction(max:maxres)) {
+	scalar s, ds;
+	for (s, ds in a, w)
+	  foreach_blockf (s)
+	    s[] += alpha*ds[];
+	for (s, ds in r, v)
+	  foreach_blockf (s) {
+	    s[] += alpha*ds[];
+	    if (fabs (s[]) > maxres)
+	      maxres = fabs (s[]);
+	  }
+      }
+      mg->i++, mg->resa = maxres;
+      if (maxres <= tolerance && mg->i >= NITERMIN)
+	break;
+      mg_precondition (w, r, da, relax, residual_level, data, minlevel, mg);
+      residual (w, zero, q, data);
+      double qq = mg_dot (q, q);
+      if (!qq)
+	break;
+      omega = - mg_dot (q, r)/qq, maxres = 0.;
+      foreach (reduction(max:maxres)) {
+	scalar s, ds;
+	for (s, ds in a, w)
+	  foreach_blockf (s)
+	    s[] += omega*ds[];
+	for (s, ds in r, q)
+	  foreach_blockf (s) {
+	    s[] += omega*ds[];
+	    if (fabs (s[]) > maxres)
+	      maxres = fabs (s[]);
+	  }
+      }
+      mg->resa = maxres, rho = rho1;
+      if (maxres <= tolerance && mg->i >= NITERMIN)
+	break;
+    }
+    mg->resa = residual (a, b, r, data);
+    if (mg->i == i0) // breakdown
+      break;
+  }
+
+  delete (w), free (w), delete (p), free (p), delete (r0), free (r0);
+  delete (v), free (v), delete (q), free (q), delete (zero), free (zero);
+}
+
 /**
 The user needs to provide a function which computes the residual field
 (and returns its maximum) as well as the relaxation function. The
@@ -122,7 +580,9 @@ user-defined pointer *data* can be used to pass arguments to these
 functions. The optional number of relaxations is *nrelax* and *res* is
 an optional list of fields used to store the residuals. The minimum
 level of the hierarchy can be set (default is zero i.e. the root
-cell). */
+cell). The *solver* is `MG_MULTIGRID` (the default), `MG_CG` or
+`MG_BICGSTAB`. The optional *residual_level* function is required for
+[F- and W-cycles](#schedules) and per-level statistics. */
 
 trace
 mgstats mg_solve (scalar * a, scalar * b,
@@ -134,7 +594,12 @@ mgstats mg_solve (scalar * a, scalar * b,
 		  int nrelax = 4,
 		  scalar * res = NULL,
 		  int minlevel = 0,
-		  double tolerance = TOLERANCE)
+		  double tolerance = TOLERANCE,
+		  int solver = MG_MULTIGRID,
+		  double (* residual_level) (scalar * da, scalar * res,
+					     scalar * d, int l,
+					     void * data) = NULL,
+		  bool split = false)
 {
 
   /**
@@ -150,9 +615,14 @@ mgstats mg_solve (scalar * a, scalar * b,
   *homogeneous* equivalent of the boundary conditions applied to
   *a*. */
 
-  for (int b = 0; b < nboundary; b++)
-    for (scalar s in da)
-      s.boundary[b] = s.boundary_homogeneous[b];
+  mg_homogeneous (da);
+
+  /**
+  The relaxation function can be split if it [supports
+  it](#overlapping-communications-and-relaxations). */
+
+  bool split0 = mg_split;
+  mg_split = split;
   
   /**
   We initialise the structure storing convergence statistics. */
@@ -164,6 +634,7 @@ mgstats mg_solve (scalar * a, scalar * b,
     sum += rhs[];
   s.sum = sum;
   s.nrelax = nrelax > 0 ? nrelax : 4;
+  s.solver = solver;
   
   /**
   Here we compute the initial residual field and its maximum. */
@@ -171,18 +642,29 @@ mgstats mg_solve (scalar * a, scalar * b,
   double resb;
   resb = s.resb = s.resa = (* residual) (a, b, res, data);
 
+  /**
+  Krylov iterations are used if requested. */
+
+  if (solver == MG_CG)
+    mg_cg (a, b, res, da, residual, relax, residual_level, data,
+	   minlevel, tolerance, &s);
+  else if (solver == MG_BICGSTAB)
+    mg_bicgstab (a, b, res, da, residual, relax, residual_level, data,
+		 minlevel, tolerance, &s);
+  
   /**
   We then iterate until convergence or until *NITERMAX* is reached. Note
   also that we force the solver to apply at least one cycle, even if the
-  initial residual is lower than *TOLERANCE*. */
+  initial residual is lower than *TOLERANCE*. This is also a fallback
+  if the Krylov iterations break down. */
   
-  for (s.i = 0;
-       s.i < NITERMAX && (s.i < NITERMIN || s.resa > tolerance);
-       s.i++) {
+  for (; s.i < NITERMAX && (s.i < NITERMIN || s.resa > tolerance); s.i++) {
     mg_cycle (a, res, da, relax, data,
 	      s.nrelax,
 	      minlevel,
-	      grid->maxdepth);
+	      grid->maxdepth,
+	      residual_level,
+	      mg_schedule.stats ? s.level : NULL);
     s.resa = (* residual) (a, b, res, data);
 
     /**
@@ -226,6 +708,7 @@ mgstats mg_solve (scalar * a, scalar * b,
   if (!pres)
     delete (res), free (res);
   delete (da), free (da);
+  mg_split = split0;
 
   return s;
 }
@@ -249,7 +732,8 @@ default *TOLERANCE* of the multigrid solver, *nrelax* controls the
 initial number of relaxations (default is one), *minlevel* controls
 the minimum level of the hierarchy (default is one) and *res* is an
 optional list of fields used to store the final residual (which can be
-useful to monitor convergence). */
+useful to monitor convergence). The *solver* selects [Krylov
+acceleration](#krylov-acceleration) (e.g. `MG_CG`). */
 
 struct Poisson {
   scalar a, b;
@@ -293,16 +777,31 @@ static void relax (scalar * al, scalar * bl, int l, void * data)
 #endif
 
   /**
-  On GPUs, we use red/black Gauss-Seidel relaxation, which requires
-  two loops (for odd/even indices). Note also that, unlike the other
-  option, red/black relaxation should be deterministic. */
+  With Gauss-Seidel relaxation (always used on GPUs), the cells are
+  relaxed one colour at a time. The cells of a given colour only
+  depend on cells of the other colours, so that, unlike the other
+  option, the result does not depend on the traversal order or on the
+  number of threads. Two (red/black) colours are enough for the
+  Laplacian, but embedded fluxes also use diagonal neighbours, which
+  requires $2^{dimension}$ colours. On trees, the cells of each colour
+  are stored contiguously. */
   
 #if GAUSS_SEIDEL || _GPU
-  for (int parity = 0; parity < 2; parity++)
+#if EMBED
+  const int ncolours = 1 << dimension;
+#else
+  const int ncolours = 2;
+#endif
+  for (int colour = 0; colour < ncolours; colour++)
+#if _GPU
     foreach_level_or_leaf (l, nowarning)
-      if (level == 0 || ((point.i + parity) % 2) != (point.j % 2))
+      if (cell_colour (ncolours) == colour)
+#else
+    foreach_level_or_leaf_colour (l, colour, ncolours)
+#endif
 #else
   foreach_level_or_leaf (l, nowarning)
+    if (relax_cell())
 #endif
   {
 
@@ -346,6 +845,17 @@ static void relax (scalar * al, scalar * bl, int l, void * data)
 #endif
 }
 
+/**
+With the simple traversal, the interior and border cells can be
+relaxed separately, which allows [overlapping communications and
+relaxations](#overlapping-communications-and-relaxations). */
+
+#if JACOBI || GAUSS_SEIDEL || _GPU
+# define RELAX_SPLIT false
+#else
+# define RELAX_SPLIT true
+#endif
+
 /**
 The equivalent residual function is obtained in a similar way in the
 case of a Cartesian grid, however the case of the tree mesh
@@ -396,6 +906,43 @@ static double residual (scalar * al, scalar * bl, scalar * resl, void * data)
   return maxres;
 }
 
+/**
+The residual on a given level (used for [F- and W-cycles](#schedules))
+is the defect of the discrete equation solved by the relaxation
+function, on the cells of level *l* and the leaves coarser than *l*. */
+
+static double residual_level (scalar * al, scalar * bl, scalar * resl, int l,
+			      void * data)
+{
+  scalar a = al[0], b = bl[0], res = resl[0];
+  struct Poisson * p = (struct Poisson *) data;
+  (const) face vector alpha = p->alpha;
+  (const) scalar lambda = p->lambda;
+  double maxres = 0.;
+  foreach_level_or_leaf (l, reduction(max:maxres), nowarning) {
+    double n = lambda[]*a[];
+    foreach_dimension()
+      n += (alpha.x[1]*(a[1] - a[]) + alpha.x[]*(a[-1] - a[]))/sq(Delta);
+#if EMBED
+    double d = - lambda[];
+    foreach_dimension()
+      d += (alpha.x[1] + alpha.x[])/sq(Delta);
+    if (p->embed_flux) {
+      double c, e = p->embed_flux (point, a, alpha, &c);
+      n -= c + e*a[];
+      d += e;
+    }
+    if (!d)
+      res[] = 0.;
+    else
+#endif // EMBED
+      res[] = b[] - n;
+    if (fabs (res[]) > maxres)
+      maxres = fabs (res[]);
+  }
+  return maxres;
+}
+
 /**
 ## User interface
 
@@ -413,7 +960,8 @@ mgstats poisson (scalar a, scalar b,
 		 int nrelax = 4,
 		 int minlevel = 0,
 		 scalar * res = NULL,
-		 double (* flux) (Point, scalar, vector, double *) = NULL)
+		 double (* flux) (Point, scalar, vector, double *) = NULL,
+		 int solver = MG_MULTIGRID)
 {
 
   /**
@@ -449,7 +997,8 @@ mgstats poisson (scalar a, scalar b,
     p.embed_flux = flux;
 #endif // EMBED
   mgstats s = mg_solve ({a}, {b}, residual, relax, &p,
-			nrelax, res, max(1, minlevel));
+			nrelax, res, max(1, minlevel), solver = solver,
+			residual_level = residual_level, split = RELAX_SPLIT);
 
   /**
   We restore the default. */
@@ -481,7 +1030,8 @@ trace
 mgstats project (face vector uf, scalar p,
 		 (const) face vector alpha = unityf,
 		 double dt = 1.,
-		 int nrelax = 4)
+		 int nrelax = 4,
+		 int solver = MG_MULTIGRID)
 {
   
   /**
@@ -507,7 +1057,8 @@ mgstats project (face vector uf, scalar p,
   Given the scaling of the divergence above, this gives */
 
   mgstats mgp = poisson (p, div, alpha,
-			 tolerance = TOLERANCE/sq(dt), nrelax = nrelax);
+			 tolerance = TOLERANCE/sq(dt), nrelax = nrelax,
+			 solver = solver);
 
   /**
   And compute $\mathbf{u}_f^{n+1}$ using $\mathbf{u}_f$ and $p$. */
@@ -54,7 +54,7 @@ All other options will be passed directly to the C compiler. */
 int dimension = 2, bghosts = 0, layers = 0;
   
 int debug = 0, catch = 0, cadna = 0, nolineno = 0, events = 0, progress = 0;
-int parallel = 0, cpu = 0, gpu = 0;
+int parallel = 0, cpu = 0, gpu = 0, mixed = 0;
 static FILE * dimensions = NULL;
 static int run = -1, finite = 1, redundant = 0, warn = 0, maxcalls = 20000000;
 char dir[] = ".qccXXXXXX";
@@ -116,9 +116,9 @@ void * compdir (FILE * fin, FILE * fout, FILE * swigfp,
   void * endfor (FILE * fin, FILE * fout,
 		 const char * grid, int dimension,
 		 int nolineno, int progress, int catch, int parallel, int cpu, int gpu,
-		 FILE * swigfp, char * swigname);
+		 int mixed, FILE * swigfp, char * swigname);
   void * ast = endfor (fin, fout1, grid, dimension, nolineno, progress, catch, parallel, cpu, gpu,
-		       swigfp, swigname);
+		       mixed, swigfp, swigname);
   fclose (fout1);
   
   fout1 = dopen ("_endfor.c", "r");
@@ -271,6 +271,9 @@ int main (int argc, char ** argv)
   }
   if (strstr (command, "-D_MPI"))
     parallel = 1;
+  char * precision = strstr (command, "-DMIXED_PRECISION");
+  if (precision && strncmp (precision + strlen ("-DMIXED_PRECISION"), "=0", 2))
+    mixed = 1;
   char * openmp = strstr (command, "-fopenmp");
   if (openmp) {
     parallel = 1;
@@ -49,10 +49,65 @@ static long lookup_tag (Array * a, double tag)
 static int compar_double (const void * p1, const void * p2)
 {
   const double * a = p1, * b = p2;
-  return *a > *b;
+  return (*a > *b) - (*a < *b);
+}
+
+/* pairs of labels, in lexicographic order */
+static int compar_pair (const void * p1, const void * p2)
+{
+  const double * a = p1, * b = p2;
+  return a[0] != b[0] ? compar_double (a, b) : compar_double (a + 1, b + 1);
 }
 #endif
 
+/**
+Connected cells are gathered using a [union-find (or disjoint-set)
+structure](https://en.wikipedia.org/wiki/Disjoint-set_data_structure).
+Each element *i* points *up* to another element of its set, the root
+of the set pointing to itself. The root is always the element with the
+smallest *label*, so that each neighborhood ends up with the minimum
+of the initial tag values of its cells. The paths are compressed (by halving)
+as they are traversed, so that a sequence of operations takes
+near-linear time. */
+
+static long find_tag (long * up, long i)
+{
+  while (up[i] != i)
+    i = up[i] = up[up[i]];
+  return i;
+}
+
+static void union_tag (long * up, const double * label, long i, long j)
+{
+  i = find_tag (up, i), j = find_tag (up, j);
+  if (label[i] < label[j])
+    up[j] = i;
+  else if (label[j] < label[i])
+    up[i] = j;
+}
+
+/**
+Each cell with a non-zero tag value gets a local index, stored in
+the *id* field. In parallel, the rank of the process is encoded in the
+identifier, so that the cells of neighboring processes can be
+recognised in the halos. Other cells (including parent cells on trees)
+have a negative identifier. */
+
+#if _MPI
+# define tag_id(n)     ((n)*npe() + pid())
+# define tag_index(id) (((long) (id))/npe())
+# define tag_local(id) (((long) (id)) % npe() == pid())
+#else
+# define tag_id(n)     (n)
+# define tag_index(id) ((long) (id))
+# define tag_local(id) true
+#endif
+
+static void restriction_tag_id (Point point, scalar id)
+{
+  id[] = -1;
+}
+
 /**
 The function just takes the scalar field *t* which holds the initial
 and final tag values. It returns the maximum neighborhood tag value
@@ -93,71 +148,130 @@ int tag (scalar t)
 #endif // !_MPI
 
   /**
-  To gather cells which belong to the same neighborhood, we repeat
-  multigrid iterations until none of the tag values changes. */
+  ## Union-find labelling
+
+  We give an identifier to each leaf cell which has a non-zero tag
+  and initialise the corresponding set with this single cell. */
+
+  scalar id[];
+  id.restriction = restriction_tag_id;
+#if TREE
+  id.refine = id.prolongation = refine_injection;
+#endif
+  long nt = 0;
+  foreach (serial)
+    id[] = t[] ? tag_id (nt++) : -1;
+  long * up = malloc (max (nt, 1)*sizeof (long));
+  double * label = malloc (max (nt, 1)*sizeof (double));
+  foreach (serial)
+    if (t[]) {
+      long i = tag_index (id[]);
+      up[i] = i, label[i] = t[];
+    }
+
+  /**
+  In a single pass over the leaves, we merge the set of each cell with
+  those of its (local) neighbors. On trees, the identifier of a coarser
+  neighbor is obtained by injection in the halo cells, and refined
+  neighbors are skipped: their (fine) children will merge with the
+  cell. */
   
-  bool changed;
-  do {
+  foreach (serial)
+    if (t[]) {
+      long i = tag_index (id[]);
+      foreach_neighbor(1)
+	if (id[] >= 0 && tag_local (id[]))
+	  union_tag (up, label, i, tag_index (id[]));
+    }
 
-    /**
-    We first do a restriction from the finest to the coarsest level of
-    the multigrid hierarchy, using the `restriction_tag()` function
-    above. */
-    
-    restriction ({t});
+  /**
+  Each cell now takes the (minimum) label of the root of its set. */
+  
+  foreach (serial)
+    if (t[])
+      t[] = label[find_tag (up, tag_index (id[]))];
+  free (up);
+  free (label);
 
-    /**
-    We then go from the coarsest to the finest level and update the
-    tag values. */
+#if _MPI
 
-    changed = false;
-    for (int l = 1; l <= grid->maxdepth; l++) {
+  /**
+  ## Merging across processes
 
-      /**
-      If the parent tag is non-zero, we set the child tag to the value
-      of its parent (i.e. to the minimum tag value of its
-      siblings). */
-      
-      foreach_level(l)
-	if (coarse(t))
-	  t[] = coarse(t);
-      boundary_level ({t}, l);
+  Neighborhoods which span several processes are merged using only the
+  equivalences between the labels of cells on either side of process
+  boundaries. */
 
-      /**
-      For cells which verify the threshold condition (i.e. for which
-      `t[] != 0`), we refine this initial guess by taking the minimum
-      (non-zero) tag value of its closest neighbors. We also track
-      whether this update changes any of the tag values. */
-      
-      foreach_level (l, reduction(||:changed))
-        if (t[]) {
-	  double min = t[];
-	  foreach_neighbor(1)
-	    if (t[] && t[] < min)
-	      min = t[];
-
-	  /**
-	  On trees, we need to take into account the minimum tag value
-	  of neighboring fine cells. */
-	  
-#if TREE
-	  foreach_dimension()
-	    for (int i = -1; i <= 2; i += 3)
-	      if (is_refined (neighbor((2*i - 1)/3)))
-		for (int j = 0; j <= 1; j++)
-		  for (int k = 0; k <= 1; k++)
-		    if (fine(t,i,j,k) && fine(t,i,j,k) < min)
-		      min = fine(t,i,j,k);
-#endif // TREE
-
-	  if (t[] != min) {
-	    changed = true;
-	    t[] = min;
-	  }
+  Array * pairs = array_new();
+  foreach (serial)
+    if (t[]) {
+      double l = t[];
+      foreach_neighbor(1)
+	if (id[] >= 0 && !tag_local (id[]) && t[] != l) {
+	  double pair[2] = {min (l, t[]), max (l, t[])};
+	  array_append (pairs, pair, sizeof (pair));
 	}
-      boundary_level ({t}, l);
     }
-  } while (changed);
+
+  /**
+  The same equivalence is usually found for many cells along the
+  boundary: duplicates are removed locally... */
+
+  double * pair = (double *) pairs->p;
+  long np = pairs->len/(2*sizeof(double)), nu = 0;
+  qsort (pair, np, 2*sizeof(double), compar_pair);
+  for (long i = 0; i < np; i++)
+    if (nu == 0 ||
+	pair[2*i] != pair[2*(nu - 1)] || pair[2*i + 1] != pair[2*(nu - 1) + 1]) {
+      pair[2*nu] = pair[2*i], pair[2*nu + 1] = pair[2*i + 1];
+      nu++;
+    }
+
+  /**
+  ... before being gathered on all processes... */
+
+  int len = 2*nu, counts[npe()], displs[npe()];
+  MPI_Allgather (&len, 1, MPI_INT, counts, 1, MPI_INT, MPI_COMM_WORLD);
+  int total = 0;
+  for (int i = 0; i < npe(); i++)
+    displs[i] = total, total += counts[i];
+  if (total > 0) {
+    double * all = malloc (total*sizeof(double));
+    MPI_Allgatherv (pairs->p, len, MPI_DOUBLE,
+		    all, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+
+    /**
+    ... where they are merged using a union-find structure indexed by
+    the (sorted, unique) labels. */
+
+    double * keys = malloc (total*sizeof(double));
+    memcpy (keys, all, total*sizeof(double));
+    qsort (keys, total, sizeof(double), compar_double);
+    Array * k = array_new();
+    for (int i = 0; i < total; i++)
+      if (i == 0 || keys[i] != keys[i - 1])
+	array_append (k, &keys[i], sizeof(double));
+    free (keys);
+    long nk = k->len/sizeof(double);
+    double * kl = (double *) k->p;
+    long * kup = malloc (nk*sizeof(long));
+    for (long i = 0; i < nk; i++)
+      kup[i] = i;
+    for (int i = 0; i < total; i += 2)
+      union_tag (kup, kl, lookup_tag (k, all[i]), lookup_tag (k, all[i + 1]));
+    free (all);
+
+    foreach (serial)
+      if (t[] > 0) {
+	long s = lookup_tag (k, t[]);
+	if (kl[s] == t[])
+	  t[] = kl[find_tag (kup, s)];
+      }
+    free (kup);
+    array_free (k);
+  }
+  array_free (pairs);
+#endif // _MPI
 
   /**
   ## Reducing the range of indices
@@ -38,9 +38,18 @@ event stability (i++)
 
   /**
   We first compute the minimum and maximum values of $\alpha/f_m =
-  1/\rho$, as well as $\Delta_{min}$. */
+  1/\rho$, as well as $\Delta_{min}$. With [two-phase
+  flows](two-phase-generic.h), they have already been computed with
+  the fluid properties. */
 
   double amin = HUGE, amax = -HUGE, dmin = HUGE;
+#if TWO_PHASE_STABILITY
+  if (two_phase_stability.dmin < HUGE)
+    amin = two_phase_stability.amin,
+      amax = two_phase_stability.amax,
+      dmin = two_phase_stability.dmin;
+  else
+#endif
   foreach_face (reduction(min:amin) reduction(max:amax) reduction(min:dmin))
     if (fm.x[] > 0.) {
       if (alpha.x[]/fm.x[] > amax) amax = alpha.x[]/fm.x[];
@@ -0,0 +1,71 @@
+/**
+# Cost-weighted load-balancing
+
+A bump is advected across an adaptive grid. The cells where the bump
+is larger than 0.1 are ten times more expensive than the others and
+load-balancing uses this [cost](/src/grid/balance.h#weighted-balancing)
+rather than the number of leaves. Cells are allowed to move directly
+to any process when the imbalance is larger than 20%.
+
+The results must not depend on the partitioning, and the cost of
+each process must be close to the average. */
+
+#include "advection.h"
+
+scalar f[], cost[];
+scalar * tracers = {f};
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  init_grid (64);
+  mpi.cost = cost;
+  mpi.imbalance = 1.2;
+  run();
+}
+
+#define bump(x,y) (exp(-100.*(sq(x + 0.2) + sq(y + .236338))))
+
+event init (i = 0)
+{
+  foreach()
+    f[] = bump(x,y);
+  foreach_face(x)
+    u.x[] = 1.;
+  foreach_face(y)
+    u.y[] = 0.5;
+}
+
+event logfile (i += 10)
+{
+  stats s = statsf (f);
+  fprintf (stderr, "%d %g %.6g %.6g %ld\n", i, t, s.sum, s.max, grid->tn);
+}
+
+event adapt (i++)
+{
+  foreach()
+    cost[] = f[] > 0.1 ? 10. : 1.;
+  adapt_wavelet ({f}, (double[]){1e-3}, 8, 4);
+}
+
+/**
+After load-balancing, the cost of each process must differ from the
+average cost by less than the cost of a few cells. */
+
+event balanced (i += 10)
+{
+  double c = 0.;
+  foreach (serial)
+    c += cost[];
+@if _MPI
+  double cmax = c, cmin = c;
+  mpi_all_reduce (cmax, MPI_DOUBLE, MPI_MAX);
+  mpi_all_reduce (cmin, MPI_DOUBLE, MPI_MIN);
+  if (cmax - cmin > 30.)
+    fprintf (stderr, "imbalance: %g %g\n", cmin, cmax);
+@endif
+}
+
+event end (t = 0.3);
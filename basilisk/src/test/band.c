@@ -0,0 +1,84 @@
+/**
+# Interface narrow band
+
+We advect two identical volume fraction fields in the time-reversed
+vortex of [reversed.c](), on an adaptive mesh. A [narrow band](/src/band.h)
+is only defined for the second field. The two fields must remain
+identical, the band must contain all the interfacial cells and the
+curvatures computed with and without the band must be identical. The
+same is checked after refining the interface by several levels. */
+
+#include "advection.h"
+#include "vof.h"
+#include "curvature.h"
+
+scalar f[], g[];
+scalar * interfaces = {f, g}, * tracers = NULL;
+const double T = 15.;
+
+#define circle(x,y) (sq(0.2) - (sq(x + 0.2) + sq(y + .236338)))
+
+int main()
+{
+  origin (-0.5, -0.5);
+  DT = .1[0,1];
+  init_grid (1 << 7);
+  narrow_band (g);
+  run();
+}
+
+event init (i = 0)
+{
+  fraction (f, circle(x,y));
+  foreach()
+    g[] = f[];
+}
+
+event velocity (i++) {
+  adapt_wavelet ({f}, (double[]){5e-3}, 7, list = {f, g});
+  vertex scalar psi[];
+  double a = 1.5, k = pi;
+  foreach_vertex()
+    psi[] = - a*sin(2.*pi*t/T)*sin(k*(x + 0.5))*sin(k*(y + 0.5))/pi;
+  trash ({u});
+  coord f = {-1.,1.};
+  foreach_face()
+    u.x[] = f.x*(psi[0,1] - psi[])/Delta;
+}
+
+int nsame = 0, ncovered = 0, ncurvature = 0, nsteps = 0;
+
+event check (i++) {
+  scalar kappaf[], kappag[], inband[];
+  curvature (f, kappaf);
+  curvature (g, kappag);
+  reset ({inband}, 0.);
+  foreach_band (g)
+    inband[] = 1.;
+  int differ = 0, missing = 0, kdiffer = 0, nb = 0, nl = 0;
+  foreach (reduction(+:differ) reduction(+:missing) reduction(+:kdiffer)
+	   reduction(+:nb) reduction(+:nl)) {
+    differ += f[] != g[];
+    missing += interfacial (point, g) && !inband[];
+    kdiffer += kappaf[] != kappag[];
+    nb += inband[], nl++;
+  }
+  if (i % 20 == 0)
+    printf ("%d %g %d %d %d %d %d\n", i, t, nl, nb, differ, missing, kdiffer);
+  nsame += !differ, ncovered += !missing, ncurvature += !kdiffer, nsteps++;
+}
+
+event end (t = T/2.) {
+  fprintf (stderr, "f = g: %d\nband: %d\ncurvature: %d\n",
+	   nsame == nsteps, ncovered == nsteps, ncurvature == nsteps);
+
+  /**
+  The interfacial cells are then refined by two levels at once: the
+  band must be made of the new leaves. */
+
+  refine (level < 9 && f[] > 0. && f[] < 1.);
+  nsame = ncovered = ncurvature = nsteps = 0;
+  event ("check");
+  fprintf (stderr, "refine: band: %d curvature: %d\n",
+	   ncovered == nsteps, ncurvature == nsteps);
+}
@@ -0,0 +1,51 @@
+/**
+# Per-bubble statistics
+
+Two circular bubbles in a liquid, one of them cut by the bottom
+boundary, each moving with its own velocity. The statistics computed
+by [bubble_stats()](/src/bubble-stats.h) are compared with their exact
+values. */
+
+#include "fractions.h"
+#include "bubble-stats.h"
+
+#define R1 0.2
+#define R2 0.15
+
+int main()
+{
+  origin (-0.5, 0);
+  init_grid (16);
+  scalar f[];
+  vector u[];
+  f.refine = f.prolongation = fraction_refine;
+  do
+    fraction (f, min (sqrt (sq(x + 0.2) + sq(y - 0.5)) - R1,
+		      sqrt (sq(x - 0.25) + sq(y - 0.05)) - R2));
+  while (adapt_wavelet ({f}, (double[]){1e-3}, 8).nf);
+  foreach() {
+    u.x[] = x < 0. ? 1. : -2.;
+    u.y[] = x < 0. ? 0.5 : 3.;
+  }
+
+  Bubble * b = NULL;
+  int n = bubble_stats (f, u, &b);
+  fprintf (stderr, "bubbles: %d\n", n);
+  for (int j = 0; j < n; j++)
+    fprintf (stderr, "%.3f %.3f %.3f %.2f %.2f %.3f %.3f\n",
+	     b[j].volume, b[j].centroid.x, b[j].centroid.y,
+	     b[j].velocity.x, b[j].velocity.y, b[j].area, b[j].contact);
+
+  /**
+  The exact values are the area of the disc (resp. of the disc minus
+  its cap below the boundary), the perimeter of the interface (within
+  the domain) and the half-chord of the second bubble on the bottom
+  boundary. */
+  
+  double theta = acos (0.05/R2);
+  fprintf (stderr, "exact: %.3f %.3f %.3f %.3f %.3f\n",
+	   pi*sq(R1), 2.*pi*R1,
+	   sq(R2)*(pi - theta) + 0.05*R2*sin(theta),
+	   2.*R2*(pi - theta), R2*sin(theta));
+  free (b);
+}
@@ -0,0 +1,158 @@
+/**
+# Incremental updates of tree caches
+
+A bump is advected across an adaptive grid, periodic in one
+direction. After each adaptation, the caches updated
+[incrementally](/src/grid/tree.h#incremental-cache-updates) (this
+test is compiled with `-DTREE_INCREMENTAL_CACHE=1`) are
+compared with those obtained by a full rebuild: leaves and faces must
+be identical (including their order), vertices and per-level indices
+must be the same sets.
+
+At the end, we time the incremental update after refining a growing
+number of cells, and compare it with the time of a full rebuild. */
+
+#include "advection.h"
+
+scalar f[];
+scalar * tracers = {f};
+
+static int compare_index (const void * a, const void * b)
+{
+  const Index * p = a, * q = b;
+  if (p->level != q->level) return p->level - q->level;
+  if (p->i != q->i) return p->i - q->i;
+#if dimension >= 2
+  if (p->j != q->j) return p->j - q->j;
+#endif
+#if dimension >= 3
+  if (p->k != q->k) return p->k - q->k;
+#endif
+  return p->flags - q->flags;
+}
+
+static Cache cache_copy (const Cache * c, bool sort)
+{
+  Cache a = {NULL, c->n, c->n};
+  a.p = malloc ((c->n + 1)*sizeof (Index));
+  memcpy (a.p, c->p, c->n*sizeof (Index));
+  if (sort)
+    qsort (a.p, a.n, sizeof (Index), compare_index);
+  return a;
+}
+
+/* concatenates the per-level caches, with the level and the kind of
+   cache as flags */
+static Cache cache_levels (void)
+{
+  Cache a = {NULL, 0, 0};
+  CacheLevel * c[] = {tree->active, tree->prolongation,
+		      tree->boundary, tree->restriction};
+  for (int l = 0; l <= depth(); l++)
+    for (int kind = 0; kind < 4; kind++)
+      for (IndexLevel * p = c[kind][l].p; p < c[kind][l].p + c[kind][l].n;
+	   p++) {
+	Point q = {0};
+	q.i = p->i;
+#if dimension >= 2
+	q.j = p->j;
+#endif
+#if dimension >= 3
+	q.k = p->k;
+#endif
+	q.level = l;
+	cache_append (&a, q, kind);
+      }
+  qsort (a.p, a.n, sizeof (Index), compare_index);
+  return a;
+}
+
+static bool cache_equal (Cache a, Cache b)
+{
+  bool equal = a.n == b.n && !memcmp (a.p, b.p, a.n*sizeof (Index));
+  free (a.p), free (b.p);
+  return equal;
+}
+
+/* returns the number of caches which differ from a full rebuild */
+int check_caches()
+{
+  update_cache();
+  Cache leaves = cache_copy (&tree->leaves, false);
+  Cache faces = cache_copy (&tree->faces, false);
+  Cache vertices = cache_copy (&tree->vertices, true);
+  Cache levels = cache_levels();
+  tree->dirty = true;
+  update_cache();
+  return (!cache_equal (leaves, cache_copy (&tree->leaves, false)) +
+	  !cache_equal (faces, cache_copy (&tree->faces, false)) +
+	  !cache_equal (vertices, cache_copy (&tree->vertices, true)) +
+	  !cache_equal (levels, cache_levels()));
+}
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  periodic (right);
+  init_grid (64);
+  run();
+}
+
+#define bump(x,y) (exp(-100.*(sq(x + 0.2) + sq(y + .236338))))
+
+event init (i = 0)
+{
+  foreach()
+    f[] = bump(x,y);
+  coord c = {1., 0.5};
+  foreach_face()
+    u.x[] = c.x;
+}
+
+event logfile (i += 10)
+{
+  stats s = statsf (f);
+  fprintf (stderr, "%d %g %.6g %.6g %ld\n", i, t, s.sum, s.max, grid->tn);
+}
+
+int errors = 0;
+
+event adapt (i++)
+{
+  adapt_wavelet ({f}, (double[]){1e-3}, 9, 4);
+  errors += check_caches();
+}
+
+/**
+The grid is first refined uniformly to level 8. The number of
+modified cells is then controlled by the radius of the disk refined
+to level 9. The timings are written on standard output. */
+
+event end (t = 0.5)
+{
+  fprintf (stderr, "errors %d\n", errors);
+  refine (level < 8);
+  unrefine (level > 8);
+  update_cache();
+  for (double r = 0.004; r < 0.5; r *= 2.) {
+    int refined = 0;
+    foreach_leaf()
+      if (level < 9 && sq(x) + sq(y) < sq(r)) {
+	refine_cell (point, NULL, 0, NULL);
+	refined++;
+      }
+    timer t = timer_start();
+    update_cache();
+    double incremental = timer_elapsed (t);
+    t = timer_start();
+    tree->dirty = true;
+    update_cache();
+    double full = timer_elapsed (t);
+    printf ("%d %ld %g %g\n", refined, grid->tn, incremental, full);
+    errors += check_caches();
+    unrefine (level > 8);
+    errors += check_caches();
+  }
+  fprintf (stderr, "errors %d\n", errors);
+}
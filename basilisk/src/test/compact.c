@@ -0,0 +1,57 @@
+/**
+# Compaction of tree grids
+
+A bump is advected across a periodic, adaptive grid. The tree is
+[compacted](/src/grid/tree.h#compaction) after each adaptation,
+which must not change the results. At the end, we check that
+compaction reduces the average distance in memory between
+consecutive leaves. */
+
+#include "advection.h"
+
+scalar f[];
+scalar * tracers = {f};
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  periodic (right);
+  periodic (top);
+  tree_compaction.every = 1;
+  tree_compaction.stride = 0.;
+  init_grid (64);
+  run();
+}
+
+#define bump(x,y) (exp(-100.*(sq(x + 0.2) + sq(y + .236338))))
+
+event init (i = 0)
+{
+  foreach()
+    f[] = bump(x,y);
+  coord c = {1., 0.5};
+  foreach_face()
+    u.x[] = c.x;
+}
+
+event logfile (i += 10)
+{
+  stats s = statsf (f);
+  fprintf (stderr, "%d %g %.6g %.6g %ld\n", i, t, s.sum, s.max, grid->tn);
+}
+
+event adapt (i++)
+{
+  adapt_wavelet ({f}, (double[]){1e-3}, 8, 4);
+}
+
+event end (t = 1)
+{
+  tree_compaction.every = 0;
+  refine (level < 7 && sq(x) + sq(y) < sq(0.1));
+  double s0 = leaf_stride();
+  tree_compact();
+  double s1 = leaf_stride();
+  fprintf (stderr, "stride %d\n", s1 < s0);
+}
@@ -0,0 +1,52 @@
+/**
+# Asynchronous snapshots
+
+Several [asynchronous snapshots](/src/dump-async.h) are written,
+including repeatedly to the same file. The field is modified after
+each call: the snapshots must contain the values at the time of the
+call. */
+
+#include "utils.h"
+#include "dump-async.h"
+
+scalar s[];
+
+void init (int k)
+{
+  foreach()
+    s[] = k + x*y;
+}
+
+int check (const char * name, int k)
+{
+  assert (restore (file = name, list = {s}));
+  int errors = 0;
+  foreach (reduction(+:errors))
+    if (s[] != k + x*y)
+      errors++;
+  return errors;
+}
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  init_grid (16);
+  refine (level < 8 && sq(x) + sq(y) < sq(0.1));
+  for (int k = 0; k < 3; k++) {
+    init (k);
+    char name[80];
+    sprintf (name, "async-%d", k);
+    dump_async (name, {s});
+    dump_async ("restart", {s}, compress = true);
+  }
+  init (10);
+  dump_async_wait();
+
+  for (int k = 0; k < 3; k++) {
+    char name[80];
+    sprintf (name, "async-%d", k);
+    fprintf (stderr, "%s: %d\n", name, check (name, k));
+  }
+  fprintf (stderr, "restart: %d\n", check ("restart", 2));
+}
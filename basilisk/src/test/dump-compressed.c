@@ -0,0 +1,63 @@
+/**
+# Compressed snapshots
+
+A field with sharp variations (*f*) is stored losslessly, while
+smooth fields (*u*) are stored with an error bound, in a [compressed
+dump](/src/output.h#compressed-snapshots). The file is restored and
+the fields compared with their original values. */
+
+#include "utils.h"
+
+scalar f[];
+vector u[];
+
+void fields()
+{
+  foreach() {
+    f[] = sq(x) + sq(y) < sq(0.3);
+    u.x[] = sin(2.*pi*x)*cos(2.*pi*y);
+    u.y[] = - cos(2.*pi*x)*sin(2.*pi*y);
+  }
+}
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  init_grid (16);
+  refine (level < 9 && fabs (sq(x) + sq(y) - sq(0.3)) < 0.01);
+  fields();
+  foreach_dimension()
+    u.x.dump_tolerance = 1e-6;
+  dump (file = "uncompressed.dump", list = {f, u});
+  dump (file = "compressed.dump", list = {f, u}, compress = true);
+
+  if (pid() == 0) {
+    FILE * fp = fopen ("uncompressed.dump", "r");
+    fseek (fp, 0, SEEK_END);
+    long size = ftell (fp);
+    fclose (fp);
+    fp = fopen ("compressed.dump", "r");
+    fseek (fp, 0, SEEK_END);
+    fprintf (stderr, "compressed < 25%%: %d\n", ftell (fp) < 0.25*size);
+    fclose (fp);
+  }
+
+  long n = grid->tn;
+  init_grid (1);
+  assert (restore (file = "compressed.dump", list = {f, u}));
+  fprintf (stderr, "cells: %d\n", grid->tn == n);
+
+  scalar f1[], u1[];
+  foreach() {
+    f1[] = f[];
+    u1[] = u.x[];
+  }
+  fields();
+  double ef = 0., eu = 0.;
+  foreach (reduction(max:ef) reduction(max:eu)) {
+    if (fabs (f1[] - f[]) > ef) ef = fabs (f1[] - f[]);
+    if (fabs (u1[] - u.x[]) > eu) eu = fabs (u1[] - u.x[]);
+  }
+  fprintf (stderr, "f: %g\nu.x: %d\n", ef, eu <= 1e-6);
+}
@@ -0,0 +1,78 @@
+/**
+# Multicolour Gauss-Seidel relaxation in 3D
+
+We check that the coloured traversal of an adaptive octree visits each
+cell of `foreach_level_or_leaf()` exactly once, that neighbouring cells
+have different colours (face neighbours for red/black colouring, all
+neighbours for eight colours), and that the Poisson and viscous
+solvers converge using Gauss-Seidel relaxation. */
+
+#define GAUSS_SEIDEL 1
+#include "grid/octree.h"
+#include "poisson.h"
+#include "viscosity.h"
+
+scalar a[], b[], rho[];
+face vector mu[];
+
+static bool check_colours (int nc)
+{
+  int bad = 0;
+  scalar nv[];
+  for (int l = 0; l <= depth(); l++) {
+    foreach_level_or_leaf (l)
+      nv[] = 0;
+    for (int c = 0; c < nc; c++)
+      foreach_level_or_leaf_colour (l, c, nc) {
+	assert (cell_colour (nc) == c);
+	nv[]++;
+      }
+    foreach_level_or_leaf (l, reduction(+:bad)) {
+      bad += nv[] != 1;
+      int colour = cell_colour (nc);
+      foreach_neighbor (1)
+	if (nc == 2) {
+	  if (abs(ig) + abs(jg) + abs(kg) == 1)
+	    bad += cell_colour (nc) == colour;
+	}
+	else if (ig || jg || kg)
+	  bad += cell_colour (nc) == colour;
+    }
+  }
+  return !bad;
+}
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5, -0.5);
+  init_grid (8);
+  refine (fabs (sqrt (sq(x - 0.1) + sq(y) + sq(z)) - 0.2) < 0.05 &&
+	  level < 6);
+  fprintf (stderr, "colours: %d %d\n", check_colours (2), check_colours (8));
+
+  foreach()
+    b[] = sin(2.*pi*x)*cos(pi*y)*cos(pi*z);
+  double mean = 0., volume = 0.;
+  foreach (reduction(+:mean) reduction(+:volume))
+    mean += dv()*b[], volume += dv();
+  foreach() {
+    b[] -= mean/volume;
+    a[] = 0.;
+  }
+  mgstats mg = poisson (a, b, tolerance = 1e-6);
+  printf ("poisson: %d %d %g\n", mg.i, mg.nrelax, mg.resa);
+  fprintf (stderr, "poisson: %d\n", mg.resa <= 1e-6);
+
+  vector u[];
+  foreach() {
+    rho[] = 1.;
+    foreach_dimension()
+      u.x[] = sin(2.*pi*x)*cos(pi*y);
+  }
+  foreach_face()
+    mu.x[] = 1e-2;
+  mg = viscosity (u, mu, rho, 1e-1);
+  printf ("viscosity: %d %d %g\n", mg.i, mg.nrelax, mg.resa);
+  fprintf (stderr, "viscosity: %d\n", mg.resa <= TOLERANCE);
+}
@@ -0,0 +1,78 @@
+/**
+# Incremental height functions
+
+We advect two identical volume fraction fields in the time-reversed
+vortex of [reversed.c](), on an adaptive mesh. The height function
+is [updated incrementally](/src/heights.h#incremental_heights) only
+for the second field. The heights (on all levels) and the curvatures
+computed for both fields must remain identical. */
+
+#include "advection.h"
+#include "vof.h"
+#include "curvature.h"
+
+scalar f[], g[];
+scalar * interfaces = {f, g}, * tracers = NULL;
+const double T = 15.;
+
+#define circle(x,y) (sq(0.2) - (sq(x + 0.2) + sq(y + .236338)))
+
+int main()
+{
+  origin (-0.5, -0.5);
+  DT = .1[0,1];
+  init_grid (1 << 7);
+  incremental_heights (g);
+  run();
+}
+
+event init (i = 0)
+{
+  fraction (f, circle(x,y));
+  foreach()
+    g[] = f[];
+}
+
+event velocity (i++) {
+  adapt_wavelet ({f}, (double[]){5e-3}, 7, list = {f, g});
+  vertex scalar psi[];
+  double a = 1.5, k = pi;
+  foreach_vertex()
+    psi[] = - a*sin(2.*pi*t/T)*sin(k*(x + 0.5))*sin(k*(y + 0.5))/pi;
+  trash ({u});
+  coord f = {-1.,1.};
+  foreach_face()
+    u.x[] = f.x*(psi[0,1] - psi[])/Delta;
+}
+
+int nheights = 0, ncurvature = 0, nsteps = 0;
+
+event check (i++) {
+  vector hf[];
+  heights (f, hf);
+  heights (g, g.height);
+  vector hg = g.height;
+  int differ = 0;
+  foreach_cell() {
+    if (is_boundary(cell))
+      continue;
+    foreach_dimension()
+      differ += hf.x[] != hg.x[];
+    if (is_leaf(cell))
+      continue;
+  }
+  scalar kappaf[], kappag[];
+  curvature (f, kappaf);
+  curvature (g, kappag);
+  int kdiffer = 0, nl = 0;
+  foreach (reduction(+:kdiffer) reduction(+:nl))
+    kdiffer += kappaf[] != kappag[], nl++;
+  if (i % 20 == 0)
+    printf ("%d %g %d %d %d\n", i, t, nl, differ, kdiffer);
+  nheights += !differ, ncurvature += !kdiffer, nsteps++;
+}
+
+event end (t = T/2.) {
+  fprintf (stderr, "heights: %d\ncurvature: %d\n",
+	   nheights == nsteps, ncurvature == nsteps);
+}
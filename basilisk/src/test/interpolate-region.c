@@ -0,0 +1,95 @@
+/**
+# Bulk interpolation on regular grids
+
+The values given by
+[interpolate_region()](/src/grid/cartesian-common.h#bulk-interpolation-on-regular-grids)
+on a regular grid of points and on planes are compared with those of
+*interpolate()* on an adaptive octree. The results must be identical,
+including for points on cell faces. */
+
+#include "grid/octree.h"
+#include "utils.h"
+
+scalar a[], b[];
+
+/**
+The points are *p0 + i*dp*, computed as in the slice extractors of
+the postProcess directory. */
+
+void check (coord p0, coord dp, coord n)
+{
+  int ni = n.x, nj = n.y, nk = n.z;
+  double px[ni], py[nj], pz[nk], v[ni*nj*nk*2];
+  for (int i = 0; i < ni; i++)
+    px[i] = dp.x*i + p0.x;
+  for (int j = 0; j < nj; j++)
+    py[j] = dp.y*j + p0.y;
+  for (int k = 0; k < nk; k++)
+    pz[k] = dp.z*k + p0.z;
+  for (int linear = 0; linear <= 1; linear++) {
+    interpolate_region ({a, b}, n, px, py, pz, v, linear);
+    double emax = 0.;
+    int nodatas = 0;
+    for (int i = 0; i < ni; i++)
+      for (int j = 0; j < nj; j++)
+	for (int k = 0; k < nk; k++) {
+	  double * w = v + ((i*nj + j)*nk + k)*2;
+	  double va = interpolate (a, px[i], py[j], pz[k], linear);
+	  double vb = interpolate (b, px[i], py[j], pz[k], linear);
+	  if (va == nodata) {
+	    nodatas++;
+	    assert (w[0] == nodata && w[1] == nodata);
+	  }
+	  else {
+	    assert (w[0] != nodata);
+	    double e = max (fabs (w[0] - va), fabs (w[1] - vb));
+	    if (e > emax) emax = e;
+	  }
+	}
+    fprintf (stderr, "linear: %d points: %d nodata: %d error: %g\n",
+	     linear, ni*nj*nk, nodatas, emax);
+  }
+}
+
+void setup (double L, coord o)
+{
+  size (L);
+  origin (o.x, o.y, o.z);
+  init_grid (8);
+  refine (level < 6 &&
+	  sq(x - o.x - 0.6*L) + sq(y - o.y - 0.5*L) + sq(z - o.z - 0.4*L) <
+	  sq(0.25*L));
+  foreach() {
+    a[] = cos(2.*pi*x/L)*sin(2.*pi*y/L)*z;
+    b[] = x + 2.*y*y - z;
+  }
+}
+
+int main()
+{
+  setup (1., (coord){-0.5, -0.5, -0.5});
+
+  /**
+  A regular grid of points which extends beyond the domain. */
+
+  check ((coord){-0.3, -0.6, -0.2}, (coord){0.7/13., 0.9/17., 0.65/11.},
+	 (coord){13, 17, 11});
+
+  /**
+  A plane crossing the refined region. */
+
+  check ((coord){0.1, -0.5 + 1./128., -0.5 + 1./64.},
+	 (coord){0, 1./64., 1./32.}, (coord){1, 64, 32});
+
+  /**
+  On a domain which is not aligned with powers of two, points on cell
+  faces and on the boundaries of the domain, either exactly or up to
+  round-off errors, must be assigned to the same cells as with
+  *locate()*. */
+
+  setup (4., (coord){0., -1.025, -2.});
+  check ((coord){1., -1.025, -2.}, (coord){0, 1./32., 1./32.},
+	 (coord){1, 129, 129});
+  check ((coord){0., -1.025 + 1./16., 0.}, (coord){0.025, 0.025, 0},
+	 (coord){161, 161, 1});
+}
@@ -0,0 +1,82 @@
+/**
+# Multigrid cycle schedules
+
+We solve a variable-coefficient Poisson problem with a density ratio
+of 1000 (a light bubble in a heavy fluid) on an adaptive mesh, using
+V-, F- and W-cycles. All schedules must converge to the same solution
+and the F- and W-cycles must use fewer cycles than the V-cycle. We
+also check that the per-level statistics are collected. */
+
+#include "poisson.h"
+
+#define rho(f) (clamp(f,0.,1.)*(1. - 1e-3) + 1e-3)
+
+scalar f[], b[];
+face vector alpha[];
+
+static mgstats solve (scalar s, int cycle, const char * name)
+{
+  mg_schedule.cycle = cycle;
+  foreach()
+    s[] = 0.;
+  mgstats mg = poisson (s, b, alpha, tolerance = 1e-6);
+  printf ("%s: %d %d %g\n", name, mg.i, mg.nrelax, mg.resa);
+  assert (mg.resa <= 1e-6);
+  return mg;
+}
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  init_grid (32);
+  refine (fabs (sqrt (sq(x - 0.1) + sq(y)) - 0.2) < 0.05 && level < 8);
+  foreach()
+    f[] = clamp (0.5 + (sqrt (sq(x - 0.1) + sq(y)) - 0.2)/Delta, 0., 1.);
+  foreach_face() {
+    double ff = (f[] + f[-1])/2.;
+    alpha.x[] = 1./rho(ff);
+  }
+  double mean = 0., area = 0.;
+  foreach (reduction(+:mean) reduction(+:area))
+    mean += dv()*sin(2.*pi*x)*cos(pi*y)*rho(f[]), area += dv();
+  foreach()
+    b[] = sin(2.*pi*x)*cos(pi*y)*rho(f[]) - mean/area;
+
+  scalar a[], c[], d[];
+  mgstats v = solve (a, MG_VCYCLE, "V-cycle");
+  mgstats fc = solve (c, MG_FCYCLE, "F-cycle");
+  mg_schedule.stats = true;
+  mgstats w = solve (d, MG_WCYCLE, "W-cycle");
+  fprintf (stderr, "F-cycle: %d\nW-cycle: %d\n", fc.i < v.i, w.i < v.i);
+
+  /**
+  The solutions are defined up to a constant. */
+
+  double ma = 0., mc = 0., md = 0.;
+  foreach (reduction(+:ma) reduction(+:mc) reduction(+:md))
+    ma += dv()*a[], mc += dv()*c[], md += dv()*d[];
+  double ec = 0., ed = 0., amax = 0.;
+  foreach (reduction(max:ec) reduction(max:ed) reduction(max:amax)) {
+    ec = max(ec, fabs (c[] - mc/area - a[] + ma/area));
+    ed = max(ed, fabs (d[] - md/area - a[] + ma/area));
+    amax = max(amax, fabs (a[] - ma/area));
+  }
+  printf ("%g %g %g\n", ec, ed, amax);
+  fprintf (stderr, "error F-cycle: %d\nerror W-cycle: %d\n",
+	   ec < 1e-3*amax, ed < 1e-3*amax);
+
+  /**
+  Statistics are only collected for the W-cycle. Each level is visited
+  once per cycle (the coarse corrections are not counted). */
+
+  bool visited = true, reduced = true;
+  for (int l = 1; l <= depth(); l++) {
+    mglevel * s = &w.level[l];
+    printf ("level %d: %d %d %g %g %g\n", l, s->n, s->relax,
+	    s->resb/s->n, s->resa/s->n, s->t/s->n);
+    visited &= s->n == w.i && s->relax >= s->n;
+    reduced &= s->resa < s->resb;
+  }
+  fprintf (stderr, "stats: %d %d %d\n", v.level[1].n == 0, visited, reduced);
+}
@@ -0,0 +1,136 @@
+/**
+# Mixed precision storage
+
+When compiled with `-DMIXED_PRECISION=1`, the fields declared `float`
+are [stored in single precision](/src/grid/tree.h#mixed-precision-storage)
+while the other fields are still stored in double precision. The
+single precision fields must hold the values of the corresponding
+double precision fields rounded to single precision, including after
+assignments, increments, boundary conditions (and MPI halo exchanges,
+see [mpi-mixed-precision.c]()), adaptation and dump/restore. */
+
+#include "grid/quadtree.h"
+#include "utils.h"
+
+float scalar a[];
+float vector u[];
+scalar b[];
+vector v[];
+
+/**
+The precision of the arguments of this function is only known at run
+time, while that of the fields above is known at compile time. */
+
+double error (scalar a, scalar b)
+{
+  double e = 0.;
+  foreach (reduction(max:e))
+    for (int i = -1; i <= 1; i++)
+      for (int j = -1; j <= 1; j++)
+	if (fabs (a[i,j] - b[i,j]) > e)
+	  e = fabs (a[i,j] - b[i,j]);
+  return e;
+}
+
+int count_nodata (scalar s)
+{
+  int n = 0;
+  foreach (reduction(+:n))
+    if (s[] == nodata)
+      n++;
+  return n;
+}
+
+int main()
+{
+  init_grid (16);
+  refine (level < 7 && sq(x - 0.6) + sq(y - 0.4) < sq(0.2));
+
+  /**
+  The single and double precision fields are set to the same values,
+  using assignments and compound assignments. */
+
+  foreach() {
+    a[] = b[] = x*y*y/3.;
+    a[] += 1.;
+    b[] += 1.;
+    foreach_dimension() {
+      u.x[] = v.x[] = x/3.;
+      u.x[] += 1.;
+      v.x[] += 1.;
+    }
+  }
+
+  /**
+  The values must be equal to the double precision values rounded to
+  single precision and the values of the neighbours (boundary
+  conditions, restriction and prolongation) must be close. */
+
+  double e = 0.;
+  foreach (reduction(max:e))
+    if (a[] != (float) b[] || u.x[] != (float) v.x[] || u.y[] != (float) v.y[])
+      e = 1.;
+  fprintf (stderr, "rounding: %g\n", e);
+  fprintf (stderr, "a: %.3g u.x: %.3g u.y: %.3g\n",
+	   error (a, b), error (u.x, v.x), error (u.y, v.y));
+
+  /**
+  The fields are coarsened and refined again. */
+
+  unrefine (level > 5);
+  refine (level < 7 && sq(x - 0.4) + sq(y - 0.6) < sq(0.2));
+  fprintf (stderr, "adapt a: %.3g u.x: %.3g\n",
+	   error (a, b), error (u.x, v.x));
+
+  /**
+  Dump/restore preserves the single precision values exactly. */
+
+  dump (file = "dump");
+  foreach()
+    a[] = 0.;
+  restore (file = "dump");
+  fprintf (stderr, "restore a: %.3g\n", error (a, b));
+
+  /**
+  The local fields can also be declared `float`. */
+
+  float scalar d[];
+  foreach()
+    d[] = b[]*b[];
+  e = 0.;
+  foreach (reduction(max:e))
+    if (d[] != (float) (b[]*b[]))
+      e = 1.;
+  fprintf (stderr, "local: %g\n", e);
+
+  /**
+  The `nodata` values stored in single precision are read back
+  exactly. */
+
+  foreach()
+    a[] = nodata;
+  int n = 0;
+  foreach (reduction(+:n))
+    if (a[] == nodata)
+      n++;
+  fprintf (stderr, "nodata: %d %d\n", n, count_nodata (a));
+
+  /**
+  The `undefined` values (used to trash fields) can also be stored in
+  single precision, also when floating-point exceptions are trapped,
+  and are read back as `undefined` (this is checked bit by bit since
+  any comparison with a signaling NaN would raise an exception). */
+
+  reset ({a}, undefined);
+  foreach()
+    u.x[] = undefined;
+  n = 0;
+  double nan = undefined;
+  foreach (reduction(+:n)) {
+    double va = a[], vu = u.x[];
+    if (!memcmp (&va, &nan, sizeof (double)) &&
+	!memcmp (&vu, &nan, sizeof (double)))
+      n++;
+  }
+  fprintf (stderr, "undefined: %d\n", n == grid->tn);
+}
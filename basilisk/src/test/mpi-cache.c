@@ -0,0 +1,140 @@
+/**
+# Incremental updates of tree caches in parallel
+
+As in [cache.c](cache.c), a bump is advected across an adaptive
+grid and, after each adaptation, the caches updated
+[incrementally](/src/grid/tree.h#incremental-cache-updates) are
+compared with those obtained by a full rebuild, on each process.
+Adaptation modifies the halos of the neighbouring processes and the
+grid is periodically rebalanced (this test is compiled with
+`-DTREE_INCREMENTAL_CACHE=1` and run on several processes). */
+
+#include "advection.h"
+
+scalar f[];
+scalar * tracers = {f};
+
+static int compare_index (const void * a, const void * b)
+{
+  const Index * p = a, * q = b;
+  if (p->level != q->level) return p->level - q->level;
+  if (p->i != q->i) return p->i - q->i;
+#if dimension >= 2
+  if (p->j != q->j) return p->j - q->j;
+#endif
+#if dimension >= 3
+  if (p->k != q->k) return p->k - q->k;
+#endif
+  return p->flags - q->flags;
+}
+
+static Cache cache_copy (const Cache * c, bool sort)
+{
+  Cache a = {NULL, c->n, c->n};
+  a.p = malloc ((c->n + 1)*sizeof (Index));
+  memcpy (a.p, c->p, c->n*sizeof (Index));
+  if (sort)
+    qsort (a.p, a.n, sizeof (Index), compare_index);
+  return a;
+}
+
+/* concatenates the per-level caches, with the level and the kind of
+   cache as flags */
+static Cache cache_levels (void)
+{
+  Cache a = {NULL, 0, 0};
+  CacheLevel * c[] = {tree->active, tree->prolongation,
+		      tree->boundary, tree->restriction};
+  for (int l = 0; l <= depth(); l++)
+    for (int kind = 0; kind < 4; kind++)
+      for (IndexLevel * p = c[kind][l].p; p < c[kind][l].p + c[kind][l].n;
+	   p++) {
+	Point q = {0};
+	q.i = p->i;
+#if dimension >= 2
+	q.j = p->j;
+#endif
+#if dimension >= 3
+	q.k = p->k;
+#endif
+	q.level = l;
+	cache_append (&a, q, kind);
+      }
+  qsort (a.p, a.n, sizeof (Index), compare_index);
+  return a;
+}
+
+static bool cache_equal (Cache a, Cache b)
+{
+  bool equal = a.n == b.n && !memcmp (a.p, b.p, a.n*sizeof (Index));
+  free (a.p), free (b.p);
+  return equal;
+}
+
+/* returns the number of caches which differ from a full rebuild */
+int check_caches()
+{
+  update_cache();
+  Cache leaves = cache_copy (&tree->leaves, false);
+  Cache faces = cache_copy (&tree->faces, false);
+  Cache vertices = cache_copy (&tree->vertices, true);
+  Cache levels = cache_levels();
+  tree->dirty = true;
+  update_cache();
+  return (!cache_equal (leaves, cache_copy (&tree->leaves, false)) +
+	  !cache_equal (faces, cache_copy (&tree->faces, false)) +
+	  !cache_equal (vertices, cache_copy (&tree->vertices, true)) +
+	  !cache_equal (levels, cache_levels()));
+}
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  periodic (right);
+  init_grid (64);
+  run();
+}
+
+#define bump(x,y) (exp(-100.*(sq(x + 0.2) + sq(y + .236338))))
+
+event init (i = 0)
+{
+  foreach()
+    f[] = bump(x,y);
+  foreach_face(x)
+    u.x[] = 1.;
+  foreach_face(y)
+    u.y[] = 0.5;
+}
+
+/**
+The partition of the grid depends on the timings of the processes,
+the statistics are written on standard output, which is not compared
+with the reference. */
+
+event logfile (i += 10)
+{
+  stats s = statsf (f);
+  printf ("%d %g %.6g %.6g %ld\n", i, t, s.sum, s.max, grid->tn);
+}
+
+int errors = 0, incremental = 0;
+
+event adapt (i++)
+{
+  adapt_wavelet ({f}, (double[]){1e-3}, 9, 4);
+
+  /**
+  We also count the updates which are incremental on this process. */
+  
+  incremental += !tree->dirty;
+  errors += check_caches();
+}
+
+event end (t = 0.5)
+{
+  mpi_all_reduce (errors, MPI_INT, MPI_SUM);
+  mpi_all_reduce (incremental, MPI_INT, MPI_MIN);
+  fprintf (stderr, "errors %d incremental %d\n", errors, incremental > 0);
+}
@@ -0,0 +1,130 @@
+/**
+# Split-phase parallel boundary conditions
+
+A five-point Laplacian is computed using [split-phase boundary
+conditions](/src/grid/cartesian-common.h#split-phase-boundary-conditions)
+i.e. interior cells are computed while the halos are exchanged, and
+border cells once the exchange is complete. The result must be
+identical to that obtained with (blocking) boundary conditions, on all
+levels and after the halos have been rebuilt by adaptation (which
+reuses the communication buffers).
+
+The multigrid relaxations of the Poisson solver are then
+[overlapped](/src/poisson.h#overlapping-communications-and-relaxations)
+with the exchanges. */
+
+#include "poisson.h"
+
+scalar a[], b[], c[];
+
+#define laplacian(a) ((a[1] + a[-1] + a[0,1] + a[0,-1] - 4.*a[])/sq(Delta))
+
+static void init (int l)
+{
+  foreach_level_or_leaf (l)
+    a[] = cos(pi*x)*cos(pi*y) + x*y;
+}
+
+/* resets all the values, including those of the halos */
+static void reset_halos()
+{
+  foreach_cell()
+    a[] = nodata;
+}
+
+/* returns the maximum difference between the blocking and split-phase
+   Laplacians on level l */
+double check (int l)
+{
+  init (l);
+  boundary_level ({a}, l);
+  foreach_level_or_leaf (l)
+    b[] = laplacian(a);
+
+  reset_halos();
+  init (l);
+  a.dirty = false; // we do not want automatic boundary conditions
+  boundary_start ({a}, l);
+  foreach_level_or_leaf (l)
+    if (!is_border(cell))
+      c[] = laplacian(a);
+  boundary_finish();
+  foreach_level_or_leaf (l)
+    if (is_border(cell))
+      c[] = laplacian(a);
+
+  double max = 0.;
+  foreach_level_or_leaf (l, reduction(max:max))
+    if (fabs (b[] - c[]) > max)
+      max = fabs (b[] - c[]);
+  return max;
+}
+
+void check_all (const char * name)
+{
+  double max = 0.;
+  for (int l = 0; l <= depth(); l++) {
+    double e = check (l);
+    if (e > max) max = e;
+  }
+
+  /**
+  The same for all levels (i.e. `boundary()`). */
+
+  foreach()
+    a[] = cos(pi*x)*cos(pi*y) + x*y;
+  boundary ({a});
+  foreach()
+    b[] = laplacian(a);
+  reset_halos();
+  foreach()
+    a[] = cos(pi*x)*cos(pi*y) + x*y;
+  boundary_start ({a}, -1);
+  foreach()
+    if (!is_border(cell))
+      c[] = laplacian(a);
+  boundary_finish();
+  foreach()
+    if (is_border(cell))
+      c[] = laplacian(a);
+  foreach (reduction(max:max))
+    if (fabs (b[] - c[]) > max)
+      max = fabs (b[] - c[]);
+
+  fprintf (stderr, "%s: %g\n", name, max);
+  assert (max == 0.);
+}
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  init_grid (64);
+  check_all ("uniform");
+  refine (sq(x) + sq(y) < sq(0.2) && level < 8);
+  check_all ("refined");
+  unrefine (level > 6);
+  check_all ("coarsened");
+
+  /**
+  The solutions of the Poisson equation obtained with and without
+  overlap must be identical to within the tolerance. The exchanges
+  only overlap on full trees. */
+
+  init_grid (64);
+  foreach() {
+    b[] = cos(2.*pi*x)*cos(2.*pi*y);
+    a[] = 0.;
+  }
+  mgstats s0 = poisson (a, b);
+  foreach()
+    c[] = a[], a[] = 0.;
+  mg_schedule.overlap = true;
+  mgstats s1 = poisson (a, b);
+  double max = 0.;
+  foreach (reduction(max:max))
+    if (fabs (a[] - c[]) > max)
+      max = fabs (a[] - c[]);
+  fprintf (stderr, "poisson: %d %d %d %d\n", tree_is_full(),
+	   s0.i, s1.i, max < TOLERANCE);
+}
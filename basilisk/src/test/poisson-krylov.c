@@ -0,0 +1,92 @@
+/**
+# Krylov acceleration of the multigrid solver
+
+We solve a variable-coefficient Poisson problem with a density ratio
+of 1000 (a light bubble in a heavy fluid) on an adaptive mesh, and the
+corresponding implicit viscous problem. Multigrid-preconditioned
+Krylov solvers must converge to the same solution as the multigrid
+solver, using fewer multigrid cycles (one per iteration for the
+conjugate gradient, two for BiCGStab). */
+
+#include "poisson.h"
+#include "viscosity.h"
+
+#define rho(f) (clamp(f,0.,1.)*(1. - 1e-3) + 1e-3)
+
+scalar f[], a[], b[], rho[];
+face vector alpha[], mu[];
+
+static int solve (scalar s, int solver, const char * name)
+{
+  foreach()
+    s[] = 0.;
+  mgstats mg = poisson (s, b, alpha, tolerance = 1e-6, solver = solver);
+  printf ("%s: %d %d %g\n", name, mg.i, mg.nrelax, mg.resa);
+  assert (mg.resa <= 1e-6);
+  return mg.i;
+}
+
+static int solve_viscosity (vector u, int solver, const char * name)
+{
+  foreach()
+    foreach_dimension()
+      u.x[] = f[]*(x + y);
+  mgstats mg = viscosity (u, mu, rho, 1e-3, solver = solver);
+  printf ("%s: %d %d %g\n", name, mg.i, mg.nrelax, mg.resa);
+  assert (mg.resa <= TOLERANCE);
+  return mg.i;
+}
+
+int main()
+{
+  size (1.[0]);
+  origin (-0.5, -0.5);
+  init_grid (32);
+  refine (fabs (sqrt (sq(x - 0.1) + sq(y)) - 0.2) < 0.05 && level < 8);
+  foreach()
+    f[] = clamp (0.5 + (sqrt (sq(x - 0.1) + sq(y)) - 0.2)/Delta, 0., 1.);
+  foreach()
+    rho[] = rho(f[]);
+  foreach_face() {
+    double ff = (f[] + f[-1])/2.;
+    alpha.x[] = 1./rho(ff);
+    mu.x[] = 1e-2*rho(ff);
+  }
+  double mean = 0., area = 0.;
+  foreach (reduction(+:mean) reduction(+:area))
+    mean += dv()*sin(2.*pi*x)*cos(pi*y)*rho[], area += dv();
+  foreach()
+    b[] = sin(2.*pi*x)*cos(pi*y)*rho[] - mean/area;
+
+  int img = solve (a, MG_MULTIGRID, "multigrid");
+  scalar c[];
+  int icg = solve (c, MG_CG, "cg");
+  scalar d[];
+  int ibi = solve (d, MG_BICGSTAB, "bicgstab");
+  fprintf (stderr, "cg: %d\nbicgstab: %d\n", icg < img, 2*ibi < img);
+
+  /**
+  The solutions are defined up to a constant. */
+  
+  double ma = 0., mc = 0., md = 0.;
+  foreach (reduction(+:ma) reduction(+:mc) reduction(+:md))
+    ma += dv()*a[], mc += dv()*c[], md += dv()*d[];
+  double ec = 0., ed = 0., amax = 0.;
+  foreach (reduction(max:ec) reduction(max:ed) reduction(max:amax)) {
+    ec = max(ec, fabs (c[] - mc/area - a[] + ma/area));
+    ed = max(ed, fabs (d[] - md/area - a[] + ma/area));
+    amax = max(amax, fabs (a[] - ma/area));
+  }
+  printf ("%g %g %g\n", ec, ed, amax);
+  fprintf (stderr, "error cg: %d\nerror bicgstab: %d\n",
+	   ec < 1e-3*amax, ed < 1e-3*amax);
+
+  vector u[], v[];
+  int umg = solve_viscosity (u, MG_MULTIGRID, "viscosity multigrid");
+  int ubi = solve_viscosity (v, MG_BICGSTAB, "viscosity bicgstab");
+  double eu = 0.;
+  foreach (reduction(max:eu))
+    foreach_dimension()
+      eu = max(eu, fabs (u.x[] - v.x[]));
+  fprintf (stderr, "viscosity: %d %d\n", 2*ubi < umg, eu < 10.*TOLERANCE);
+}
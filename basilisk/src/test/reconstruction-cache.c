@@ -0,0 +1,74 @@
+/**
+# Cached interface reconstruction
+
+We advect two identical volume fraction fields in the time-reversed
+vortex of [reversed.c](), on an adaptive mesh. The [reconstruction is
+cached](/src/fractions.h#reconstruction_cache) only for the second
+field. The two fields, their interfacial areas and facets must remain
+identical. */
+
+#include "advection.h"
+#include "vof.h"
+
+scalar f[], g[];
+scalar * interfaces = {f, g}, * tracers = NULL;
+const double T = 15.;
+
+#define circle(x,y) (sq(0.2) - (sq(x + 0.2) + sq(y + .236338)))
+
+int main()
+{
+  origin (-0.5, -0.5);
+  DT = .1[0,1];
+  init_grid (1 << 7);
+  reconstruction_cache (g);
+  run();
+}
+
+event init (i = 0)
+{
+  fraction (f, circle(x,y));
+  foreach()
+    g[] = f[];
+  reconstruction_reset (g);
+}
+
+event velocity (i++) {
+  adapt_wavelet ({f}, (double[]){5e-3}, 7, list = {f, g});
+  vertex scalar psi[];
+  double a = 1.5, k = pi;
+  foreach_vertex()
+    psi[] = - a*sin(2.*pi*t/T)*sin(k*(x + 0.5))*sin(k*(y + 0.5))/pi;
+  trash ({u});
+  coord f = {-1.,1.};
+  foreach_face()
+    u.x[] = f.x*(psi[0,1] - psi[])/Delta;
+}
+
+int nsame = 0, narea = 0, nfacets = 0, nsteps = 0;
+
+event check (i++) {
+  int differ = 0;
+  foreach (reduction(+:differ))
+    differ += f[] != g[];
+  double af = interface_area (f), ag = interface_area (g);
+  FILE * ff = tmpfile(), * fg = tmpfile();
+  output_facets (f, ff);
+  output_facets (g, fg);
+  rewind (ff), rewind (fg);
+  int cf, cg;
+  do
+    cf = fgetc (ff), cg = fgetc (fg);
+  while (cf == cg && cf != EOF);
+  fclose (ff), fclose (fg);
+  if (i % 20 == 0)
+    printf ("%d %g %d %g %g\n", i, t, differ, af, ag);
+  nsame += !differ, narea += af == ag;
+  nfacets += cf == cg;
+  nsteps++;
+}
+
+event end (t = T/2.) {
+  fprintf (stderr, "f = g: %d\narea: %d\nfacets: %d\n",
+	   nsame == nsteps, narea == nsteps, nfacets == nsteps);
+}
@@ -0,0 +1,73 @@
+/**
+# Vectorised loops on regular grids
+
+This is compiled with `-DSIMD=1 -fopenmp-simd`, so that the innermost
+loops of foreach() and foreach_face() are vectorised when their
+[stencil](/src/grid/stencils.h#vectorisation) allows it. The results
+are compared with those of `serial` loops, which are never
+vectorised. We also check the value of `_simd`, which tells whether a
+given loop can be vectorised. */
+
+#include "grid/multigrid.h"
+
+int main()
+{
+  init_grid (64);
+  scalar a[], b[], c[], s[];
+  face vector u[], us[];
+  foreach()
+    b[] = cos(2.*pi*x/L0)*sin(pi*y/L0), c[] = x*y;
+
+  /**
+  Independent iterations (vectorised). */
+
+  int vectorised = 0;
+  foreach (reduction(max:vectorised)) {
+    a[] = b[] + (c[1] + c[-1] + c[0,1] + c[0,-1] - 4.*c[])/sq(Delta);
+    vectorised = _simd;
+  }
+  foreach (serial)
+    s[] = b[] + (c[1] + c[-1] + c[0,1] + c[0,-1] - 4.*c[])/sq(Delta);
+  double err = 0.;
+  foreach (reduction(max:err))
+    if (fabs (a[] - s[]) > err)
+      err = fabs (a[] - s[]);
+  fprintf (stderr, "centered: %g %d\n", err, vectorised);
+
+  foreach_face()
+    u.x[] = (a[] - a[-1])/Delta;
+  foreach_face (serial)
+    us.x[] = (a[] - a[-1])/Delta;
+  err = 0.;
+  foreach_face (reduction(max:err))
+    if (fabs (u.x[] - us.x[]) > err)
+      err = fabs (u.x[] - us.x[]);
+  fprintf (stderr, "face: %g\n", err);
+
+  /**
+  Reductions (vectorised, the summation order may differ). */
+
+  double sum = 0., sums = 0.;
+  foreach (reduction(+:sum))
+    sum += a[]*b[];
+  foreach (serial, reduction(+:sums))
+    sums += a[]*b[];
+  fprintf (stderr, "reduction: %d\n", fabs (sum - sums) < 1e-10*fabs (sums));
+
+  /**
+  This loop reads a field it writes at a neighboring point: iterations
+  are not independent and the loop must not be vectorised. */
+
+  foreach()
+    a[] = 1.;
+  vectorised = 1;
+  foreach (reduction(min:vectorised)) {
+    a[] = a[0,-1] + 1.;
+    vectorised = _simd;
+  }
+  err = 0.;
+  foreach (reduction(max:err))
+    if (fabs (a[] - (point.j - GHOSTS + 2)) > err)
+      err = fabs (a[] - (point.j - GHOSTS + 2));
+  fprintf (stderr, "dependent: %g %d\n", err, vectorised);
+}
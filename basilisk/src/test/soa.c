@@ -0,0 +1,41 @@
+/**
+# Structure-of-arrays storage on trees
+
+A three-dimensional, adaptive, two-phase run (with many fields and
+frequent reallocations of the grid) using the [structure-of-arrays
+layout](/src/grid/tree.h#structure-of-arrays-storage). The results
+must be identical to those obtained with the default layout. */
+
+#include "grid/octree.h"
+#include "navier-stokes/centered.h"
+#include "two-phase.h"
+#include "tension.h"
+
+int main()
+{
+  init_grid (16);
+  rho2 = 0.01;
+  mu1 = 0.01, mu2 = 0.001;
+  f.sigma = 1.;
+  run();
+}
+
+event init (t = 0)
+{
+  refine (sq(x - 0.5) + sq(y - 0.5) + sq(z - 0.5) < sq(0.3) && level < 6);
+  fraction (f, sq(0.25) - sq(x - 0.5) - sq(y - 0.5) - sq(z - 0.5));
+}
+
+event adapt (i++)
+{
+  adapt_wavelet ({f,u}, (double[]){1e-3,1e-2,1e-2,1e-2}, 6);
+}
+
+event logfile (i++)
+{
+  stats s = statsf (f);
+  fprintf (stderr, "%d %g %.6g %.6g %ld %d\n",
+	   i, t, s.sum, normf(p).max, grid->tn, mgp.i);
+}
+
+event end (i = 10);
@@ -0,0 +1,150 @@
+/**
+# Merging of tags across processes
+
+The tags given by [tag()](/src/tag.h) are compared with those of its
+previous implementation (iterative multigrid relaxation of the minimum
+tag value), on many neighborhoods which span several processes. The
+tags must be identical. */
+
+#include "fractions.h"
+#include "tag.h"
+
+/**
+## Previous implementation */
+
+int tag_reference (scalar t)
+{
+  t.restriction = restriction_tag;
+  t.refine = t.prolongation = refine_injection;
+  t.dirty = true;
+  
+#if _MPI
+  scalar index[];
+  z_indexing (index, true);
+  foreach()
+    t[] = (t[] != 0)*(index[] + 1);
+#else // !_MPI
+  long i = 1;
+  foreach_cell()
+    if (is_leaf(cell)) {
+      t[] = (t[] != 0)*i++;
+      continue;
+    }
+#endif // !_MPI
+
+  bool changed;
+  do {
+    restriction ({t});
+    changed = false;
+    for (int l = 1; l <= grid->maxdepth; l++) {
+      foreach_level(l)
+	if (coarse(t))
+	  t[] = coarse(t);
+      boundary_level ({t}, l);
+      foreach_level (l, reduction(||:changed))
+        if (t[]) {
+	  double min = t[];
+	  foreach_neighbor(1)
+	    if (t[] && t[] < min)
+	      min = t[];
+	  foreach_dimension()
+	    for (int i = -1; i <= 2; i += 3)
+	      if (is_refined (neighbor((2*i - 1)/3)))
+		for (int j = 0; j <= 1; j++)
+		  for (int k = 0; k <= 1; k++)
+		    if (fine(t,i,j,k) && fine(t,i,j,k) < min)
+		      min = fine(t,i,j,k);
+	  if (t[] != min) {
+	    changed = true;
+	    t[] = min;
+	  }
+	}
+      boundary_level ({t}, l);
+    }
+  } while (changed);
+
+  Array * a = array_new();
+  foreach (serial)
+    if (t[] > 0) {
+      double tag = t[], * ap = (double *) a->p;
+      long s = -1;
+      if (a->len == 0 || tag > ap[a->len/sizeof(double) - 1])
+	s = a->len/sizeof(double);
+      else if (tag < ap[0])
+	s = 0;
+      else {
+	s = lookup_tag (a, tag) + 1;
+	if (tag == ap[s - 1] || tag == ap[s])
+	  s = -1;
+      }
+      if (s >= 0) {
+	array_append (a, &tag, sizeof(double)), ap = (double *) a->p;
+	for (int i = a->len/sizeof(double) - 1; i > s; i--)
+	  ap[i] = ap[i-1];
+	ap[s] = tag;
+      }
+    }
+
+#if _MPI
+  long lmax = a->len;
+  mpi_all_reduce (lmax, MPI_LONG, MPI_MAX);
+  a->p = realloc (a->p, lmax);
+  lmax /= sizeof(double);
+  double * q = a->p;
+  for (int i = a->len/sizeof(double); i < lmax; i++)
+    q[i] = -1;
+  double p[lmax*npe()];
+  MPI_Allgather (a->p, lmax, MPI_DOUBLE, p, lmax, MPI_DOUBLE, MPI_COMM_WORLD);
+  qsort (p, lmax*npe(), sizeof(double), compar_double);
+  array_free (a);
+  a = array_new();
+  double last = -1;
+  for (int i = 0; i < lmax*npe(); i++)
+    if (p[i] != last) {
+      array_append (a, &p[i], sizeof(double));
+      last = p[i];
+    }
+#endif
+
+  foreach()
+    if (t[] > 0)
+      t[] = lookup_tag (a, t[]) + 1;
+  int n = a->len/sizeof(double);
+  array_free (a);
+  return n;
+}
+
+/**
+## Neighborhoods
+
+The neighborhoods are rings, spirals and drops of various sizes on
+an adaptive mesh. */
+
+double geometry (double x, double y)
+{
+  double r = sqrt (sq(x) + sq(y)), theta = atan2 (y, x);
+  return max (sin (40.*r + 3.*theta)*sin (8.*x)*sin (9.*y), 0.) - 0.05;
+}
+
+int main()
+{
+  origin (-0.5, -0.5);
+  init_grid (64);
+  scalar f[];
+  for (int l = 6; l <= 9; l++) {
+    fraction (f, geometry (x/L0, y/L0));
+    adapt_wavelet ({f}, (double[]){1e-3}, l);
+  }
+  fraction (f, geometry (x/L0, y/L0));
+  
+  scalar t1[], t2[];
+  foreach()
+    t1[] = t2[] = f[] > 1e-3;
+  int n1 = tag (t1), n2 = tag_reference (t2);
+  long different = 0;
+  foreach (reduction(+:different))
+    if (t1[] != t2[])
+      different++;
+  fprintf (stderr, "neighborhoods: %d %d different: %ld\n",
+	   n1, n2, different);
+}
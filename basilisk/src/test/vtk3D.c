@@ -0,0 +1,48 @@
+/**
+# VTK output in 3D
+
+In 3D, *output_vtk()* writes the values on the plane *z = 0*. They
+must be identical to those given by *interpolate()*. */
+
+#include "grid/octree.h"
+#include "utils.h"
+#include "vtk.h"
+
+scalar a[];
+
+int main()
+{
+  origin (-0.5, -0.5, -0.5);
+  init_grid (8);
+  refine (level < 6 && sq(x - 0.1) + sq(y + 0.1) + sq(z) < sq(0.25));
+  foreach()
+    a[] = cos(2.*x/L0)*sin(3.*y/L0)*(1. + z/L0);
+
+  int n = 32;
+  for (int linear = 0; linear <= 1; linear++) {
+    FILE * fp = fopen ("vtk", "w");
+    output_vtk ({a}, n, fp, linear);
+    fclose (fp);
+
+    /**
+    The values are read back and compared with those of
+    *interpolate()*, to the precision of the `%g` format. */
+
+    fp = fopen ("vtk", "r");
+    char line[80];
+    while (fgets (line, 80, fp) && strncmp (line, "LOOKUP_TABLE", 12));
+    double Delta = L0/n, emax = 0.;
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++) {
+	double v;
+	assert (fscanf (fp, "%lf", &v) == 1);
+	double e = fabs (v - interpolate (a, Delta*i + X0 + Delta/2.,
+					  Delta*j + Y0 + Delta/2., 0.,
+					  linear));
+	if (e > emax)
+	  emax = e;
+      }
+    fclose (fp);
+    fprintf (stderr, "linear: %d identical: %d\n", linear, emax < 1e-5);
+  }
+}
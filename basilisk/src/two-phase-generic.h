@@ -4,8 +4,8 @@ double rho1 = 1., mu1 = 0., rho2 = 1., mu2 = 0.;
 Auxilliary fields are necessary to define the (variable) specific
 volume $\alpha=1/\rho$ as well as the cell-centered density. */
 
-face vector alphav[];
-scalar rhov[];
+float face vector alphav[];
+float scalar rhov[];
 
 event defaults (i = 0)
 {
@@ -42,26 +42,60 @@ We have the option of using some "smearing" of the density/viscosity
 jump. */
 
 #if FILTERED
-scalar sf[];
+float scalar sf[];
 #else
 # define sf f
 #endif
 
+/**
+## Fused properties kernel
+
+The (smeared) volume fraction, the density, the face coefficients and
+the quantities needed by the stability condition of [surface
+tension](tension.h) are all computed in the *properties* event, using
+one pass over the cells and one pass over the faces. These loops are
+limited by memory bandwidth, so that fusing them is cheaper than
+separate passes.
+
+The extrema of $\alpha/f_m = 1/\rho$ and the minimum cell size, on
+faces with a non-zero metric, are stored in the structure below (see
+the *stability* event of [tension.h](tension.h#stability-condition)). */
+
+#define TWO_PHASE_STABILITY 1
+
+struct {
+  double amin, amax, dmin;
+} two_phase_stability = {HUGE, -HUGE, HUGE};
+
+/**
+Face values use bilinear interpolation of *sf* at coarse/fine
+boundaries, during the timestep. */
+
 event tracer_advection (i++)
 {
-  
+#if TREE
+  sf.prolongation = refine_bilinear;
+  sf.dirty = true; // boundary conditions need to be updated
+#endif
+}
+
+#include "fractions.h"
+
+event properties (i++)
+{
+
   /**
-  When using smearing of the density jump, we initialise *sf* with the
-  vertex-average of *f*. */
+  When using smearing of the density jump, *sf* is the vertex-average
+  of *f*. It is computed in the same loop as the cell-centered
+  density. */
 
+  foreach() {
 #ifndef sf
 #if dimension <= 2
-  foreach()
     sf[] = (4.*f[] + 
 	    2.*(f[0,1] + f[0,-1] + f[1,0] + f[-1,0]) +
 	    f[-1,-1] + f[1,-1] + f[1,1] + f[-1,1])/16.;
 #else // dimension == 3
-  foreach()
     sf[] = (8.*f[] +
 	    4.*(f[-1] + f[1] + f[0,1] + f[0,-1] + f[0,0,1] + f[0,0,-1]) +
 	    2.*(f[-1,1] + f[-1,0,1] + f[-1,0,-1] + f[-1,-1] + 
@@ -71,28 +105,26 @@ event tracer_advection (i++)
 	    f[1,1,-1] + f[-1,-1,-1] + f[1,-1,-1] + f[-1,-1,1])/64.;
 #endif
 #endif // !sf
+    rhov[] = cm[]*rho(sf[]);
+  }
 
-#if TREE
-  sf.prolongation = refine_bilinear;
-  sf.dirty = true; // boundary conditions need to be updated
-#endif
-}
-
-#include "fractions.h"
-
-event properties (i++)
-{
-  foreach_face() {
+  double amin = HUGE, amax = -HUGE, dmin = HUGE;
+  foreach_face (reduction(min:amin) reduction(max:amax) reduction(min:dmin)) {
     double ff = (sf[] + sf[-1])/2.;
     alphav.x[] = fm.x[]/rho(ff);
     if (mu1 || mu2) {
       face vector muv = mu;
       muv.x[] = fm.x[]*mu(ff);
     }
+    if (fm.x[] > 0.) {
+      if (alphav.x[]/fm.x[] > amax) amax = alphav.x[]/fm.x[];
+      if (alphav.x[]/fm.x[] < amin) amin = alphav.x[]/fm.x[];
+      if (Delta < dmin) dmin = Delta;
+    }
   }
-  
-  foreach()
-    rhov[] = cm[]*rho(sf[]);
+  two_phase_stability.amin = amin;
+  two_phase_stability.amax = amax;
+  two_phase_stability.dmin = dmin;
 
 #if TREE
   sf.prolongation = fraction_refine;
@@ -143,7 +143,8 @@ double TOLERANCE_MU = 0.; // default to TOLERANCE
 
 trace
 mgstats viscosity (vector u, face vector mu, scalar rho, double dt,
-		   int nrelax = 4, scalar * res = NULL)
+		   int nrelax = 4, scalar * res = NULL,
+		   int solver = MG_MULTIGRID)
 {
   vector r[];
   foreach()
@@ -157,5 +158,6 @@ mgstats viscosity (vector u, face vector mu, scalar rho, double dt,
 		   residual_diffusion, relax_diffusion, &p, nrelax, res,
 		   minlevel = 1, // fixme: because of root level
                                   // BGHOSTS = 2 bug on trees
-		   tolerance = TOLERANCE_MU ? TOLERANCE_MU : TOLERANCE);
+		   tolerance = TOLERANCE_MU ? TOLERANCE_MU : TOLERANCE,
+		   solver = solver);
 }
@@ -141,25 +141,27 @@ static void relax_viscosity (scalar * a, scalar * b, int l, void * data)
 #endif
 
   /**
-  We have the option of using red/black Gauss-Seidel relaxation or
+  We have the option of using multicolour Gauss-Seidel relaxation or
   "re-use as soon as computed" relaxation. On GPUs (and probably also
-  with OpenMP) red/black Gauss-Seidel converges much better (but
-  requires two foreach() iterations). Note also that, unlike the other
-  option, red/black relaxation should be deterministic. */
+  with OpenMP) Gauss-Seidel converges much better (but requires
+  several foreach() iterations). The cross-derivative terms couple
+  each cell with its diagonal neighbours, so we use $2^{dimension}$
+  colours: the cells of a given colour then only depend on cells of
+  the other colours and, unlike the other option, the relaxation is
+  deterministic. */
   
+#if dimension > 1
+  vector ua = u;
+#endif
 #if GAUSS_SEIDEL || _GPU
-  vector ua[];
-  foreach_level (l)
-    foreach_dimension()
-      ua.x[] = u.x[];
-  boundary_level ((scalar *){ua}, l);
-  for (int parity = 0; parity < 2; parity++)
+  for (int colour = 0; colour < 1 << dimension; colour++)
+#if _GPU
     foreach_level_or_leaf (l, nowarning)
-      if (level == 0 || ((point.i + parity) % 2) != (point.j % 2))
+      if (cell_colour (1 << dimension) == colour)
 #else
-#if dimension > 1
-  vector ua = u;
+    foreach_level_or_leaf_colour (l, colour, 1 << dimension)
 #endif
+#else
   foreach_level_or_leaf (l)
 #endif
   {
@@ -299,11 +301,16 @@ static double residual_viscosity (scalar * a, scalar * b, scalar * resl,
 
 A user interface is provided for the solution of the viscous diffusion equation.
 
-### Implicit treatment */
+### Implicit treatment
+
+Since the operator is not symmetric (when the density varies), the
+appropriate [Krylov acceleration](poisson.h#krylov-acceleration) is
+`solver = MG_BICGSTAB`. */
 
 trace
 mgstats viscosity (vector u, face vector mu, scalar rho, double dt,
-		   int nrelax = 4, scalar * res = NULL)
+		   int nrelax = 4, scalar * res = NULL,
+		   int solver = MG_MULTIGRID)
 {
   
   /**
@@ -321,7 +328,8 @@ mgstats viscosity (vector u, face vector mu, scalar rho, double dt,
   restriction ({mu,rho});
   struct Viscosity p = { mu, rho, dt };
   return mg_solve ((scalar *){u}, (scalar *){r},
-		   residual_viscosity, relax_viscosity, &p, nrelax, res);
+		   residual_viscosity, relax_viscosity, &p, nrelax, res,
+		   solver = solver);
 }
 
 /**
@@ -33,6 +33,7 @@ attribute {
 We will need basic functions for volume fraction computations. */
 
 #include "fractions.h"
+#include "band.h"
 
 /**
 The list of volume fraction fields `interfaces`, will be provided by
@@ -49,37 +50,61 @@ extern double dt;
 The gradient of a VOF-concentration `t` is computed using a standard
 three-point scheme if we are far enough from the interface (as
 controlled by *cmin*), otherwise a two-point scheme biased away from
-the interface is used. */
+the interface is used.
 
-foreach_dimension()
-static double vof_concentration_gradient_x (Point point, scalar c, scalar t)
+The choice of the stencil only depends on the volume fractions
+$(c_{-1},c_0,c_1)$ (or $1 - c$ for *inverse* tracers). When several
+tracers are associated with the same interface, it is made only once
+for each side. */
+
+enum { vof_no_gradient, vof_centered, vof_right, vof_left };
+
+static inline int vof_concentration_stencil (const double cs[3])
 {
   static const double cmin = 0.5;
-  double cl = c[-1], cc = c[], cr = c[1];
-  if (t.inverse)
-    cl = 1. - cl, cc = 1. - cc, cr = 1. - cr;
-  if (cc >= cmin && t.gradient != zero) {
-    if (cr >= cmin) {
-      if (cl >= cmin) {
-	if (t.gradient)
-	  return t.gradient (t[-1]/cl, t[]/cc, t[1]/cr)/Delta;
-	else
-	  return (t[1]/cr - t[-1]/cl)/(2.*Delta);
-      }
-      else
-	return (t[1]/cr - t[]/cc)/Delta;
-    }
-    else if (cl >= cmin)
-      return (t[]/cc - t[-1]/cl)/Delta;
+  if (cs[1] >= cmin) {
+    if (cs[2] >= cmin)
+      return cs[0] >= cmin ? vof_centered : vof_right;
+    else if (cs[0] >= cmin)
+      return vof_left;
   }
+  return vof_no_gradient;
+}
+
+foreach_dimension()
+static inline double vof_tracer_gradient_x (Point point, scalar t,
+					    int stencil, const double cs[3])
+{
+  if (stencil == vof_centered) {
+    if (t.gradient)
+      return t.gradient (t[-1]/cs[0], t[]/cs[1], t[1]/cs[2])/Delta;
+    else
+      return (t[1]/cs[2] - t[-1]/cs[0])/(2.*Delta);
+  }
+  else if (stencil == vof_right)
+    return (t[1]/cs[2] - t[]/cs[1])/Delta;
+  else if (stencil == vof_left)
+    return (t[]/cs[1] - t[-1]/cs[0])/Delta;
   return 0.;
 }
 
+#if TREE
+foreach_dimension()
+static double vof_concentration_gradient_x (Point point, scalar c, scalar t)
+{
+  if (t.gradient == zero)
+    return 0.;
+  double cs[3] = {c[-1], c[], c[1]};
+  if (t.inverse)
+    for (int k = 0; k < 3; k++)
+      cs[k] = 1. - cs[k];
+  return vof_tracer_gradient_x (point, t, vof_concentration_stencil (cs), cs);
+}
+
 /**
 On trees, VOF concentrations need to be refined properly i.e. using
 volume-fraction-weighted linear interpolation of the concentration. */
 
-#if TREE
 static void vof_concentration_refine (Point point, scalar s)
 {
   scalar f = s.c;
@@ -157,8 +182,7 @@ dimensions. */
 foreach_dimension()
 static void sweep_x (scalar c, scalar cc, scalar * tcl)
 {
-  vector n[];
-  scalar alpha[], flux[];
+  scalar flux[];
   double cfl = 0.;
 
   /**
@@ -177,21 +201,39 @@ static void sweep_x (scalar c, scalar cc, scalar * tcl)
     }
 
     /**
-    The gradient is computed using the "interface-biased" scheme above. */
+    The gradient is computed using the "interface-biased" scheme
+    above. The stencils are chosen once for each side of the
+    interface and used for all the tracers. */
 
     foreach() {
+      double cs[2][3] = {{c[-1], c[], c[1]}};
+      for (int k = 0; k < 3; k++)
+	cs[1][k] = 1. - cs[0][k];
+      int stencil[2] = {vof_concentration_stencil (cs[0]),
+			vof_concentration_stencil (cs[1])};
       scalar t, gf;
       for (t,gf in tracers,gfl)
-	gf[] = vof_concentration_gradient_x (point, c, t);
+	gf[] = t.gradient == zero ? 0. :
+	  vof_tracer_gradient_x (point, t, stencil[t.inverse], cs[t.inverse]);
     }
   }
   
   /**
   We reconstruct the interface normal $\mathbf{n}$ and the intercept
-  $\alpha$ for each cell. Then we go through each (vertical) face of
-  the grid. */
-
-  reconstruction (c, n, alpha);
+  $\alpha$ for each cell, or reuse the [cached
+  reconstruction](fractions.h#reconstruction_cache) (if any). Then we
+  go through each (vertical) face of the grid. */
+
+  vector n;
+  scalar alpha;
+  bool cached = reconstruction_update (c);
+  if (cached)
+    n = c.rn, alpha = c.ralpha;
+  else {
+    n = new vector;
+    alpha = new scalar;
+    reconstruction (c, n, alpha);
+  }
   foreach_face(x, reduction (max:cfl)) {
 
     /**
@@ -236,22 +278,28 @@ static void sweep_x (scalar c, scalar cc, scalar * tcl)
     /**
     If we are transporting tracers, we compute their flux using the
     upwind volume fraction *cf* and a tracer value upwinded using the
-    Bell--Collela--Glaz scheme and the gradient computed above. */
-    
-    scalar t, gf, tflux;
-    for (t,gf,tflux in tracers,gfl,tfluxl) {
-      double cf1 = cf, ci = c[i];
-      if (t.inverse)
-	cf1 = 1. - cf1, ci = 1. - ci;
-      if (ci > 1e-10) {
-	double ff = t[i]/ci + s*min(1., 1. - s*un)*gf[i]*Delta/2.;
-	tflux[] = ff*cf1*uf.x[];
+    Bell--Collela--Glaz scheme and the gradient computed above. The
+    geometric quantities are computed once for each side of the
+    interface and used for all the tracers. */
+
+    if (tracers) {
+      double cfs[2] = {cf, 1. - cf}, cis[2] = {c[i], 1. - c[i]};
+      double w = s*min(1., 1. - s*un);
+      scalar t, gf, tflux;
+      for (t,gf,tflux in tracers,gfl,tfluxl) {
+	double ci = cis[t.inverse];
+	if (ci > 1e-10) {
+	  double ff = t[i]/ci + w*gf[i]*Delta/2.;
+	  tflux[] = ff*cfs[t.inverse]*uf.x[];
+	}
+	else
+	  tflux[] = 0.;
       }
-      else
-	tflux[] = 0.;
     }
   }
   delete (gfl); free (gfl);
+  if (!cached)
+    delete ((scalar *){n, alpha});
   
   /**
   We warn the user if the CFL condition has been violated. */
@@ -315,6 +363,12 @@ static void sweep_x (scalar c, scalar cc, scalar * tcl)
 #endif // EMBED
 
   delete (tfluxl); free (tfluxl);
+
+  /**
+  The volume fraction has changed, so that its cached reconstruction
+  (if any) is no longer valid. */
+
+  reconstruction_reset (c);
 }
 
 /**
@@ -374,6 +428,11 @@ void vof_advection (scalar * interfaces, int i)
     for (d = 0; d < dimension; d++)
       sweep[(i + d) % dimension] (c, cc, tcl);
     delete (tcl), free (tcl);
+
+    /**
+    The [narrow band](band.h) of the interface (if any) is updated. */
+
+    band_update (c);
   }
 }
 
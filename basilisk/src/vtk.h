@@ -8,27 +8,26 @@ void output_vtk (scalar * list, int n, FILE * fp, bool linear)
   fprintf (fp, "POINTS %d double\n", n*n);
   
   double fn = n;
-  double Delta = L0/fn;
+  double Delta = L0/fn, px[n], py[n], pz = 0.;
   for (int i = 0; i < n; i++) {
-    double x = Delta*i + X0 + Delta/2.;
-    for (int j = 0; j < n; j++) {
-      double y = Delta*j + Y0 + Delta/2.;
-      fprintf (fp, "%g %g 0\n", x, y);
-    }
+    px[i] = Delta*i + X0 + Delta/2.;
+    py[i] = Delta*i + Y0 + Delta/2.;
   }
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      fprintf (fp, "%g %g 0\n", px[i], py[j]);
   fprintf (fp, "POINT_DATA %d\n", n*n);
+  int len = list_len (list);
+  double * v = malloc (n*n*len*sizeof(double));
+  interpolate_region (list, (coord){n, n, 1}, px, py, &pz, v, linear);
+  int k = 0;
   for (scalar s in list) {
     fprintf (fp, "SCALARS %s double\n", s.name);
     fputs ("LOOKUP_TABLE default\n", fp);
-    double fn = n;
-    double Delta = L0/fn;
-    for (int i = 0; i < n; i++) {
-      double x = Delta*i + X0 + Delta/2.;
-      for (int j = 0; j < n; j++) {
-	double y = Delta*j + Y0 + Delta/2.;
-	fprintf (fp, "%g\n", interpolate (s, x, y, linear = linear));
-      }
-    }
+    for (int i = 0; i < n*n; i++)
+      fprintf (fp, "%g\n", v[i*len + k]);
+    k++;
   }
+  free (v);
   fflush (fp);
 }
@@ -1,11 +1,11 @@
 import numpy as np
 import os
 import subprocess as sp
+import tempfile
 import matplotlib
 import matplotlib.pyplot as plt
 import matplotlib.patches as patches
 from matplotlib.ticker import StrMethodFormatter
-import concurrent.futures
 import multiprocessing
 import argparse
 
@@ -14,10 +14,22 @@ matplotlib.rcParams['font.family'] = 'serif'
 matplotlib.rcParams['text.usetex'] = True
 AxesLabel, TickLabel = [50, 20]
 
-def get_data(exe):
-    result = sp.run(exe, capture_output=True, text=True)
-    data = np.fromstring(result.stderr, sep=' ').reshape((-1, 5))
-    return data.T
+def get_data(filename, ymax, xmax, n, Oh, LINEAR):
+    # a single getDataSlices run writes both the x = 0 and z = 0 planes
+    # as binary .npy arrays (see npy.h)
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = ["./getDataSlices", "-ymax", str(ymax), "-hmax", str(xmax),
+               "-n", str(n), "-Oh", str(Oh), "-x", "0", "-z", "0", "-o", tmp]
+        if LINEAR:
+            exe.append("-linear")
+        sp.run(exe + [filename], check=True)
+        base = os.path.join(tmp, os.path.basename(filename))
+        results = []
+        for plane in ["x0", "z0"]:
+            data = np.load(f"{base}-{plane}.npy")
+            nfields = len(data.dtype.names)
+            results.append(data.view(np.float64).reshape((-1, nfields)).T)
+        return results
 
 def plot_subplot(ax, data, ymin, xmax, ymax):
     y, x, f, vel, D2 = data
@@ -48,13 +60,8 @@ def plot_data(filename, ImageName, ymin, xmax, ymax, n, Oh, LINEAR, t):
     ax1 = fig.add_subplot(121)
     ax2 = fig.add_subplot(122)
 
-    # Execute commands to get data
-    commands = [
-        ["./getDataXSlice", filename, str(ymax), str(xmax), str(0.), str(n), str(Oh), LINEAR],
-        ["./getDataZSlice", filename, str(ymax), str(xmax), str(0.), str(n), str(Oh), LINEAR]
-    ]
-    with concurrent.futures.ThreadPoolExecutor() as executor:
-        results = executor.map(get_data, commands)
+    # Extract both slices from the snapshot
+    results = get_data(filename, ymax, xmax, n, Oh, LINEAR)
 
     # Plot subplots with adjusted aspect ratios
     for ax, data in zip([ax1, ax2], results):
@@ -101,7 +108,7 @@ def process_single_time_step(t, base_filename, image_folder, ymin, Oh):
     print(f"Processing {t}")
 
     xmax, ymax, n  = 2.5, 2.5, 256
-    LINEAR = 'false'
+    LINEAR = True
     plot_data(filename, ImageName, ymin, xmax, ymax, n, Oh, LINEAR, t)
 
 if __name__ == '__main__':
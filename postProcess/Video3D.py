@@ -1,4 +1,5 @@
-#import subprocess as sp
+import subprocess as sp
+import tempfile
 import numpy as np
 import pyvista as pv
 import os
@@ -15,10 +16,16 @@ def create_polydata(points, lines_array, faces_array):
     polydata.faces = faces_array
     return polydata
 
-def run_process(command):
-    p = sp.Popen(command, stdout=sp.PIPE, stderr=sp.PIPE)
-    stdout, stderr = p.communicate()
-    return stderr.decode("utf-8").strip()
+def run_process(filename):
+    # a single getDataSlices run writes both the bottom cells and the facets
+    with tempfile.TemporaryDirectory() as tmp:
+        sp.run(["./getDataSlices", "-facets", "-cells", "-o", tmp, filename], check=True)
+        base = os.path.join(tmp, os.path.basename(filename))
+        with open(f"{base}-cells.dat") as fp:
+            cell_data = fp.read().strip()
+        with open(f"{base}-facets.dat") as fp:
+            facet_data = fp.read().strip()
+        return cell_data, facet_data
 
 def process_cells(cell_data):
     lines_array = np.array([[2, 0, 1], [2, 1, 2], [2, 2, 3], [2, 3, 0]], dtype=np.int32)
@@ -46,14 +53,12 @@ def reflect_mesh(mesh, normals):
         mesh = mesh.merge(mesh.reflect(normal))
     return mesh
 
-def gettingGrid(filename):
-    cell_data = run_process(["./getCells_bottomPlate", filename])
+def gettingGrid(cell_data):
     cells = process_cells(cell_data)
     mesh = pv.MultiBlock(cells).combine()
     return reflect_mesh(mesh, {'x': [1, 0, 0], 'z': [0, 0, 1]})
 
-def gettingFacets3D(filename):
-    facet_data = run_process(["./getFacets3D", filename])
+def gettingFacets3D(facet_data):
     mesh = process_facets(facet_data)
     return reflect_mesh(mesh, {'x': [1, 0, 0], 'z': [0, 0, 1]})
 
@@ -71,8 +76,9 @@ def process_and_save_image(t, base_filename, image_folder):
     
     print(f"Processing {t}")
 
-    cells = gettingGrid(filename)
-    poly_data = gettingFacets3D(filename)
+    cell_data, facet_data = run_process(filename)
+    cells = gettingGrid(cell_data)
+    poly_data = gettingFacets3D(facet_data)
 
     plotter = pv.Plotter(off_screen=True)
 
@@ -1,22 +1,43 @@
-/* Title: Saving images with bview
+/* Title: Cells of the bottom plate
 # Authors: Vatsal & Youssef
 # vatsalsanjay@gmail.com
 # Physics of Fluids
+
+The snapshot is read using the [random-access dump
+reader](../basilisk/src/dumpmap/dumpmap.h) rather than restore(): only
+the subtrees touching the bottom boundary are traversed and the grid
+is not rebuilt. This is a plain C program, compiled with
+
+~~~bash
+cc -O2 -I$BASILISK/dumpmap getCells_bottomPlate.c \
+   -L$BASILISK/dumpmap -ldumpmap -lm -o getCells_bottomPlate
+~~~
 */
 
-#include "grid/octree.h"
-#include "navier-stokes/centered.h"
-#include "fractions.h"
+#include <stdio.h>
+#include "dumpmap.h"
 
-char filename[80];
-int main(int a, char const *arguments[]) {
-  sprintf (filename, "%s", arguments[1]);
-  restore (file=filename);
-  foreach_boundary(bottom){
-    fprintf (ferr, "%g %g %g\n%g %g %g\n%g %g %g\n%g %g %g\n\n",
-	       x - Delta/2., y, z - Delta/2.,
-	       x - Delta/2., y, z + Delta/2.,
-	       x + Delta/2., y, z + Delta/2.,
-	       x + Delta/2., y, z - Delta/2.);
+static bool bottom (DumpMap * m, const DumpCell * c, void * data)
+{
+  if (c->j > 0)
+    return false;
+  if (c->leaf) {
+    double x = c->x, y = m->origin[1], z = c->z, Delta = c->delta;
+    fprintf (stderr, "%g %g %g\n%g %g %g\n%g %g %g\n%g %g %g\n\n",
+	     x - Delta/2., y, z - Delta/2.,
+	     x - Delta/2., y, z + Delta/2.,
+	     x + Delta/2., y, z + Delta/2.,
+	     x + Delta/2., y, z - Delta/2.);
   }
+  return true;
+}
+
+int main (int a, char const * arguments[])
+{
+  DumpMap * m = dumpmap_open (arguments[1]);
+  if (!m)
+    return 1;
+  dumpmap_traverse (m, bottom, NULL);
+  dumpmap_close (m);
+  return 0;
 }
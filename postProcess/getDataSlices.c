@@ -0,0 +1,288 @@
+/* Title: Batched extraction of slices, facets and bottom cells
+# Author: Vatsal Sanjay
+# vatsalsanjay@gmail.com
+# Physics of Fluids
+
+Each snapshot is restored once and the derived fields (vel and D2c) are
+computed once, after which any number of planes, the interface facets
+(as getFacets3D) and the cells of the bottom plate (as
+getCells_bottomPlate, in the same order) are written in the same run. Any number of
+snapshots can be processed by a single process.
+
+Usage:
+
+./getDataSlices [-ymax 2.5] [-hmax 2.5] [-n 256] [-Oh 0.01] [-linear]
+                [-x 0]... [-z 0]... [-facets] [-cells] [-o .] snapshot...
+
+For each snapshot, with basename B, the following files are written in
+the output directory (-o):
+
+- B-x<X>.npy: samples (y, z, f, vel, D2c) of the plane x = X
+- B-z<Z>.npy: samples (y, x, f, vel, D2c) of the plane z = Z
+- B-facets.dat: the interface facets
+- B-cells.dat: the cells touching the bottom boundary
+
+The .npy files are written as by getDataXSlice/getDataZSlice with the
+"npy" option (see npy.h). The planes are sampled on a regular grid of
+n points across [0:hmax] if -linear is given and the mesh is coarse
+enough (as in getDataXSlice), otherwise the values of the cells cut by
+the plane are written.
+*/
+
+#include "grid/octree.h"
+#include "navier-stokes/centered.h"
+#define FILTERED
+#include "two-phase.h"
+#include "navier-stokes/conserving.h"
+#include "tension.h"
+#include "npy.h"
+
+#define Mu21 (1.00e-3)
+#define Rho21 (1.00e-3)
+
+#define MAXPLANES 32
+
+typedef struct {
+  char dir;   // the normal direction ('x' or 'z')
+  double pos; // the position of the plane
+} Plane;
+
+scalar vel[], D2c[];
+scalar * list = NULL;
+
+/* the derived fields, computed once per snapshot */
+double derived_fields (double Oh)
+{
+  rho1 = 1.0; mu1 = Oh;
+  rho2 = Rho21; mu2 = Mu21*Oh;
+
+  double DeltaMin = HUGE;
+  foreach (reduction(min:DeltaMin)){
+    vel[] = sqrt(sq(u.x[]) + sq(u.y[]) + sq(u.z[]));
+
+    double D2 = 0.;
+    foreach_dimension(){
+      double DII = (u.x[1,0,0]-u.x[-1,0,0])/(2*Delta);
+      double DIJ = 0.5*((u.x[0,1,0]-u.x[0,-1,0] + u.y[1,0,0] - u.y[-1,0,0])/(2*Delta));
+      double DIK = 0.5*((u.x[0,0,1]-u.x[0,0,-1] + u.z[1,0,0] - u.z[-1,0,0])/(2*Delta));
+      D2 += sq(DII) + sq(DIJ) + sq(DIK);
+    }
+    D2c[] = 2*(mu(f[]))*D2;
+    if (D2c[] > 0.){
+      D2c[] = log(D2c[])/log(10.);
+    } else {
+      D2c[] = -10.;
+    }
+
+    if (Delta < DeltaMin)
+      DeltaMin = Delta;
+  }
+  return DeltaMin;
+}
+
+void output_plane (const char * name, Plane p, double ymin, double ymax,
+		   double hmax, int n, bool linear, double DeltaMin)
+{
+  int len = list_len(list) + 2;
+  Array * samples = array_new();
+
+  double Delta_h = hmax/n;
+  if (linear && DeltaMin < 4*Delta_h)
+    linear = false;
+
+  if (!linear) {
+    foreach (serial) {
+      double c = p.dir == 'x' ? x : z;
+      if (c - Delta/2. <= p.pos && p.pos < c + Delta/2.) {
+        double v[] = {y, p.dir == 'x' ? z : x, f[], vel[], D2c[]};
+        array_append (samples, v, sizeof(v));
+      }
+    }
+  } else {
+    int ny = (int)((ymax-ymin)/Delta_h);
+    double DeltaY = (double)((ymax-ymin)/(ny));
+
+    /* all the samples are interpolated in a single pass over the
+       cells (see interpolate_region()) */
+    int nf = len - 2;
+    double * field = malloc (ny*n*nf*sizeof(double));
+    double * py = malloc (ny*sizeof(double)), * ph = malloc (n*sizeof(double));
+    for (int i = 0; i < ny; i++)
+      py[i] = DeltaY*i + ymin;
+    for (int j = 0; j < n; j++)
+      ph[j] = Delta_h*j;
+    if (p.dir == 'x')
+      interpolate_region (list, (coord){1, ny, n}, &p.pos, py, ph, field, true);
+    else
+      interpolate_region (list, (coord){n, ny, 1}, ph, py, &p.pos, field, true);
+
+    for (int i = 0; i < ny; i++) {
+      double y = DeltaY*i + ymin;
+      for (int j = 0; j < n; j++) {
+        double h = Delta_h*j;
+        double v[len];
+        v[0] = y, v[1] = h;
+        double * w = field + (p.dir == 'x' ? i*n + j : j*ny + i)*nf;
+        for (int k = 0; k < nf; k++)
+          v[k + 2] = w[k];
+        array_append (samples, v, sizeof(v));
+      }
+    }
+    free (field);
+    free (py), free (ph);
+  }
+
+  const char * names[len];
+  names[0] = "y", names[1] = p.dir == 'x' ? "z" : "x";
+  int k = 2;
+  for (scalar s in list)
+    names[k++] = s.name;
+  FILE * fp = fopen (name, "w");
+  if (!fp) {
+    perror (name);
+    exit (1);
+  }
+  npy_write (fp, names, len, samples->len/(len*sizeof(double)),
+             (double *) samples->p);
+  fclose (fp);
+  array_free (samples);
+}
+
+/* as getFacets3D */
+void output_facets_3D (scalar c, FILE * fp)
+{
+  foreach (serial)
+    if (c[] > 1e-6 && c[] < 1. - 1e-6) {
+      coord n = interface_normal (point, c);
+      double alpha = plane_alpha (c[], n);
+      coord v[12];
+      int m = facets (n, alpha, v, 1.1);
+      for (int i = 0; i < m; i++)
+        fprintf (fp, "%g %g %g\n",
+                 x + v[i].x*Delta, y + v[i].y*Delta, z + v[i].z*Delta);
+      if (m > 0)
+        fputc ('\n', fp);
+    }
+  fflush (fp);
+}
+
+/* as getCells_bottomPlate, in the same order i.e. that of the cells
+   in the dump file */
+void output_bottom_cells (FILE * fp)
+{
+  foreach_cell() {
+    if (point.j > GHOSTS)
+      continue;
+    if (is_leaf (cell)) {
+      fprintf (fp, "%g %g %g\n%g %g %g\n%g %g %g\n%g %g %g\n\n",
+               x - Delta/2., Y0, z - Delta/2.,
+               x - Delta/2., Y0, z + Delta/2.,
+               x + Delta/2., Y0, z + Delta/2.,
+               x + Delta/2., Y0, z - Delta/2.);
+      continue;
+    }
+  }
+  fflush (fp);
+}
+
+static FILE * open_output (const char * dir, const char * base,
+                           const char * suffix, char * name)
+{
+  sprintf (name, "%s/%s-%s", dir, base, suffix);
+  FILE * fp = fopen (name, "w");
+  if (!fp) {
+    perror (name);
+    exit (1);
+  }
+  return fp;
+}
+
+int main(int a, char const *arguments[]){
+
+  // boundary conditions
+  u.t[bottom] = dirichlet(0.);
+  u.r[bottom] = dirichlet(0.);
+  f[bottom] = dirichlet(1.);
+
+  double ymax = 2.5, hmax = 2.5, Oh = 0.01;
+  int n = 256, nplanes = 0;
+  bool linear = false, facets = false, cells = false;
+  const char * dir = ".";
+  Plane planes[MAXPLANES];
+
+  int i = 1;
+  for (; i < a && arguments[i][0] == '-'; i++) {
+    const char * o = arguments[i];
+    if (!strcmp (o, "-linear"))
+      linear = true;
+    else if (!strcmp (o, "-facets"))
+      facets = true;
+    else if (!strcmp (o, "-cells"))
+      cells = true;
+    else if (i + 1 < a) {
+      const char * v = arguments[++i];
+      if (!strcmp (o, "-ymax"))
+        ymax = atof (v);
+      else if (!strcmp (o, "-hmax"))
+        hmax = atof (v);
+      else if (!strcmp (o, "-n"))
+        n = atoi (v);
+      else if (!strcmp (o, "-Oh"))
+        Oh = atof (v);
+      else if (!strcmp (o, "-o"))
+        dir = v;
+      else if ((!strcmp (o, "-x") || !strcmp (o, "-z")) && nplanes < MAXPLANES)
+        planes[nplanes++] = (Plane){o[1], atof (v)};
+      else {
+        fprintf (ferr, "getDataSlices: unknown option '%s'\n", o);
+        return 1;
+      }
+    }
+    else {
+      fprintf (ferr, "getDataSlices: missing value for '%s'\n", o);
+      return 1;
+    }
+  }
+
+  list = list_add (list, f);
+  list = list_add (list, vel);
+  list = list_add (list, D2c);
+
+  for (; i < a; i++) {
+    const char * filename = arguments[i];
+    if (!restore (file = filename)) {
+      fprintf (ferr, "getDataSlices: cannot restore '%s'\n", filename);
+      continue;
+    }
+    f.prolongation = fraction_refine;
+    f.dirty = true;
+    boundary ({f,u.x,u.y,u.z});
+
+    const char * base = strrchr (filename, '/') ? strrchr (filename, '/') + 1 : filename;
+    char name[1024], suffix[80];
+
+    if (nplanes > 0) {
+      double DeltaMin = derived_fields (Oh);
+      double ymin = HUGE;
+      foreach_boundary (left, reduction(min:ymin))
+        if (y < ymin) ymin = y;
+      for (int j = 0; j < nplanes; j++) {
+        sprintf (suffix, "%c%g.npy", planes[j].dir, planes[j].pos);
+        sprintf (name, "%s/%s-%s", dir, base, suffix);
+        output_plane (name, planes[j], ymin, ymax, hmax, n, linear, DeltaMin);
+      }
+    }
+
+    if (facets) {
+      FILE * fp = open_output (dir, base, "facets.dat", name);
+      output_facets_3D (f, fp);
+      fclose (fp);
+    }
+
+    if (cells) {
+      FILE * fp = open_output (dir, base, "cells.dat", name);
+      output_bottom_cells (fp);
+      fclose (fp);
+    }
+  }
+}
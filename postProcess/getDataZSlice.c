@@ -10,11 +10,12 @@
 #include "two-phase.h"
 #include "navier-stokes/conserving.h"
 #include "tension.h"
+#include "npy.h"
 
 char filename[80];
 int ny, nx;
 double ymin, xmin, ymax, xmax, zSlice, Oh;
-bool linear;
+bool linear, npy;
 scalar * list = NULL;
 
 scalar vel[], D2c[];
@@ -53,6 +54,9 @@ int main(int a, char const *arguments[]){
 
   linear = arguments[7];
 
+  // optional: "npy" writes a binary NumPy array to stdout (see npy.h)
+  npy = a > 8 && !strcmp (arguments[8], "npy");
+
   rho1 = 1.0; mu1 = Oh;
   rho2 = Rho21; mu2 = Mu21*Oh;
 
@@ -64,7 +68,7 @@ int main(int a, char const *arguments[]){
 
   double DeltaMin = HUGE;
 
-  foreach(){
+  foreach (reduction(min:DeltaMin)){
     vel[] = sqrt(sq(u.x[]) + sq(u.y[]) + sq(u.z[]));
 
     double D2 = 0.;
@@ -89,50 +93,67 @@ int main(int a, char const *arguments[]){
     linear = false;
   }
 
+  /* the samples are stored as records of y, x and the fields in list */
+  int len = list_len(list) + 2;
+  Array * samples = array_new();
+
   if (linear == false){
-    FILE * fp = ferr;
     foreach_boundary(back){
       // if (y-2*Delta > ymin && y+2*Delta < ymax && x-2*Delta > xmin && x+2*Delta < xmax)
-        fprintf (fp, "%g %g %g %g %g\n", y, x, f[], vel[], D2c[]);
+        double v[] = {y, x, f[], vel[], D2c[]};
+        array_append (samples, v, sizeof(v));
     }
   } else {
-    
-    FILE * fp = ferr;
-
     double DeltaX = (double)((xmax-xmin)/(nx));
     int ny = (int)((ymax-ymin)/DeltaX);
     double DetlaY = (double)((ymax-ymin)/(ny));
 
     // fprintf (ferr, "ny = %d, nz = %d\n", ny, nz);
-    
-    int len = list_len(list);
-    double ** field = (double **) matrix_new (ny, nx, len*sizeof(double));
+
+    /* all the samples are interpolated in a single pass over the
+       cells (see interpolate_region()) */
+    int nf = len - 2;
+    double * field = malloc (nx*ny*nf*sizeof(double));
+    double * px = malloc (nx*sizeof(double)), * py = malloc (ny*sizeof(double));
+    for (int j = 0; j < nx; j++)
+      px[j] = DeltaX*j + xmin;
+    for (int i = 0; i < ny; i++)
+      py[i] = DetlaY*i + ymin;
+    interpolate_region (list, (coord){nx, ny, 1}, px, py, &zSlice, field, true);
+
     for (int i = 0; i < ny; i++) {
       double y = DetlaY*i + ymin;
       for (int j = 0; j < nx; j++) {
         double x = DeltaX*j + xmin;
-        int k = 0;
-        for (scalar s in list){
-          field[i][len*j + k++] = interpolate (s, x, y, zSlice);
-        }
+        double v[len];
+        v[0] = y, v[1] = x;
+        for (int k = 0; k < nf; k++)
+          v[k + 2] = field[(j*ny + i)*nf + k];
+        array_append (samples, v, sizeof(v));
       }
     }
+    free (field);
+    free (px), free (py);
+  }
 
-    for (int i = 0; i < ny; i++) {
-      double y = DetlaY*i + ymin;
-      for (int j = 0; j < nx; j++) {
-        double x = DeltaX*j + xmin;
-        fprintf (fp, "%g %g", y, x);
-        int k = 0;
-        for (scalar s in list){
-          fprintf (fp, " %g", field[i][len*j + k++]);
-        }
-        fputc ('\n', fp);
-      }
+  long n = samples->len/(len*sizeof(double));
+  double * v = (double *) samples->p;
+  if (npy) {
+    const char * names[len];
+    names[0] = "y", names[1] = "x";
+    int k = 2;
+    for (scalar s in list)
+      names[k++] = s.name;
+    npy_write (stdout, names, len, n, v);
+  } else {
+    FILE * fp = ferr;
+    for (long i = 0; i < n; i++, v += len) {
+      fprintf (fp, "%g %g", v[0], v[1]);
+      for (int k = 2; k < len; k++)
+        fprintf (fp, " %g", v[k]);
+      fputc ('\n', fp);
     }
     fflush (fp);
-    matrix_free (field);
-
   }
-
+  array_free (samples);
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+/* Title: Binary output in NumPy (.npy) format
+
+Writes n records of nf doubles, stored contiguously in data, as a
+one-dimensional NumPy array of structured type, one (double) member
+per field name. The header is a few bytes and the data are written
+with a single fwrite(), so that the Python side can read them with
+np.frombuffer() (or as a plain (n, nf) array using
+data.view(np.float64).reshape(-1, nf)) without any parsing.
+
+See https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+*/
+
+/* writes the header dictionary in the buffer of the given size (if
+   any) and returns its length */
+static int npy_header (char * header, int size, const char ** names, int nf,
+		       long n, const char * type)
+{
+  int len = snprintf (header, size, "{'descr': [");
+  for (int i = 0; i < nf; i++)
+    len += snprintf (header ? header + len : NULL, header ? size - len : 0,
+		     "('%s', '%s'), ", names[i], type);
+  len += snprintf (header ? header + len : NULL, header ? size - len : 0,
+		   "], 'fortran_order': False, 'shape': (%ld,), }", n);
+  return len;
+}
+
+void npy_write (FILE * fp, const char ** names, int nf, long n,
+		const double * data)
+{
+  const unsigned short one = 1;
+  const char * type = *((const char *) &one) ? "<f8" : ">f8";
+
+  /* the total header size (including the magic string, version and
+     length) must be a multiple of 64, padded with spaces and
+     terminated with a newline. Version 1.0 stores the length on 2
+     bytes, version 2.0 (for longer headers) on 4 bytes. */
+  int len = npy_header (NULL, 0, names, nf, n, type);
+  int version = len + 1 + 10 + 63 > 0xffff ? 2 : 1;
+  int preamble = version == 1 ? 10 : 12;
+  int total = preamble + len + 1;
+  total += (64 - total % 64) % 64;
+  unsigned int hlen = total - preamble;
+  char * header = malloc (hlen);
+  npy_header (header, len + 1, names, nf, n, type);
+  memset (header + len, ' ', hlen - len - 1);
+  header[hlen - 1] = '\n';
+
+  unsigned char magic[12] = {0x93, 'N', 'U', 'M', 'P', 'Y', version, 0,
+			     hlen & 0xff, (hlen >> 8) & 0xff,
+			     (hlen >> 16) & 0xff, hlen >> 24};
+  fwrite (magic, 1, preamble, fp);
+  fwrite (header, 1, hlen, fp);
+  free (header);
+  fwrite (data, sizeof (double), n*nf, fp);
+  fflush (fp);
+}
@@ -29,8 +29,9 @@
  * The simulation proceeds via standard Basilisk events:
  *   - init: Restores from a dump file if available; otherwise constructs the initial interface from an STL file
  *   - adapt: Adaptive mesh refinement based on interface, curvature, and velocity field errors
- *   - writingFiles: Dumps solution snapshots at specified intervals
+ *   - writingFiles: Dumps solution snapshots at specified intervals (written in the background, see dump-async.h)
  *   - logWriting: Records kinetic energy to a log file at specified intervals
+ *   - logBubbles: Records the volume, centroid, velocity, interface area and contact-line radius of each bubble (see bubble-stats.h) at the same intervals
  *
  * Implementation details:
  *   - Basilisk C's navier-stokes/centered solver is used for momentum conservation
@@ -56,6 +57,8 @@
 #endif
 
 #include "reduced.h"
+#include "dump-async.h"
+#include "bubble-stats.h"
 
 #define MINlevel 2                                              // maximum level
 
@@ -79,7 +82,7 @@ uf.t[bottom] = dirichlet(0.);
 uf.r[bottom] = dirichlet(0.);
 
 double theta0, patchR;
-vector h[];
+float vector h[];
 h.t[bottom] = contact_angle (theta0*pi/180.);
 h.r[bottom] = contact_angle (theta0*pi/180.);
 
@@ -176,10 +179,10 @@ event adapt(i++) {
 
 // Outputs
 event writingFiles (t = 0; t += tsnap; t <= tmax+tsnap) {
-  dump (file = dumpFile);
+  dump (file = dumpFile); // the restart file is always up to date
   char nameOut[80];
   sprintf (nameOut, "intermediate/snapshot-%5.4f", t);
-  dump (file = nameOut);
+  dump_async (file = nameOut);
 }
 
 event logWriting (t = 0; t += tsnap2; t <= tmax+tsnap) {
@@ -206,3 +209,16 @@ event logWriting (t = 0; t += tsnap2; t <= tmax+tsnap) {
   }
 
 }
+
+event logBubbles (t = 0; t += tsnap2; t <= tmax+tsnap) {
+  Bubble * b = NULL;
+  int n = bubble_stats (f, u, &b);
+  if (pid() == 0){
+    FILE * fp = fopen ("bubbles", i == 0 ? "w" : "a");
+    if (i == 0)
+      fprintf (fp, "t tag volume xc yc zc uc vc wc area rcontact\n");
+    bubble_stats_output (fp, t, b, n);
+    fclose (fp);
+  }
+  free (b);
+}